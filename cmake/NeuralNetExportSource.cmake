@@ -0,0 +1,31 @@
+#included by the NeuralNet project whether it is built on its own or added to another one, so projects embedding
+#a model get the export_source tool and neuralnet_export_source
+
+if (PROJECT_IS_TOP_LEVEL)
+    add_executable(export_source ${CMAKE_CURRENT_LIST_DIR}/../tools/export_source/export_source.cpp)
+else ()
+    #only built when a neuralnet_export_source header needs it
+    add_executable(export_source EXCLUDE_FROM_ALL ${CMAKE_CURRENT_LIST_DIR}/../tools/export_source/export_source.cpp)
+endif ()
+
+target_link_libraries(export_source NeuralNet)
+
+#neuralnet_export_source(<target> <model> <namespace>) generates <namespace>.h from the model file at build time
+#and makes it includable by whatever links <target>
+function(neuralnet_export_source target model namespace)
+    set(header_dir ${CMAKE_CURRENT_BINARY_DIR}/${target})
+    set(header ${header_dir}/${namespace}.h)
+    get_filename_component(model_path ${model} ABSOLUTE)
+
+    add_custom_command(
+            OUTPUT ${header}
+            COMMAND ${CMAKE_COMMAND} -E make_directory ${header_dir}
+            COMMAND export_source ${model_path} ${header} ${namespace}
+            DEPENDS export_source ${model_path}
+            COMMENT "Exporting ${model} as ${namespace}.h")
+    add_custom_target(${target}_header DEPENDS ${header})
+
+    add_library(${target} INTERFACE)
+    target_include_directories(${target} INTERFACE ${header_dir})
+    add_dependencies(${target} ${target}_header)
+endfunction()
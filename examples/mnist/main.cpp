@@ -1,13 +1,12 @@
 #include <iostream>
+#include <numeric>
 
 #include <NeuralNet/NeuralNet.h>
 
-#include "mnist/mnist_reader.hpp"
-
 using namespace NeuralNet;
 using namespace NeuralNet::Training;
 
-void print_image(const std::vector<uint8_t> &image) {
+void print_image(const uint8_t *image) {
   for (size_t r = 0; r < 28; ++r) {
     for (size_t c = 0; c < 28; ++c) {
       if (image[r * 28 + c] > 128) {
@@ -37,44 +36,35 @@ std::shared_ptr<NeuralNetwork<NNFLOAT>> create_network() {
   return net;
 }
 
-std::pair<std::vector<std::vector<NNFLOAT>>, std::vector<std::vector<NNFLOAT>>> convert(const std::vector<std::vector<
-    uint8_t>> &images, const std::vector<uint8_t> &labels) {
-  std::vector<std::vector<NNFLOAT>> converted_images;
-  std::vector<std::vector<NNFLOAT>> converted_labels;
-
-  converted_images.reserve(images.size());
-  converted_labels.reserve(labels.size());
+template<std::floating_point dataType>
+void test_network(const std::shared_ptr<NeuralNetwork<dataType>> &net, const IDXDataset<dataType> &dataset) {
+  const size_t batch_size = 256;
+  const size_t output_size = net->OutputSize();
 
-  for (size_t i = 0; i < images.size(); ++i) {
-    converted_images.emplace_back(images[i].begin(), images[i].end());
-    converted_labels.emplace_back(10, 0.0f);
-    converted_labels[i][labels[i]] = 1.0f;
-  }
+  //raw pixels are fed to the network, the first layer scales them itself
+  NetworkInference<dataType> network_inference(net, batch_size, dataset.EncodedInputFormat());
 
-  return {converted_images, converted_labels};
-}
-
-template<std::floating_point dataType>
-void test_network(const std::shared_ptr<NeuralNetwork<dataType>> &net,
-                  const std::vector<std::vector<dataType>> &images,
-                  const std::vector<std::vector<NNFLOAT>> &labels) {
-  NetworkInference network_inference(net);
-  std::vector<float_t> output(net->OutputSize());
+  AlignedVector<uint8_t> inputs(batch_size * dataset.InputSize());
+  AlignedVector<dataType> targets(batch_size * dataset.TargetSize());
+  std::vector<size_t> indices(batch_size);
 
   size_t correct = 0;
-  size_t total = images.size();
+  size_t total = dataset.Size();
 
-  for (size_t i = 0; i < total; ++i) {
-    output = network_inference(images[i]);
+  for (size_t start = 0; start < total; start += batch_size) {
+    const size_t count = std::min(batch_size, total - start);
+    std::iota(indices.begin(), indices.begin() + count, start);
 
-    auto max = std::max_element(output.begin(), output.end());
-    auto label = std::distance(output.begin(), max);
+    dataset.GatherEncoded(indices.data(), count, inputs.data(), targets.data());
+    const dataType *outputs = network_inference(inputs.data(), count);
 
-    auto max_label = std::max_element(labels[i].begin(), labels[i].end());
-    auto correct_label = std::distance(labels[i].begin(), max_label);
+    for (size_t i = 0; i < count; ++i) {
+      const dataType *output = outputs + i * output_size;
+      auto label = std::distance(output, std::max_element(output, output + output_size));
 
-    if (label == correct_label) {
-      correct++;
+      if (label == dataset.Label(start + i)) {
+        correct++;
+      }
     }
   }
 
@@ -83,10 +73,8 @@ void test_network(const std::shared_ptr<NeuralNetwork<dataType>> &net,
 }
 
 void train_network(std::shared_ptr<NeuralNetwork<NNFLOAT>> &net,
-                   const std::vector<std::vector<NNFLOAT>> &train_images,
-                   const std::vector<std::vector<NNFLOAT>> &train_labels,
-                   const std::vector<std::vector<NNFLOAT>> &test_images,
-                   const std::vector<std::vector<NNFLOAT>> &test_labels) {
+                   const IDXDataset<NNFLOAT> &train_dataset,
+                   const IDXDataset<NNFLOAT> &test_dataset) {
   std::mt19937 gen(std::random_device{}());
 
   NetworkTraining<NNFLOAT> netTraining(net,
@@ -95,42 +83,39 @@ void train_network(std::shared_ptr<NeuralNetwork<NNFLOAT>> &net,
                                        std::vector<std::shared_ptr<BaseInitializer<NNFLOAT>>>{std::make_shared<HeInitializer<NNFLOAT>>()},
                                        gen);
 
-  test_network(net, test_images, test_labels);
+  netTraining.SetPrefetchDepth(2);
+
+  test_network(net, test_dataset);
 
   for (size_t i = 0; i < 5; ++i) {
-    netTraining.TrainEpoch(train_images, train_labels, 100, true);
+    netTraining.TrainEpoch(train_dataset, 100, true);
 
     std::cout << "Epoch " << i << std::endl;
-    test_network(net, test_images, test_labels);
+    test_network(net, test_dataset);
   }
 
 }
 
 int main() {
-  const std::string loc = PROGRAM_DIR;
-  mnist::MNIST_dataset<std::vector, std::vector<uint8_t>, uint8_t> dataset =
-      mnist::read_dataset<std::vector, std::vector, uint8_t, uint8_t>(loc + "/mnist-master");
+  const std::string loc = std::string(PROGRAM_DIR) + "/mnist-master";
 
-  std::cout << "Nbr of training images = " << dataset.training_images.size() << std::endl;
-  std::cout << "Nbr of training labels = " << dataset.training_labels.size() << std::endl;
-  std::cout << "Nbr of test images = " << dataset.test_images.size() << std::endl;
-  std::cout << "Nbr of test labels = " << dataset.test_labels.size() << std::endl;
+  IDXDataset<NNFLOAT> train_dataset(loc + "/train-images-idx3-ubyte", loc + "/train-labels-idx1-ubyte", 10);
+  IDXDataset<NNFLOAT> test_dataset(loc + "/t10k-images-idx3-ubyte", loc + "/t10k-labels-idx1-ubyte", 10);
 
-  std::cout << "Sample Image no 35" << std::endl;
-  auto i = dataset.training_images[35];
+  std::cout << "Nbr of training images = " << train_dataset.Size() << std::endl;
+  std::cout << "Nbr of test images = " << test_dataset.Size() << std::endl;
 
-  print_image(i);
+  std::cout << "Sample Image no 35" << std::endl;
 
-  std::cout << "Label: " << dataset.training_labels[35] + 0 << std::endl;
+  print_image(train_dataset.Image(35));
 
-  auto [converted_images, converted_labels] = convert(dataset.training_images, dataset.training_labels);
-  auto [converted_test_images, converted_test_labels] = convert(dataset.test_images, dataset.test_labels);
+  std::cout << "Label: " << train_dataset.Label(35) + 0 << std::endl;
 
   auto net = create_network();
 
-  train_network(net, converted_images, converted_labels, converted_test_images, converted_test_labels);
+  train_network(net, train_dataset, test_dataset);
 
-  test_network(net, converted_test_images, converted_test_labels);
+  test_network(net, test_dataset);
 
   return 0;
 }
@@ -0,0 +1,125 @@
+#include <NeuralNet/NeuralNet.h>
+
+#include <filesystem>
+
+using namespace NeuralNet;
+using namespace NeuralNet::Training;
+
+//the half precision, sparse, packed bit and codebook layers compute what the network they were converted from
+//computes, for layer sizes that leave remainders after the vector loops, every batch size up to the compiled one
+//and every kernel set the machine supports, also after a save and a verified load
+
+constexpr size_t kInputSize = 37;
+constexpr size_t kMaxBatchSize = 33;
+
+//largest difference between the outputs, relative to the largest expected output
+NNFLOAT RelativeError(const NNFLOAT *expected, const NNFLOAT *outputs, size_t size) {
+  NNFLOAT range = 0;
+  NNFLOAT error = 0;
+  for (size_t i = 0; i < size; ++i) {
+    range = std::max(range, std::abs(expected[i]));
+    error = std::max(error, std::abs(expected[i] - outputs[i]));
+  }
+  return error / range;
+}
+
+//compares the plans of network with the scalar plan of reference
+bool Matches(const std::string &name, const std::shared_ptr<NeuralNetwork<NNFLOAT>> &network,
+             const std::shared_ptr<NeuralNetwork<NNFLOAT>> &reference, const std::vector<NNFLOAT> &inputs,
+             NNFLOAT tolerance) {
+  const std::string path = std::string(PROGRAM_DIR) + "/compressed_layers_test.nn";
+  network->Save(path);
+  const auto loaded = Load<NNFLOAT>(path, true);
+  std::filesystem::remove(path);
+
+  const size_t output_size = reference->OutputSize();
+  const auto reference_plan = Compile(reference, kMaxBatchSize, false, {}, Kernels::ISA::Scalar);
+  const NNFLOAT *reference_outputs = reference_plan->Forward(inputs.data(), kMaxBatchSize);
+  const std::vector<NNFLOAT> expected(reference_outputs, reference_outputs + kMaxBatchSize * output_size);
+
+  std::vector<Kernels::ISA> isas = {Kernels::ISA::Scalar};
+  if (Kernels::DetectISA() != Kernels::ISA::Scalar) {
+    isas.push_back(Kernels::DetectISA());
+  }
+
+  bool passed = true;
+  for (Kernels::ISA isa : isas) {
+    for (const auto &converted : {network, loaded}) {
+      const auto plan = Compile(converted, kMaxBatchSize, false, {}, isa);
+      for (size_t batch_size : {1, 3, 5, 17, 33}) {
+        const NNFLOAT *outputs = plan->Forward(inputs.data(), batch_size);
+        const NNFLOAT error = RelativeError(expected.data(), outputs, batch_size * output_size);
+        if (!(error <= tolerance)) {
+          std::cout << name << " " << Kernels::ISAName(isa) << " plan" << (converted == loaded ? " loaded" : "")
+                    << " is " << error << " off for " << batch_size << " samples" << std::endl;
+          passed = false;
+        }
+      }
+    }
+  }
+  return passed;
+}
+
+std::shared_ptr<NeuralNetwork<NNFLOAT>> CreateNetwork(std::mt19937 &gen) {
+  auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+  net->AddLayer<FullyConnectedLayer>(kInputSize, 67);
+  net->AddLayer<ReLuActivation>(67, 67);
+  net->AddLayer<FullyConnectedLayer>(67, 29);
+  net->AddLayer<TanhActivation>(29, 29);
+  net->AddLayer<FullyConnectedLayer>(29, 5);
+  NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(net, gen);
+  return net;
+}
+
+int main() {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<NNFLOAT> dist(-1, 1);
+
+  std::vector<NNFLOAT> inputs(kMaxBatchSize * kInputSize);
+  for (auto &input : inputs) {
+    input = dist(gen);
+  }
+
+  bool passed = true;
+
+  const auto net = CreateNetwork(gen);
+  passed &= Matches("fp16", HalfPrecisionWeights(net, Precision::Float16), net, inputs, 0.005);
+  passed &= Matches("bf16", HalfPrecisionWeights(net, Precision::BFloat16), net, inputs, 0.02);
+
+  //the codebook network computes exactly what its weights looked up into a dense network compute
+  const auto codebook4 = CodebookWeights(net, 4);
+  passed &= Matches("codebook4", codebook4, DecodeCodebookWeights(codebook4), inputs, 1e-5);
+  const auto codebook8 = CodebookWeights(net, 8);
+  passed &= Matches("codebook8", codebook8, DecodeCodebookWeights(codebook8), inputs, 1e-5);
+
+  //three of every four weights zeroed, at scattered positions so every row keeps a ragged number of them
+  const auto pruned = CreateNetwork(gen);
+  for (size_t i = 0; i < pruned->LayersSize(); ++i) {
+    if (const auto dense = std::dynamic_pointer_cast<FullyConnectedLayer<NNFLOAT>>(pruned->LayerAt(i))) {
+      std::vector<NNFLOAT> &parameters = dense->Parameters();
+      for (size_t k = 0; k < dense->InputSize() * dense->OutputSize(); ++k) {
+        if (gen() % 4 != 0) {
+          parameters[k] = 0;
+        }
+      }
+    }
+  }
+  const auto sparse = Sparsify(pruned);
+  if (!std::dynamic_pointer_cast<SparseFullyConnectedLayer<NNFLOAT>>(sparse->LayerAt(0))) {
+    std::cout << "pruned layer was not made sparse" << std::endl;
+    passed = false;
+  }
+  passed &= Matches("sparse", sparse, pruned, inputs, 1e-5);
+
+  //packed bit planes compute what the quantized shadow weights compute
+  auto bits = std::make_shared<NeuralNetwork<NNFLOAT>>();
+  bits->AddLayer<FullyConnectedLayer>(kInputSize, 67);
+  bits->AddLayer<BinaryFullyConnectedLayer>(67, 71);
+  bits->AddLayer<TernaryFullyConnectedLayer>(71, 29);
+  bits->AddLayer<FullyConnectedLayer>(29, 5);
+  NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(bits, gen);
+  passed &= Matches("bits", PackBitWeights(bits), bits, inputs, 1e-5);
+
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
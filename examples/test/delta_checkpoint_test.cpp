@@ -0,0 +1,181 @@
+#include <NeuralNet/NeuralNet.h>
+
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+
+using namespace NeuralNet;
+using namespace NeuralNet::Training;
+
+//a full checkpoint compacted with the deltas written after it gives the same file as saving the state at the
+//end, deltas applied to the wrong checkpoint or damaged on disk are rejected
+
+std::vector<char> ReadFile(const std::string &path) {
+  std::ifstream is(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+}
+
+void WriteFile(const std::string &path, const std::vector<char> &bytes) {
+  std::ofstream os(path, std::ios::binary | std::ios::trunc);
+  os.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+//whether compacting base with deltas throws
+bool Rejected(const std::string &base, const std::vector<std::string> &deltas, const std::string &output) {
+  try {
+    CompactCheckpoints(base, deltas, output);
+  } catch (const std::runtime_error &) {
+    return true;
+  }
+  return false;
+}
+
+int main() {
+  const std::string path = std::string(PROGRAM_DIR) + "/delta_checkpoint_test";
+  const std::string base_path = path + "-0.nn";
+  const std::vector<std::string> delta_paths = {path + "-1.nn", path + "-2.nn", path + "-3.nn"};
+  const std::string saved_path = path + "-saved.nn";
+  const std::string compacted_path = path + "-compacted.nn";
+  const std::string corrupted_path = path + "-corrupted.nn";
+
+  std::mt19937 data_gen(3);
+  std::uniform_real_distribution<NNFLOAT> dist(-1, 1);
+  std::vector<std::vector<NNFLOAT>> inputs(53, std::vector<NNFLOAT>(6));
+  std::vector<std::vector<NNFLOAT>> targets(53, std::vector<NNFLOAT>(3));
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    for (auto &input : inputs[i]) {
+      input = dist(data_gen);
+    }
+    targets[i] = {inputs[i][0] * inputs[i][1], inputs[i][2] - inputs[i][3], inputs[i][4] * inputs[i][5]};
+  }
+  Dataset<NNFLOAT> dataset(inputs, targets);
+
+  std::mt19937 gen(11);
+  auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+  net->AddLayer<FullyConnectedLayer>(6, 40);
+  net->AddLayer<TanhActivation>(40, 40);
+  net->AddLayer<FullyConnectedLayer>(40, 3);
+  NetworkTraining<NNFLOAT> training(net, std::make_shared<AdamOptimizer<NNFLOAT>>(0.01f),
+                                    std::make_shared<MSECost<NNFLOAT>>(),
+                                    std::vector<std::shared_ptr<BaseInitializer<NNFLOAT>>>{
+                                        std::make_shared<NormalizedUniformXavierInitializer<NNFLOAT>>()},
+                                    gen);
+
+  //the first checkpoint of the chain is complete, the others only hold the chunks that changed
+  training.TrainEpoch(dataset, 8, true);
+  training.Checkpoint(base_path, true, true);
+  for (const auto &delta_path : delta_paths) {
+    training.TrainEpoch(dataset, 8, true);
+    training.Checkpoint(delta_path, true, true);
+  }
+  training.WaitForCheckpoints();
+  training.SaveState(saved_path);
+
+  bool passed = true;
+
+  CompactCheckpoints(base_path, delta_paths, compacted_path);
+  const std::vector<char> compacted = ReadFile(compacted_path);
+  if (compacted != ReadFile(saved_path)) {
+    std::cout << "compacted checkpoint differs from the saved state" << std::endl;
+    passed = false;
+  }
+
+  {
+    std::mt19937 resumed_gen(0);
+    auto resumed_net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+    resumed_net->AddLayer<FullyConnectedLayer>(6, 40);
+    resumed_net->AddLayer<TanhActivation>(40, 40);
+    resumed_net->AddLayer<FullyConnectedLayer>(40, 3);
+    NetworkTraining<NNFLOAT> resumed(resumed_net, std::make_shared<AdamOptimizer<NNFLOAT>>(0.01f),
+                                     std::make_shared<MSECost<NNFLOAT>>(),
+                                     std::vector<std::shared_ptr<BaseInitializer<NNFLOAT>>>{}, resumed_gen, {},
+                                     false);
+    resumed.LoadState(compacted_path);
+    if (resumed.TrainingIterations() != training.TrainingIterations()) {
+      std::cout << "resumed at iteration " << resumed.TrainingIterations() << " instead of "
+                << training.TrainingIterations() << std::endl;
+      passed = false;
+    }
+  }
+
+  //with small chunks the delta of one changed layer skips the chunks of the other, compaction takes them from
+  //the parent
+  {
+    auto wide = std::make_shared<NeuralNetwork<NNFLOAT>>();
+    wide->AddLayer<FullyConnectedLayer>(64, 100);
+    wide->AddLayer<TanhActivation>(100, 100);
+    wide->AddLayer<FullyConnectedLayer>(100, 3);
+    NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(wide, gen);
+
+    DeltaCheckpointWriter deltas(256);
+    ModelWriter full;
+    wide->Save(full);
+    deltas.WriteFull(full, ModelFormat::ElementOf<NNFLOAT>(), path + "-small-0.nn");
+
+    auto output_layer = std::dynamic_pointer_cast<FullyConnectedLayer<NNFLOAT>>(wide->LayerAt(2));
+    for (auto &parameter : output_layer->Parameters()) {
+      parameter *= NNFLOAT(0.5);
+    }
+    ModelWriter changed;
+    wide->Save(changed);
+    const size_t chunk_bytes = deltas.WriteDelta(changed, ModelFormat::ElementOf<NNFLOAT>(), path + "-small-1.nn");
+    wide->Save(saved_path);
+
+    if (chunk_bytes == 0 || chunk_bytes >= ReadFile(saved_path).size() / 2) {
+      std::cout << "delta of one changed layer holds " << chunk_bytes << " bytes" << std::endl;
+      passed = false;
+    }
+
+    CompactCheckpoints(path + "-small-0.nn", {path + "-small-1.nn"}, corrupted_path);
+    if (ReadFile(corrupted_path) != ReadFile(saved_path)) {
+      std::cout << "compacted partial delta differs from the saved network" << std::endl;
+      passed = false;
+    }
+    std::filesystem::remove(path + "-small-0.nn");
+    std::filesystem::remove(path + "-small-1.nn");
+  }
+
+  //a delta only applies to the checkpoint it was taken after
+  if (!Rejected(base_path, {delta_paths[1], delta_paths[2]}, compacted_path)) {
+    std::cout << "delta applied to the wrong parent checkpoint" << std::endl;
+    passed = false;
+  }
+  if (!Rejected(base_path, {delta_paths[0], delta_paths[2], delta_paths[1]}, compacted_path)) {
+    std::cout << "deltas applied out of order" << std::endl;
+    passed = false;
+  }
+
+  //the delta ends with the data of its last chunk
+  std::vector<char> corrupted = ReadFile(delta_paths[0]);
+  corrupted.back() ^= 1;
+  WriteFile(corrupted_path, corrupted);
+  if (!Rejected(base_path, {corrupted_path, delta_paths[1], delta_paths[2]}, compacted_path)) {
+    std::cout << "corrupted delta accepted" << std::endl;
+    passed = false;
+  }
+
+  corrupted = ReadFile(delta_paths[0]);
+  corrupted.resize(corrupted.size() / 2);
+  WriteFile(corrupted_path, corrupted);
+  if (!Rejected(base_path, {corrupted_path, delta_paths[1], delta_paths[2]}, compacted_path)) {
+    std::cout << "truncated delta accepted" << std::endl;
+    passed = false;
+  }
+
+  //a rejected compaction leaves the previous output in place
+  if (ReadFile(compacted_path) != compacted) {
+    std::cout << "rejected compaction changed its output" << std::endl;
+    passed = false;
+  }
+
+  std::filesystem::remove(base_path);
+  for (const auto &delta_path : delta_paths) {
+    std::filesystem::remove(delta_path);
+  }
+  std::filesystem::remove(saved_path);
+  std::filesystem::remove(compacted_path);
+  std::filesystem::remove(corrupted_path);
+
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+#include <NeuralNet/NeuralNet.h>
+
+#include <numeric>
+#include <algorithm>
+
+using namespace NeuralNet;
+using namespace NeuralNet::Training;
+
+//optimized graphs compute what the graph they were optimized from computes, every pass applies to the network
+//built for it, and NetworkClassifier selects the classes full inference ranks highest
+
+constexpr size_t kBatchSize = 19;
+
+//largest difference between the outputs, relative to the largest expected output
+NNFLOAT RelativeError(const NNFLOAT *expected, const NNFLOAT *outputs, size_t size) {
+  NNFLOAT range = 0;
+  NNFLOAT error = 0;
+  for (size_t i = 0; i < size; ++i) {
+    range = std::max(range, std::abs(expected[i]));
+    error = std::max(error, std::abs(expected[i] - outputs[i]));
+  }
+  return error / range;
+}
+
+//whether pass changes a fresh graph of network
+bool Applies(const std::string &name, bool (*pass)(NetworkGraph<NNFLOAT> &), const NeuralNetwork<NNFLOAT> &network,
+             const InputFormat<NNFLOAT> &input_format = {}) {
+  NetworkGraph<NNFLOAT> graph(network, input_format);
+  if (!pass(graph)) {
+    std::cout << name << " did not apply" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//compares the plan of the optimized graph of network and of the network made from it with the unoptimized plan
+template<typename Element>
+bool Matches(const std::string &name, const NeuralNetwork<NNFLOAT> &network, const std::vector<Element> &inputs,
+             const InputFormat<NNFLOAT> &input_format = {}) {
+  const NetworkGraph<NNFLOAT> graph(network, input_format);
+  const auto reference_plan = Compile(graph, kBatchSize);
+  const NNFLOAT *reference_outputs = reference_plan->Forward(inputs.data(), kBatchSize);
+  const std::vector<NNFLOAT> expected(reference_outputs, reference_outputs + kBatchSize * network.OutputSize());
+
+  NetworkGraph<NNFLOAT> optimized = graph;
+  GraphPasses::Optimize(optimized);
+  const auto plan = Compile(optimized, kBatchSize);
+  //the folded scale and offset are part of the weights now, the network takes the format the graph was left with
+  const auto rebuilt_plan = Compile(optimized.ToNetwork(), kBatchSize, false, optimized.Format());
+
+  bool passed = true;
+  if (plan->StepsSize() >= reference_plan->StepsSize()) {
+    std::cout << name << " kept " << plan->StepsSize() << " of " << reference_plan->StepsSize() << " steps"
+              << std::endl;
+    passed = false;
+  }
+
+  const NNFLOAT error = RelativeError(expected.data(), plan->Forward(inputs.data(), kBatchSize), expected.size());
+  if (!(error <= 1e-4)) {
+    std::cout << name << " optimized plan is " << error << " off" << std::endl;
+    passed = false;
+  }
+
+  const NNFLOAT rebuilt_error = RelativeError(expected.data(), rebuilt_plan->Forward(inputs.data(), kBatchSize),
+                                              expected.size());
+  if (!(rebuilt_error <= 1e-4)) {
+    std::cout << name << " network of the optimized graph is " << rebuilt_error << " off" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+
+int main() {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<NNFLOAT> dist(-1, 1);
+
+  std::vector<NNFLOAT> inputs(kBatchSize * 13);
+  for (auto &input : inputs) {
+    input = dist(gen);
+  }
+
+  bool passed = true;
+
+  {
+    //units 3 and 8 of the first layer have no weights and unit 11 of the second is never read, the ReLU after
+    //the sigmoid changes nothing and the last two layers need fewer multiply adds as one
+    auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+    net->AddLayer<FullyConnectedLayer>(13, 21);
+    net->AddLayer<ReLuActivation>(21, 21);
+    net->AddLayer<FullyConnectedLayer>(21, 17);
+    net->AddLayer<SigmoidActivation>(17, 17);
+    net->AddLayer<ReLuActivation>(17, 17);
+    net->AddLayer<FullyConnectedLayer>(17, 9);
+    net->AddLayer<FullyConnectedLayer>(9, 5);
+    NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(net, gen);
+
+    const auto first_layer = std::dynamic_pointer_cast<FullyConnectedLayer<NNFLOAT>>(net->LayerAt(0));
+    std::vector<NNFLOAT> &first = first_layer->Parameters();
+    std::fill_n(first.begin() + 3 * 13, 13, NNFLOAT(0));
+    std::fill_n(first.begin() + 8 * 13, 13, NNFLOAT(0));
+
+    const auto second_layer = std::dynamic_pointer_cast<FullyConnectedLayer<NNFLOAT>>(net->LayerAt(2));
+    std::vector<NNFLOAT> &second = second_layer->Parameters();
+    for (size_t j = 0; j < 17; ++j) {
+      second[j * 21 + 11] = 0;
+    }
+
+    passed &= Applies("EliminateDeadUnits", &GraphPasses::EliminateDeadUnits<NNFLOAT>, *net);
+    passed &= Applies("EliminateIdentityActivations", &GraphPasses::EliminateIdentityActivations<NNFLOAT>, *net);
+    passed &= Applies("MergeLinearLayers", &GraphPasses::MergeLinearLayers<NNFLOAT>, *net);
+    passed &= Applies("FuseActivations", &GraphPasses::FuseActivations<NNFLOAT>, *net);
+    passed &= Matches("dense", *net, inputs);
+  }
+
+  {
+    //uint8 inputs whose scale and offset fold into the first layer
+    auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+    net->AddLayer<FullyConnectedLayer>(13, 11);
+    net->AddLayer<TanhActivation>(11, 11);
+    net->AddLayer<FullyConnectedLayer>(11, 4);
+    NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(net, gen);
+
+    const InputFormat<NNFLOAT> input_format{InputElement::UInt8, NNFLOAT(1) / 255, NNFLOAT(-0.5)};
+    std::vector<uint8_t> encoded(kBatchSize * 13);
+    for (auto &input : encoded) {
+      input = static_cast<uint8_t>(gen() % 256);
+    }
+
+    passed &= Applies("FoldInputScale", &GraphPasses::FoldInputScale<NNFLOAT>, *net, input_format);
+    passed &= Matches("uint8", *net, encoded, input_format);
+  }
+
+  {
+    //a normalization in front that folds into the layer reading it
+    std::vector<NNFLOAT> scale(13);
+    std::vector<NNFLOAT> offset(13);
+    for (size_t k = 0; k < 13; ++k) {
+      scale[k] = NNFLOAT(0.5) + std::abs(dist(gen));
+      offset[k] = dist(gen);
+    }
+
+    auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+    net->AddLayer(std::make_shared<NormalizationLayer<NNFLOAT>>(scale, offset));
+    net->AddLayer<FullyConnectedLayer>(13, 10);
+    net->AddLayer<ReLuActivation>(10, 10);
+    net->AddLayer<FullyConnectedLayer>(10, 3);
+    NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(net, gen);
+
+    passed &= Applies("FoldNormalization", &GraphPasses::FoldNormalization<NNFLOAT>, *net);
+    passed &= Matches("normalization", *net, inputs);
+  }
+
+  {
+    //the classifier drops the softmax and ranks the logits
+    auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+    net->AddLayer<FullyConnectedLayer>(13, 16);
+    net->AddLayer<ReLuActivation>(16, 16);
+    net->AddLayer<FullyConnectedLayer>(16, 7);
+    net->AddLayer<SoftmaxActivation>(7, 7);
+    NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(net, gen);
+
+    passed &= Applies("DropMonotonicOutput", &GraphPasses::DropMonotonicOutput<NNFLOAT>, *net);
+
+    constexpr size_t k = 3;
+    NetworkClassifier<NNFLOAT> classifier(net, kBatchSize);
+    const size_t *classes = classifier.TopK(inputs.data(), kBatchSize, k);
+
+    const auto plan = Compile(net, kBatchSize);
+    const NNFLOAT *outputs = plan->Forward(inputs.data(), kBatchSize);
+    for (size_t i = 0; i < kBatchSize; ++i) {
+      const NNFLOAT *row = outputs + i * 7;
+      std::vector<size_t> expected(7);
+      std::iota(expected.begin(), expected.end(), 0);
+      std::sort(expected.begin(), expected.end(), [row](size_t a, size_t b) { return row[a] > row[b]; });
+
+      if (!std::equal(expected.begin(), expected.begin() + k, classes + i * k)) {
+        std::cout << "classifier ranks sample " << i << " differently from inference" << std::endl;
+        passed = false;
+      }
+    }
+  }
+
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include <NeuralNet/NeuralNet.h>
+
+#include <filesystem>
+
+using namespace NeuralNet;
+using namespace NeuralNet::Training;
+
+//plans compiled from a loaded model keep the file mapped after the layers copy their parameters out of it
+
+bool Matches(const std::vector<NNFLOAT> &expected, const NNFLOAT *outputs) {
+  for (size_t i = 0; i < expected.size(); ++i) {
+    if (expected[i] != outputs[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  const std::string path = std::string(PROGRAM_DIR) + "/mapped_parameters_test.nn";
+  std::mt19937 gen(42);
+
+  auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+  net->AddLayer<FullyConnectedLayer>(13, 7);
+  net->AddLayer<SigmoidActivation>(7, 7);
+  net->AddLayer<FullyConnectedLayer>(7, 3);
+  NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(net, gen);
+  net->Save(path);
+
+  std::vector<NNFLOAT> inputs(13);
+  std::uniform_real_distribution<NNFLOAT> dist(-1, 1);
+  for (auto &input : inputs) {
+    input = dist(gen);
+  }
+
+  bool passed = true;
+
+  {
+    auto loaded = Load<NNFLOAT>(path);
+    NetworkInference<NNFLOAT> inference(loaded);
+    const std::vector<NNFLOAT> expected = inference(inputs);
+
+    loaded->OwnParameters();
+    if (!Matches(expected, inference(inputs).data())) {
+      std::cout << "inference changed after OwnParameters" << std::endl;
+      passed = false;
+    }
+  }
+
+  {
+    auto loaded = Load<NNFLOAT>(path);
+    NetworkInference<NNFLOAT> inference(loaded);
+    const std::vector<NNFLOAT> expected = inference(inputs);
+
+    //constructing the training copies the parameters out of the file as well
+    NetworkTraining<NNFLOAT> training(loaded, std::make_shared<GradOptimizer<NNFLOAT>>(0.1f),
+                                      std::make_shared<MSECost<NNFLOAT>>(),
+                                      std::vector<std::shared_ptr<BaseInitializer<NNFLOAT>>>{}, gen, {}, false);
+    if (!Matches(expected, inference(inputs).data())) {
+      std::cout << "inference changed after constructing a training" << std::endl;
+      passed = false;
+    }
+  }
+
+  std::filesystem::remove(path);
+
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
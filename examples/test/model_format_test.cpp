@@ -0,0 +1,141 @@
+#include <NeuralNet/NeuralNet.h>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+
+using namespace NeuralNet;
+using namespace NeuralNet::Training;
+
+//a saved model loads back to the same layers and parameters and saves to the same bytes, a damaged file is
+//rejected by its checksums
+
+std::vector<char> ReadFile(const std::string &path) {
+  std::ifstream is(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+}
+
+void WriteFile(const std::string &path, const std::vector<char> &bytes) {
+  std::ofstream os(path, std::ios::binary | std::ios::trunc);
+  os.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+//whether reading the file throws, verify_blocks also checksums the parameter blocks
+bool Rejected(const std::string &path, bool verify_blocks) {
+  try {
+    Load<NNFLOAT>(path, verify_blocks);
+  } catch (const std::runtime_error &) {
+    return true;
+  }
+  return false;
+}
+
+int main() {
+  const std::string path = std::string(PROGRAM_DIR) + "/model_format_test.nn";
+  const std::string resaved_path = std::string(PROGRAM_DIR) + "/model_format_test_resaved.nn";
+  const std::string corrupted_path = std::string(PROGRAM_DIR) + "/model_format_test_corrupted.nn";
+  std::mt19937 gen(42);
+
+  auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+  net->AddLayer<FullyConnectedLayer>(11, 6);
+  net->AddLayer<TanhActivation>(6, 6);
+  net->AddLayer<FullyConnectedLayer>(6, 3);
+  net->AddLayer<SoftmaxActivation>(3, 3);
+  NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(net, gen);
+  net->Save(path);
+
+  bool passed = true;
+
+  auto loaded = Load<NNFLOAT>(path, true);
+  if (loaded->LayersSize() != net->LayersSize()) {
+    std::cout << "loaded " << loaded->LayersSize() << " layers instead of " << net->LayersSize() << std::endl;
+    return 1;
+  }
+
+  for (size_t i = 0; i < net->LayersSize(); ++i) {
+    const auto layer = net->LayerAt(i);
+    const auto loaded_layer = loaded->LayerAt(i);
+    if (typeid(*layer) != typeid(*loaded_layer) || layer->InputSize() != loaded_layer->InputSize()
+        || layer->OutputSize() != loaded_layer->OutputSize()) {
+      std::cout << "layer " << i << " changed type or size" << std::endl;
+      passed = false;
+      continue;
+    }
+
+    const auto dense = std::dynamic_pointer_cast<FullyConnectedLayer<NNFLOAT>>(layer);
+    if (dense) {
+      const auto loaded_dense = std::dynamic_pointer_cast<FullyConnectedLayer<NNFLOAT>>(loaded_layer);
+      if (!std::equal(dense->WeightsBiases(), dense->WeightsBiases() + dense->ParametersSize(),
+                      loaded_dense->WeightsBiases())) {
+        std::cout << "parameters of layer " << i << " changed" << std::endl;
+        passed = false;
+      }
+    }
+  }
+
+  std::vector<NNFLOAT> inputs(11);
+  std::uniform_real_distribution<NNFLOAT> dist(-1, 1);
+  for (auto &input : inputs) {
+    input = dist(gen);
+  }
+  if (NetworkInference<NNFLOAT>(net)(inputs) != NetworkInference<NNFLOAT>(loaded)(inputs)) {
+    std::cout << "loaded network computes different outputs" << std::endl;
+    passed = false;
+  }
+
+  loaded->Save(resaved_path);
+  const std::vector<char> bytes = ReadFile(path);
+  if (ReadFile(resaved_path) != bytes) {
+    std::cout << "saving the loaded network wrote different bytes" << std::endl;
+    passed = false;
+  }
+
+  ModelFormat::Header header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+
+  //a damaged parameter is only found when the blocks are verified
+  std::vector<char> corrupted = bytes;
+  corrupted[header.data_offset] ^= 1;
+  WriteFile(corrupted_path, corrupted);
+  if (Rejected(corrupted_path, false)) {
+    std::cout << "corrupted parameter block rejected without verifying the blocks" << std::endl;
+    passed = false;
+  }
+  if (!Rejected(corrupted_path, true)) {
+    std::cout << "corrupted parameter block accepted" << std::endl;
+    passed = false;
+  }
+
+  //the header and the tables are always checked
+  corrupted = bytes;
+  corrupted[offsetof(ModelFormat::Header, layers)] ^= 1;
+  WriteFile(corrupted_path, corrupted);
+  if (!Rejected(corrupted_path, false)) {
+    std::cout << "corrupted header accepted" << std::endl;
+    passed = false;
+  }
+
+  corrupted = bytes;
+  corrupted[sizeof(ModelFormat::Header) + offsetof(ModelFormat::LayerRecord, output_size)] ^= 1;
+  WriteFile(corrupted_path, corrupted);
+  if (!Rejected(corrupted_path, false)) {
+    std::cout << "corrupted layer table accepted" << std::endl;
+    passed = false;
+  }
+
+  corrupted = bytes;
+  corrupted.pop_back();
+  WriteFile(corrupted_path, corrupted);
+  if (!Rejected(corrupted_path, false)) {
+    std::cout << "truncated file accepted" << std::endl;
+    passed = false;
+  }
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(resaved_path);
+  std::filesystem::remove(corrupted_path);
+
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#include <NeuralNet/NeuralNet.h>
+
+#include <filesystem>
+
+using namespace NeuralNet;
+using namespace NeuralNet::Training;
+
+//int8 plans stay close to the float plan of the same network, for layer sizes that leave remainders after the
+//8 and 32 wide kernel loops and for every kernel set the machine supports
+
+//largest difference between the outputs, relative to the largest float output
+NNFLOAT RelativeError(const std::vector<NNFLOAT> &expected, const NNFLOAT *outputs) {
+  NNFLOAT range = 0;
+  NNFLOAT error = 0;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    range = std::max(range, std::abs(expected[i]));
+    error = std::max(error, std::abs(expected[i] - outputs[i]));
+  }
+  return error / range;
+}
+
+int main() {
+  const std::string path = std::string(PROGRAM_DIR) + "/quantization_test.nn";
+  constexpr size_t kSamples = 300;
+  constexpr size_t kBatchSize = 23;
+  constexpr NNFLOAT kTolerance = 0.05;
+
+  std::mt19937 gen(42);
+
+  auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+  net->AddLayer<FullyConnectedLayer>(37, 29);
+  net->AddLayer<ReLuActivation>(29, 29);
+  net->AddLayer<FullyConnectedLayer>(29, 19);
+  net->AddLayer<ReLuActivation>(19, 19);
+  net->AddLayer<FullyConnectedLayer>(19, 5);
+  NormalizedUniformXavierInitializer<NNFLOAT>().InitializeTrainableParams(net, gen);
+
+  std::vector<std::vector<NNFLOAT>> inputs(kSamples, std::vector<NNFLOAT>(37));
+  std::vector<std::vector<NNFLOAT>> targets(kSamples, std::vector<NNFLOAT>(5));
+  std::uniform_real_distribution<NNFLOAT> dist(-1, 1);
+  for (auto &input : inputs) {
+    for (auto &value : input) {
+      value = dist(gen);
+    }
+  }
+  const Dataset<NNFLOAT> calibration(inputs, targets);
+
+  auto quantized = Quantize(net, calibration);
+  quantized->Save(path);
+  auto loaded = Load<NNFLOAT>(path, true);
+
+  //a batch of the calibration samples and one the scales were not calibrated on
+  std::vector<NNFLOAT> batch(kBatchSize * 37);
+  for (size_t i = 0; i < kBatchSize; ++i) {
+    std::copy(inputs[i].begin(), inputs[i].end(), batch.begin() + i * 37);
+  }
+  std::vector<NNFLOAT> unseen(kBatchSize * 37);
+  for (auto &value : unseen) {
+    value = dist(gen) * NNFLOAT(0.9);
+  }
+
+  bool passed = true;
+
+  std::vector<Kernels::ISA> isas = {Kernels::ISA::Scalar};
+  if (Kernels::DetectISA() != Kernels::ISA::Scalar) {
+    isas.push_back(Kernels::DetectISA());
+  }
+
+  for (const std::vector<NNFLOAT> *samples : {&batch, &unseen}) {
+    const auto float_plan = Compile(net, kBatchSize, false, {}, Kernels::ISA::Scalar);
+    const NNFLOAT *float_outputs = float_plan->Forward(samples->data(), kBatchSize);
+    const std::vector<NNFLOAT> expected(float_outputs, float_outputs + kBatchSize * 5);
+
+    for (Kernels::ISA isa : isas) {
+      for (const auto &network : {quantized, loaded}) {
+        //a ragged last batch as well as a full one
+        for (size_t batch_size : {kBatchSize, size_t(7)}) {
+          const auto plan = Compile(network, kBatchSize, false, {}, isa);
+          const NNFLOAT *outputs = plan->Forward(samples->data(), batch_size);
+          const std::vector<NNFLOAT> rows(expected.begin(), expected.begin() + batch_size * 5);
+
+          const NNFLOAT error = RelativeError(rows, outputs);
+          if (!(error <= kTolerance)) {
+            std::cout << Kernels::ISAName(isa) << " int8 plan is " << error << " off the float plan for "
+                      << batch_size << " samples" << std::endl;
+            passed = false;
+          }
+        }
+      }
+    }
+  }
+
+  std::filesystem::remove(path);
+
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#include <NeuralNet/NeuralNet.h>
+
+#include <filesystem>
+
+using namespace NeuralNet;
+using namespace NeuralNet::Training;
+
+//a run resumed from a saved training state continues exactly like the run that saved it
+
+std::shared_ptr<NeuralNetwork<NNFLOAT>> CreateNetwork() {
+  auto net = std::make_shared<NeuralNetwork<NNFLOAT>>();
+  net->AddLayer<FullyConnectedLayer>(5, 9);
+  net->AddLayer<TanhActivation>(9, 9);
+  net->AddLayer<FullyConnectedLayer>(9, 2);
+  return net;
+}
+
+NetworkTraining<NNFLOAT> CreateTraining(const std::shared_ptr<NeuralNetwork<NNFLOAT>> &net, std::mt19937 &gen,
+                                        const std::vector<std::shared_ptr<BaseLogger<NNFLOAT>>> &loggers = {}) {
+  return NetworkTraining<NNFLOAT>(net, std::make_shared<AdamOptimizer<NNFLOAT>>(0.01f),
+                                  std::make_shared<MSECost<NNFLOAT>>(),
+                                  std::vector<std::shared_ptr<BaseInitializer<NNFLOAT>>>{
+                                      std::make_shared<NormalizedUniformXavierInitializer<NNFLOAT>>()},
+                                  gen, loggers);
+}
+
+bool SameParameters(const std::shared_ptr<NeuralNetwork<NNFLOAT>> &net1,
+                    const std::shared_ptr<NeuralNetwork<NNFLOAT>> &net2) {
+  for (size_t i = 0; i < net1->LayersSize(); ++i) {
+    if (auto layer1 = std::dynamic_pointer_cast<FullyConnectedLayer<NNFLOAT>>(net1->LayerAt(i))) {
+      auto layer2 = std::dynamic_pointer_cast<FullyConnectedLayer<NNFLOAT>>(net2->LayerAt(i));
+      if (layer1->Parameters() != layer2->Parameters()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+  const std::string path = std::string(PROGRAM_DIR) + "/training_state_test.nn";
+
+  std::mt19937 data_gen(3);
+  std::uniform_real_distribution<NNFLOAT> dist(-1, 1);
+  std::vector<std::vector<NNFLOAT>> inputs(37, std::vector<NNFLOAT>(5));
+  std::vector<std::vector<NNFLOAT>> targets(37, std::vector<NNFLOAT>(2));
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    for (auto &input : inputs[i]) {
+      input = dist(data_gen);
+    }
+    targets[i] = {inputs[i][0] * inputs[i][1], inputs[i][2] - inputs[i][3]};
+  }
+  Dataset<NNFLOAT> dataset(inputs, targets);
+
+  bool passed = true;
+
+  std::mt19937 gen(7);
+  auto net = CreateNetwork();
+  auto checkpoints = std::make_shared<CheckpointLogger<NNFLOAT>>(path, 0, true);
+  NetworkTraining<NNFLOAT> training = CreateTraining(net, gen, {checkpoints});
+  for (size_t epoch = 0; epoch < 3; ++epoch) {
+    training.TrainEpoch(dataset, 8, true);
+  }
+  training.WaitForCheckpoints();
+
+  std::mt19937 resumed_gen(1234);
+  auto resumed_net = CreateNetwork();
+  NetworkTraining<NNFLOAT> resumed = CreateTraining(resumed_net, resumed_gen);
+  resumed.LoadState(path);
+
+  if (resumed.TrainingIterations() != training.TrainingIterations()) {
+    std::cout << "resumed at iteration " << resumed.TrainingIterations() << " instead of "
+              << training.TrainingIterations() << std::endl;
+    passed = false;
+  }
+  if (!SameParameters(net, resumed_net)) {
+    std::cout << "resumed parameters differ" << std::endl;
+    passed = false;
+  }
+
+  training.TrainEpoch(dataset, 8, true);
+  training.WaitForCheckpoints();
+  resumed.TrainEpoch(dataset, 8, true);
+
+  if (!SameParameters(net, resumed_net) || resumed.TrainingIterations() != training.TrainingIterations()) {
+    std::cout << "training diverged after resuming" << std::endl;
+    passed = false;
+  }
+
+  //the pruner resumes its schedule with the same masks instead of letting the pruned weights grow back
+  auto pruned_net = CreateNetwork();
+  NetworkTraining<NNFLOAT> pruned = CreateTraining(pruned_net, gen);
+  pruned.SetPruner(std::make_shared<MagnitudePruner<NNFLOAT>>(0.5, 0, 20, 2));
+  for (size_t epoch = 0; epoch < 2; ++epoch) {
+    pruned.TrainEpoch(dataset, 8, true);
+  }
+  pruned.SaveState(path);
+
+  auto resumed_pruned_net = CreateNetwork();
+  NetworkTraining<NNFLOAT> resumed_pruned = CreateTraining(resumed_pruned_net, resumed_gen);
+  resumed_pruned.SetPruner(std::make_shared<MagnitudePruner<NNFLOAT>>(0.5, 0, 20, 2));
+  resumed_pruned.LoadState(path);
+
+  if (resumed_pruned.Pruner()->Step() != pruned.Pruner()->Step()
+      || resumed_pruned.Pruner()->Sparsity() != pruned.Pruner()->Sparsity()
+      || resumed_pruned.Pruner()->Masks() != pruned.Pruner()->Masks()) {
+    std::cout << "pruner state was not restored" << std::endl;
+    passed = false;
+  }
+
+  pruned.TrainEpoch(dataset, 8, true);
+  resumed_pruned.TrainEpoch(dataset, 8, true);
+  if (!SameParameters(pruned_net, resumed_pruned_net)) {
+    std::cout << "pruned training diverged after resuming" << std::endl;
+    passed = false;
+  }
+
+  std::filesystem::remove(path);
+
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -9,33 +9,56 @@ namespace NeuralNet::Training {
    public:
 
     [[nodiscard]] dataType
-    Cost(const std::vector<dataType> &output, const std::vector<dataType> &target) const override {
-      assert(output.size() == target.size());
-
-      size_t output_size = output.size();
+    BatchCost(const dataType *outputs, const dataType *targets, size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
       dataType cost = 0;
       dataType diff;
 
-      for (size_t i = 0; i < output_size; ++i) {
-        diff = output[i] - target[i];
+      for (size_t i = 0; i < size; ++i) {
+        diff = outputs[i] - targets[i];
         cost += diff * diff;
       }
 
       return cost / static_cast<dataType>(2 * output_size);
     }
 
-    [[nodiscard]] std::vector<dataType>
-    Gradient(const std::vector<dataType> &output, const std::vector<dataType> &target) const override {
-      assert(output.size() == target.size());
+    void BatchGradient(const dataType *outputs, const dataType *targets, dataType *gradients,
+                       size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
+
+      for (size_t i = 0; i < size; ++i) {
+        gradients[i] = outputs[i] - targets[i];
+      }
+    }
+
+    [[nodiscard]] dataType
+    BatchCostLabels(const dataType *outputs, const uint32_t *labels, size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
+      dataType cost = 0;
 
-      size_t output_size = output.size();
-      std::vector<dataType> grad(output_size);
+      for (size_t i = 0; i < size; ++i) {
+        cost += outputs[i] * outputs[i];
+      }
 
-      for (size_t i = 0; i < output_size; ++i) {
-        grad[i] = output[i] - target[i];
+      //(o - 1)^2 instead of o^2 at the label
+      for (size_t i = 0; i < batch_size; ++i) {
+        assert(labels[i] < output_size);
+        cost += 1 - 2 * outputs[i * output_size + labels[i]];
       }
 
-      return grad;
+      return cost / static_cast<dataType>(2 * output_size);
+    }
+
+    void BatchGradientLabels(const dataType *outputs, const uint32_t *labels, dataType *gradients,
+                             size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
+
+      std::copy(outputs, outputs + size, gradients);
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        assert(labels[i] < output_size);
+        gradients[i * output_size + labels[i]] -= 1;
+      }
     }
   };
 
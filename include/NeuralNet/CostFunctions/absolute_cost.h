@@ -9,14 +9,12 @@ namespace NeuralNet::Training {
    public:
 
     [[nodiscard]] dataType
-    Cost(const std::vector<dataType> &output, const std::vector<dataType> &target) const override {
-      assert(output.size() == target.size());
-
-      size_t output_size = output.size();
+    BatchCost(const dataType *outputs, const dataType *targets, size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
       dataType cost = 0;
 
-      for (size_t i = 0; i < output_size; ++i) {
-        cost += std::abs(output[i] - target[i]);
+      for (size_t i = 0; i < size; ++i) {
+        cost += std::abs(outputs[i] - targets[i]);
       }
 
       cost /= static_cast<dataType>(output_size);
@@ -24,28 +22,64 @@ namespace NeuralNet::Training {
       return cost;
     }
 
-    [[nodiscard]] std::vector<dataType>
-    Gradient(const std::vector<dataType> &output, const std::vector<dataType> &target) const override {
-      assert(output.size() == target.size());
-
-      size_t output_size = output.size();
-      std::vector<dataType> grad(output_size);
+    void BatchGradient(const dataType *outputs, const dataType *targets, dataType *gradients,
+                       size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
       dataType diff;
 
-      for (size_t i = 0; i < output_size; ++i) {
-        diff = output[i] - target[i];
+      for (size_t i = 0; i < size; ++i) {
+        diff = outputs[i] - targets[i];
 
         if (diff > 0) {
-          grad[i] = 1;
+          gradients[i] = 1;
         } else if (diff < 0) {
-          grad[i] = -1;
+          gradients[i] = -1;
         } else {
-          grad[i] = 0;
+          gradients[i] = 0;
         }
       }
+    }
+
+    [[nodiscard]] dataType
+    BatchCostLabels(const dataType *outputs, const uint32_t *labels, size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
+      dataType cost = 0;
+
+      for (size_t i = 0; i < size; ++i) {
+        cost += std::abs(outputs[i]);
+      }
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        assert(labels[i] < output_size);
+        const dataType output = outputs[i * output_size + labels[i]];
+        cost += std::abs(output - 1) - std::abs(output);
+      }
+
+      cost /= static_cast<dataType>(output_size);
+
+      return cost;
+    }
+
+    void BatchGradientLabels(const dataType *outputs, const uint32_t *labels, dataType *gradients,
+                             size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
+
+      for (size_t i = 0; i < size; ++i) {
+        gradients[i] = Sign(outputs[i]);
+      }
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        assert(labels[i] < output_size);
+        const size_t index = i * output_size + labels[i];
+        gradients[index] = Sign(outputs[index] - 1);
+      }
+    }
+
+   private:
 
-      return grad;
+    static dataType Sign(dataType diff) {
+      return static_cast<dataType>((diff > 0) - (diff < 0));
     }
   };
 
-}
\ No newline at end of file
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
 #include <NeuralNet/misc/types.h>
 
 namespace NeuralNet::Training {
@@ -8,12 +13,61 @@ namespace NeuralNet::Training {
   class BaseCost {
    public:
 
+    virtual ~BaseCost() = default;
+
+    //sum of the costs of batch_size row-major outputs/targets
+    [[nodiscard]] virtual dataType
+    BatchCost(const dataType *outputs, const dataType *targets, size_t batch_size, size_t output_size) const = 0;
+
+    virtual void BatchGradient(const dataType *outputs, const dataType *targets, dataType *gradients,
+                               size_t batch_size, size_t output_size) const = 0;
+
+    //class index targets, one label per sample standing for a one-hot row of output_size values,
+    //the defaults expand one row at a time and costs override them to work from the labels directly
     [[nodiscard]] virtual dataType
-    Cost(const std::vector<dataType> &output, const std::vector<dataType> &target) const = 0;
+    BatchCostLabels(const dataType *outputs, const uint32_t *labels, size_t batch_size, size_t output_size) const {
+      std::vector<dataType> target(output_size);
+      dataType cost = 0;
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        OneHot(labels[i], target);
+        cost += BatchCost(outputs + i * output_size, target.data(), 1, output_size);
+      }
+
+      return cost;
+    }
+
+    virtual void BatchGradientLabels(const dataType *outputs, const uint32_t *labels, dataType *gradients,
+                                     size_t batch_size, size_t output_size) const {
+      std::vector<dataType> target(output_size);
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        OneHot(labels[i], target);
+        BatchGradient(outputs + i * output_size, target.data(), gradients + i * output_size, 1, output_size);
+      }
+    }
+
+    [[nodiscard]] dataType Cost(const std::vector<dataType> &output, const std::vector<dataType> &target) const {
+      assert(output.size() == target.size());
+      return BatchCost(output.data(), target.data(), 1, output.size());
+    }
+
+    [[nodiscard]] std::vector<dataType>
+    Gradient(const std::vector<dataType> &output, const std::vector<dataType> &target) const {
+      assert(output.size() == target.size());
+      std::vector<dataType> grad(output.size());
+      BatchGradient(output.data(), target.data(), grad.data(), 1, output.size());
+      return grad;
+    }
+
+   private:
 
-    [[nodiscard]] virtual std::vector<dataType>
-    Gradient(const std::vector<dataType> &output, const std::vector<dataType> &target) const = 0;
+    static void OneHot(uint32_t label, std::vector<dataType> &target) {
+      assert(label < target.size());
+      std::fill(target.begin(), target.end(), dataType(0));
+      target[label] = 1;
+    }
 
   };
 
-}
\ No newline at end of file
+}
@@ -9,31 +9,61 @@ namespace NeuralNet::Training {
    public:
 
     [[nodiscard]] dataType
-    Cost(const std::vector<dataType> &output, const std::vector<dataType> &target) const override {
-      assert(output.size() == target.size());
-
-      size_t output_size = output.size();
+    BatchCost(const dataType *outputs, const dataType *targets, size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
       dataType cost = 0;
 
-      for (size_t i = 0; i < output_size; ++i) {
-        cost += target[i] * std::log(output[i]) + (1 - target[i]) * std::log(1 - output[i]);
+      for (size_t i = 0; i < size; ++i) {
+        cost += targets[i] * std::log(outputs[i]) + (1 - targets[i]) * std::log(1 - outputs[i]);
       }
 
       return -cost;
     }
 
-    [[nodiscard]] std::vector<dataType>
-    Gradient(const std::vector<dataType> &output, const std::vector<dataType> &target) const override {
-      assert(output.size() == target.size());
+    void BatchGradient(const dataType *outputs, const dataType *targets, dataType *gradients,
+                       size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
+
+      for (size_t i = 0; i < size; ++i) {
+        gradients[i] = (outputs[i] - targets[i]) / (outputs[i] * (1 - outputs[i]));
+      }
+    }
+
+    //log(1 - o) for every output but the label, which contributes log(o)
+    [[nodiscard]] dataType
+    BatchCostLabels(const dataType *outputs, const uint32_t *labels, size_t batch_size, size_t output_size) const override {
+      dataType cost = 0;
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const dataType *output = outputs + i * output_size;
+        const size_t label = labels[i];
+        assert(label < output_size);
 
-      size_t output_size = output.size();
-      std::vector<dataType> grad(output_size);
+        for (size_t j = 0; j < label; ++j) {
+          cost += std::log(1 - output[j]);
+        }
+        cost += std::log(output[label]);
+        for (size_t j = label + 1; j < output_size; ++j) {
+          cost += std::log(1 - output[j]);
+        }
+      }
 
-      for (size_t i = 0; i < output_size; ++i) {
-        grad[i] = (output[i] - target[i]) / (output[i] * (1 - output[i]));
+      return -cost;
+    }
+
+    void BatchGradientLabels(const dataType *outputs, const uint32_t *labels, dataType *gradients,
+                             size_t batch_size, size_t output_size) const override {
+      const size_t size = batch_size * output_size;
+
+      for (size_t i = 0; i < size; ++i) {
+        gradients[i] = 1 / (1 - outputs[i]);
       }
 
-      return grad;
+      for (size_t i = 0; i < batch_size; ++i) {
+        assert(labels[i] < output_size);
+        const size_t index = i * output_size + labels[i];
+        gradients[index] = -1 / outputs[index];
+      }
     }
   };
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <random>
+
+#include <NeuralNet/misc/types.h>
+
+namespace NeuralNet::Training {
+
+  //transforms the rows of a gathered training batch in place, Apply is called concurrently from the
+  //loader threads so implementations must not modify their own state
+  template<std::floating_point dataType>
+  class BaseAugmentation {
+   public:
+
+    virtual ~BaseAugmentation() = default;
+
+    //inputs is row-major batch_size x input_size
+    virtual void Apply(dataType *inputs, size_t batch_size, size_t input_size, std::mt19937 &gen) const = 0;
+  };
+
+}
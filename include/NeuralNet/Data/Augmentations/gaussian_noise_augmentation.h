@@ -0,0 +1,27 @@
+#pragma once
+
+#include <NeuralNet/Data/Augmentations/base_augmentation.h>
+
+namespace NeuralNet::Training {
+
+  //adds independent normally distributed noise to every input
+  template<std::floating_point dataType = NNFLOAT>
+  class GaussianNoiseAugmentation : public BaseAugmentation<dataType> {
+   private:
+    dataType stddev_;
+
+   public:
+
+    explicit GaussianNoiseAugmentation(dataType stddev) : stddev_(stddev) {}
+
+    void Apply(dataType *inputs, size_t batch_size, size_t input_size, std::mt19937 &gen) const override {
+      std::normal_distribution<dataType> distribution(0, stddev_);
+
+      const size_t size = batch_size * input_size;
+      for (size_t i = 0; i < size; ++i) {
+        inputs[i] += distribution(gen);
+      }
+    }
+  };
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <NeuralNet/Data/Augmentations/base_augmentation.h>
+
+namespace NeuralNet::Training {
+
+  //zooms every image about its centre by a random factor in [min_scale, max_scale] with bilinear sampling,
+  //rows hold channel planes of height x width pixels and pixels sampled from outside the image are set to fill
+  template<std::floating_point dataType = NNFLOAT>
+  class ScaleAugmentation : public BaseAugmentation<dataType> {
+   private:
+    size_t width_;
+    size_t height_;
+    dataType min_scale_;
+    dataType max_scale_;
+    dataType fill_;
+
+   public:
+
+    ScaleAugmentation(size_t width, size_t height, dataType min_scale, dataType max_scale, dataType fill = 0)
+        : width_(width), height_(height), min_scale_(min_scale), max_scale_(max_scale), fill_(fill) {
+      assert(min_scale > 0 && min_scale <= max_scale);
+    }
+
+    void Apply(dataType *inputs, size_t batch_size, size_t input_size, std::mt19937 &gen) const override {
+      const size_t plane_size = width_ * height_;
+      assert(input_size % plane_size == 0);
+
+      std::uniform_real_distribution<dataType> distribution(min_scale_, max_scale_);
+      thread_local std::vector<dataType> plane;
+      plane.resize(plane_size);
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const dataType inverse_scale = 1 / distribution(gen);
+
+        for (dataType *channel = inputs + i * input_size; channel < inputs + (i + 1) * input_size;
+             channel += plane_size) {
+          std::copy(channel, channel + plane_size, plane.begin());
+          Resample(plane.data(), channel, inverse_scale);
+        }
+      }
+    }
+
+   private:
+
+    void Resample(const dataType *source, dataType *destination, dataType inverse_scale) const {
+      const dataType centre_x = static_cast<dataType>(width_ - 1) / 2;
+      const dataType centre_y = static_cast<dataType>(height_ - 1) / 2;
+
+      for (size_t y = 0; y < height_; ++y) {
+        const dataType source_y = (static_cast<dataType>(y) - centre_y) * inverse_scale + centre_y;
+
+        for (size_t x = 0; x < width_; ++x) {
+          const dataType source_x = (static_cast<dataType>(x) - centre_x) * inverse_scale + centre_x;
+          destination[y * width_ + x] = Sample(source, source_x, source_y);
+        }
+      }
+    }
+
+    dataType Sample(const dataType *source, dataType x, dataType y) const {
+      const dataType x0 = std::floor(x);
+      const dataType y0 = std::floor(y);
+      const dataType fx = x - x0;
+      const dataType fy = y - y0;
+
+      auto pixel = [&](dataType px, dataType py) {
+        if (px < 0 || py < 0 || px >= static_cast<dataType>(width_) || py >= static_cast<dataType>(height_)) {
+          return fill_;
+        }
+        return source[static_cast<size_t>(py) * width_ + static_cast<size_t>(px)];
+      };
+
+      const dataType top = pixel(x0, y0) * (1 - fx) + pixel(x0 + 1, y0) * fx;
+      const dataType bottom = pixel(x0, y0 + 1) * (1 - fx) + pixel(x0 + 1, y0 + 1) * fx;
+      return top * (1 - fy) + bottom * fy;
+    }
+  };
+
+}
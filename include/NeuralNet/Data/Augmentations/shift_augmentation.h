@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include <NeuralNet/Data/Augmentations/base_augmentation.h>
+
+namespace NeuralNet::Training {
+
+  //moves every image by a random whole number of pixels in [-max_shift, max_shift] along both axes,
+  //rows hold channel planes of height x width pixels and uncovered pixels are set to fill
+  template<std::floating_point dataType = NNFLOAT>
+  class ShiftAugmentation : public BaseAugmentation<dataType> {
+   private:
+    size_t width_;
+    size_t height_;
+    int max_shift_;
+    dataType fill_;
+
+   public:
+
+    ShiftAugmentation(size_t width, size_t height, int max_shift, dataType fill = 0)
+        : width_(width), height_(height), max_shift_(max_shift), fill_(fill) {}
+
+    void Apply(dataType *inputs, size_t batch_size, size_t input_size, std::mt19937 &gen) const override {
+      const size_t plane_size = width_ * height_;
+      assert(input_size % plane_size == 0);
+
+      std::uniform_int_distribution<int> distribution(-max_shift_, max_shift_);
+      thread_local std::vector<dataType> plane;
+      plane.resize(plane_size);
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const int dx = distribution(gen);
+        const int dy = distribution(gen);
+        if (dx == 0 && dy == 0) {
+          continue;
+        }
+
+        for (dataType *channel = inputs + i * input_size; channel < inputs + (i + 1) * input_size;
+             channel += plane_size) {
+          std::copy(channel, channel + plane_size, plane.begin());
+          Shift(plane.data(), channel, dx, dy);
+        }
+      }
+    }
+
+   private:
+
+    void Shift(const dataType *source, dataType *destination, int dx, int dy) const {
+      const int width = static_cast<int>(width_);
+      const int height = static_cast<int>(height_);
+
+      //destination columns [x_begin, x_end) are covered by the shifted source
+      const int x_begin = std::clamp(dx, 0, width);
+      const int x_end = std::clamp(width + dx, 0, width);
+
+      for (int y = 0; y < height; ++y) {
+        dataType *row = destination + y * width;
+        const int source_y = y - dy;
+
+        if (source_y < 0 || source_y >= height || x_begin >= x_end) {
+          std::fill(row, row + width, fill_);
+          continue;
+        }
+
+        std::fill(row, row + x_begin, fill_);
+        std::copy(source + source_y * width + (x_begin - dx), source + source_y * width + (x_end - dx), row + x_begin);
+        std::fill(row + x_end, row + width, fill_);
+      }
+    }
+  };
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <random>
+#include <vector>
+
+namespace NeuralNet::Training {
+
+  class BaseSampler {
+   public:
+
+    virtual ~BaseSampler() = default;
+
+    //fills indices with the samples an epoch over a dataset of dataset_size samples visits, in visiting order
+    virtual void Sample(size_t dataset_size, std::vector<size_t> &indices, std::mt19937 &gen) = 0;
+  };
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <numeric>
+
+#include <NeuralNet/Data/Samplers/base_sampler.h>
+
+namespace NeuralNet::Training {
+
+  class SequentialSampler : public BaseSampler {
+   public:
+
+    void Sample(size_t dataset_size, std::vector<size_t> &indices, std::mt19937 &) override {
+      indices.resize(dataset_size);
+      std::iota(indices.begin(), indices.end(), 0);
+    }
+  };
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <numeric>
+#include <algorithm>
+
+#include <NeuralNet/Data/Samplers/base_sampler.h>
+
+namespace NeuralNet::Training {
+
+  //visits every sample exactly once per epoch in a fresh random order
+  class ShuffleSampler : public BaseSampler {
+   public:
+
+    void Sample(size_t dataset_size, std::vector<size_t> &indices, std::mt19937 &gen) override {
+      //indices may hold the draws of another sampler or a restored state, so they are reset to every sample once
+      indices.resize(dataset_size);
+      std::iota(indices.begin(), indices.end(), 0);
+      std::shuffle(indices.begin(), indices.end(), gen);
+    }
+  };
+
+}
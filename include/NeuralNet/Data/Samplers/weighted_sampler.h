@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cassert>
+
+#include <NeuralNet/Data/Samplers/base_sampler.h>
+
+namespace NeuralNet::Training {
+
+  //draws samples with replacement, proportional to their weight
+  class WeightedSampler : public BaseSampler {
+   private:
+    std::discrete_distribution<size_t> dist_;
+    size_t samples_per_epoch_;
+
+   public:
+
+    //samples_per_epoch of 0 means one draw per sample of the dataset
+    explicit WeightedSampler(const std::vector<double> &weights, size_t samples_per_epoch = 0)
+        : dist_(weights.begin(), weights.end()), samples_per_epoch_(samples_per_epoch) {}
+
+    void Sample(size_t dataset_size, std::vector<size_t> &indices, std::mt19937 &gen) override {
+      assert(dist_.probabilities().size() == dataset_size);
+
+      indices.resize(samples_per_epoch_ ? samples_per_epoch_ : dataset_size);
+
+      for (auto &index : indices) {
+        index = dist_(gen);
+      }
+    }
+  };
+
+}
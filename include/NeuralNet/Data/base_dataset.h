@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+
+#include <NeuralNet/misc/types.h>
+#include <NeuralNet/misc/input_format.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType>
+  class BaseDataset {
+   public:
+
+    virtual ~BaseDataset() = default;
+
+    [[nodiscard]] virtual size_t Size() const = 0;
+
+    [[nodiscard]] virtual size_t InputSize() const = 0;
+
+    [[nodiscard]] virtual size_t TargetSize() const = 0;
+
+    //copies the samples at indices into the row-major batch buffers inputs (count x InputSize())
+    //and targets (count x TargetSize()), targets may be null to gather the inputs only
+    virtual void Gather(const size_t *indices, size_t count, dataType *inputs, dataType *targets) const = 0;
+
+    //whether every target is a single class out of TargetSize(), which can then be gathered as an index
+    //instead of a one-hot row
+    [[nodiscard]] virtual bool HasLabels() const {
+      return false;
+    }
+
+    virtual void GatherLabels(const size_t *, size_t, uint32_t *) const {
+      throw std::runtime_error("Dataset has no class labels");
+    }
+
+    //datasets storing uint8/int16 inputs report their encoding so the first layer can dequantize them itself
+    [[nodiscard]] virtual InputFormat<dataType> EncodedInputFormat() const {
+      return {};
+    }
+
+    //like Gather, but the input rows are written as described by EncodedInputFormat()
+    virtual void GatherEncoded(const size_t *indices, size_t count, void *inputs, dataType *targets) const {
+      Gather(indices, count, static_cast<dataType *>(inputs), targets);
+    }
+  };
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+#include <NeuralNet/misc/types.h>
+
+namespace NeuralNet {
+
+  //dataset that can only be read front to back, one pass per epoch
+  template<std::floating_point dataType>
+  class BaseStreamDataset {
+   public:
+
+    virtual ~BaseStreamDataset() = default;
+
+    [[nodiscard]] virtual size_t Size() const = 0;
+
+    [[nodiscard]] virtual size_t InputSize() const = 0;
+
+    [[nodiscard]] virtual size_t TargetSize() const = 0;
+
+    //starts a new pass over all samples, seed drives whatever shuffling the stream does while reading
+    virtual void Restart(uint64_t seed) = 0;
+
+    //reads up to count samples of the current pass into the row-major buffers inputs and targets,
+    //returns the number read which is only smaller than count at the end of the pass
+    virtual size_t Read(size_t count, dataType *inputs, dataType *targets) = 0;
+  };
+
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <memory>
+#include <random>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <exception>
+
+#include <NeuralNet/misc/types.h>
+#include <NeuralNet/misc/spsc_queue.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType>
+  struct Batch {
+    AlignedVector<dataType> inputs;
+    AlignedVector<dataType> targets;
+    std::vector<uint32_t> labels;
+    size_t size = 0;
+    size_t index = 0;
+  };
+
+  //assembles upcoming batches on background worker threads while the current one trains,
+  //worker w produces batches w, w + workers, ... and hands full and empty buffers to the training
+  //thread through its own pair of SPSC queues, so batches are still consumed in order
+  template<std::floating_point dataType>
+  class BatchPrefetcher {
+   public:
+    //gen belongs to the worker thread calling the producer
+    typedef std::function<void(Batch<dataType> &batch, std::mt19937 &gen)> Producer;
+
+   private:
+    struct Lane {
+      std::vector<Batch<dataType>> batches;
+      SPSCQueue<Batch<dataType> *> ready;
+      SPSCQueue<Batch<dataType> *> free;
+
+      std::thread worker;
+      std::exception_ptr error;
+      std::mt19937 gen;
+
+      explicit Lane(size_t buffers) : batches(buffers), ready(buffers + 1), free(buffers + 1) {}
+    };
+
+    size_t depth_;
+    std::vector<std::unique_ptr<Lane>> lanes_;
+
+    std::atomic<bool> stop_ = false;
+
+    size_t next_index_ = 0;
+    Lane *current_lane_ = nullptr;
+    Batch<dataType> *current_ = nullptr;
+
+   public:
+
+    //depth batches can be assembled ahead of the one currently training
+    explicit BatchPrefetcher(size_t depth) : depth_(depth) {}
+
+    BatchPrefetcher(const BatchPrefetcher &) = delete;
+    BatchPrefetcher &operator=(const BatchPrefetcher &) = delete;
+
+    ~BatchPrefetcher() {
+      Stop();
+    }
+
+    [[nodiscard]] size_t Depth() const {
+      return depth_;
+    }
+
+    //produce is called on the worker threads for batches 0 .. batches_count - 1 with batch.index set,
+    //it has to fill batch.inputs/targets or labels (sized for max_batch_size rows) and set batch.size,
+    //target_size is 0 when the batches carry labels, at most Depth() workers are started
+    void Start(size_t batches_count, size_t max_batch_size, size_t input_size, size_t target_size, Producer produce,
+               size_t workers = 1) {
+      Stop();
+
+      workers = std::max<size_t>(1, std::min(workers, depth_));
+      if (lanes_.size() != workers) {
+        //every lane holds its share of the depth plus the buffer being trained on
+        const size_t buffers = (depth_ + workers - 1) / workers + 1;
+
+        lanes_.clear();
+        for (size_t w = 0; w < workers; ++w) {
+          lanes_.push_back(std::make_unique<Lane>(buffers));
+        }
+      }
+
+      stop_ = false;
+      next_index_ = 0;
+      current_lane_ = nullptr;
+      current_ = nullptr;
+
+      for (size_t w = 0; w < workers; ++w) {
+        Lane &lane = *lanes_[w];
+        lane.ready.Clear();
+        lane.free.Clear();
+        lane.error = nullptr;
+
+        for (auto &batch : lane.batches) {
+          batch.inputs.resize(max_batch_size * input_size);
+          batch.targets.resize(max_batch_size * target_size);
+          batch.labels.resize(target_size == 0 ? max_batch_size : 0);
+          lane.free.Push(&batch);
+        }
+
+        lane.worker = std::thread([this, &lane, w, workers, batches_count, produce]() {
+          try {
+            for (size_t i = w; i < batches_count; i += workers) {
+              Batch<dataType> *batch = lane.free.Pop();
+              if (!batch || stop_) {
+                return;
+              }
+
+              batch->index = i;
+              produce(*batch, lane.gen);
+              lane.ready.Push(batch);
+            }
+          } catch (...) {
+            lane.error = std::current_exception();
+            lane.ready.Push(nullptr);
+          }
+        });
+      }
+    }
+
+    //blocks until the next batch is ready, the previously returned batch goes back to its worker
+    const Batch<dataType> &Next() {
+      if (current_) {
+        current_lane_->free.Push(current_);
+      }
+
+      current_lane_ = lanes_[next_index_++ % lanes_.size()].get();
+      current_ = current_lane_->ready.Pop();
+
+      if (!current_) {
+        Stop();
+        std::rethrow_exception(current_lane_->error);
+      }
+
+      return *current_;
+    }
+
+    void Stop() {
+      stop_ = true;
+
+      for (auto &lane : lanes_) {
+        if (lane->worker.joinable()) {
+          lane->free.TryPush(nullptr);
+          lane->worker.join();
+        }
+      }
+    }
+  };
+
+}
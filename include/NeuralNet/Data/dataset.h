@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Data/base_dataset.h>
+
+namespace NeuralNet {
+
+  //inputs and targets stored as one contiguous row-major block each,
+  //classification targets can be stored as one class index per sample instead
+  template<std::floating_point dataType = NNFLOAT>
+  class Dataset : public BaseDataset<dataType> {
+   private:
+    size_t size_;
+    size_t input_size_;
+    size_t target_size_;
+
+    AlignedVector<dataType> inputs_;
+    AlignedVector<dataType> targets_;
+    std::vector<uint32_t> labels_;
+
+   public:
+
+    Dataset(size_t size, size_t input_size, size_t target_size) :
+        size_(size), input_size_(input_size), target_size_(target_size),
+        inputs_(size * input_size), targets_(size * target_size) {}
+
+    Dataset(const std::vector<std::vector<dataType>> &inputs, const std::vector<std::vector<dataType>> &targets) :
+        Dataset(inputs.size(), inputs.empty() ? 0 : inputs[0].size(), targets.empty() ? 0 : targets[0].size()) {
+      assert(inputs.size() == targets.size());
+
+      for (size_t i = 0; i < size_; ++i) {
+        assert(inputs[i].size() == input_size_);
+        assert(targets[i].size() == target_size_);
+
+        std::copy(inputs[i].begin(), inputs[i].end(), Input(i));
+        std::copy(targets[i].begin(), targets[i].end(), Target(i));
+      }
+    }
+
+    //target_size is the number of classes, targets are set through Label()
+    static Dataset Labeled(size_t size, size_t input_size, size_t classes) {
+      Dataset dataset(0, input_size, classes);
+      dataset.size_ = size;
+      dataset.inputs_.resize(size * input_size);
+      dataset.labels_.resize(size);
+      return dataset;
+    }
+
+    Dataset(const std::vector<std::vector<dataType>> &inputs, const std::vector<uint32_t> &labels, size_t classes) :
+        Dataset(Labeled(inputs.size(), inputs.empty() ? 0 : inputs[0].size(), classes)) {
+      assert(inputs.size() == labels.size());
+
+      for (size_t i = 0; i < size_; ++i) {
+        assert(inputs[i].size() == input_size_);
+        assert(labels[i] < classes);
+
+        std::copy(inputs[i].begin(), inputs[i].end(), Input(i));
+      }
+      labels_ = labels;
+    }
+
+    [[nodiscard]] size_t Size() const override {
+      return size_;
+    }
+
+    [[nodiscard]] size_t InputSize() const override {
+      return input_size_;
+    }
+
+    [[nodiscard]] size_t TargetSize() const override {
+      return target_size_;
+    }
+
+    [[nodiscard]] dataType *Input(size_t index) {
+      return inputs_.data() + index * input_size_;
+    }
+
+    [[nodiscard]] const dataType *Input(size_t index) const {
+      return inputs_.data() + index * input_size_;
+    }
+
+    [[nodiscard]] dataType *Target(size_t index) {
+      return targets_.data() + index * target_size_;
+    }
+
+    [[nodiscard]] const dataType *Target(size_t index) const {
+      return targets_.data() + index * target_size_;
+    }
+
+    [[nodiscard]] uint32_t &Label(size_t index) {
+      return labels_[index];
+    }
+
+    [[nodiscard]] uint32_t Label(size_t index) const {
+      return labels_[index];
+    }
+
+    [[nodiscard]] bool HasLabels() const override {
+      return !labels_.empty();
+    }
+
+    void Gather(const size_t *indices, size_t count, dataType *inputs, dataType *targets) const override {
+      for (size_t i = 0; i < count; ++i) {
+        const size_t index = indices[i];
+
+        std::copy_n(Input(index), input_size_, inputs + i * input_size_);
+
+        if (!targets) {
+          continue;
+        }
+
+        dataType *target = targets + i * target_size_;
+        if (HasLabels()) {
+          std::fill_n(target, target_size_, dataType(0));
+          target[Label(index)] = 1;
+        } else {
+          std::copy_n(Target(index), target_size_, target);
+        }
+      }
+    }
+
+    void GatherLabels(const size_t *indices, size_t count, uint32_t *labels) const override {
+      assert(HasLabels());
+
+      for (size_t i = 0; i < count; ++i) {
+        labels[i] = Label(indices[i]);
+      }
+    }
+  };
+
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/Data/base_dataset.h>
+
+namespace NeuralNet {
+
+  //unsigned byte IDX file (the MNIST format) mapped into memory, Dims()[0] is the number of items
+  class IDXFile {
+   private:
+    MappedFile file_;
+    std::vector<size_t> dims_;
+    const uint8_t *data_ = nullptr;
+
+   public:
+
+    explicit IDXFile(const std::string &filepath) : file_(filepath) {
+      const uint8_t *header = file_.Data();
+
+      if (file_.Size() < 4 || header[0] != 0 || header[1] != 0) {
+        throw std::runtime_error("Not an IDX file: " + filepath);
+      }
+      if (header[2] != 0x08) {
+        throw std::runtime_error("Only unsigned byte IDX files are supported: " + filepath);
+      }
+
+      const size_t dims_count = header[3];
+      const size_t header_size = 4 + 4 * dims_count;
+      if (dims_count == 0 || file_.Size() < header_size) {
+        throw std::runtime_error("Truncated IDX header: " + filepath);
+      }
+
+      size_t elements = 1;
+      for (size_t i = 0; i < dims_count; ++i) {
+        const uint8_t *dim = header + 4 + 4 * i;
+        dims_.push_back((size_t(dim[0]) << 24) | (size_t(dim[1]) << 16) | (size_t(dim[2]) << 8) | size_t(dim[3]));
+        elements *= dims_.back();
+      }
+
+      if (file_.Size() < header_size + elements) {
+        throw std::runtime_error("Truncated IDX data: " + filepath);
+      }
+
+      data_ = header + header_size;
+    }
+
+    [[nodiscard]] const std::vector<size_t> &Dims() const {
+      return dims_;
+    }
+
+    [[nodiscard]] size_t Items() const {
+      return dims_[0];
+    }
+
+    //number of bytes of a single item
+    [[nodiscard]] size_t ItemSize() const {
+      size_t item_size = 1;
+      for (size_t i = 1; i < dims_.size(); ++i) {
+        item_size *= dims_[i];
+      }
+      return item_size;
+    }
+
+    [[nodiscard]] const uint8_t *Item(size_t index) const {
+      return data_ + index * ItemSize();
+    }
+
+    [[nodiscard]] const uint8_t *Data() const {
+      return data_;
+    }
+  };
+
+  //images and class labels read straight from mapped IDX files, rows are only converted to
+  //pixel * scale + offset and one-hot targets when a batch is gathered
+  template<std::floating_point dataType = NNFLOAT>
+  class IDXDataset : public BaseDataset<dataType> {
+   private:
+    IDXFile images_;
+    IDXFile labels_;
+
+    size_t input_size_;
+    size_t classes_;
+
+    dataType scale_;
+    dataType offset_;
+
+   public:
+
+    IDXDataset(const std::string &images_filepath,
+               const std::string &labels_filepath,
+               size_t classes,
+               dataType scale = dataType(1) / 255,
+               dataType offset = 0)
+        : images_(images_filepath), labels_(labels_filepath), input_size_(images_.ItemSize()), classes_(classes),
+          scale_(scale), offset_(offset) {
+      if (images_.Items() != labels_.Items() || labels_.ItemSize() != 1) {
+        throw std::runtime_error("IDX images and labels do not match: " + images_filepath + ", " + labels_filepath);
+      }
+
+      const uint8_t *labels = labels_.Data();
+      if (std::any_of(labels, labels + labels_.Items(), [classes](uint8_t label) { return label >= classes; })) {
+        throw std::runtime_error("IDX label out of range: " + labels_filepath);
+      }
+    }
+
+    [[nodiscard]] size_t Size() const override {
+      return images_.Items();
+    }
+
+    [[nodiscard]] size_t InputSize() const override {
+      return input_size_;
+    }
+
+    [[nodiscard]] size_t TargetSize() const override {
+      return classes_;
+    }
+
+    [[nodiscard]] const uint8_t *Image(size_t index) const {
+      return images_.Item(index);
+    }
+
+    [[nodiscard]] uint8_t Label(size_t index) const {
+      return labels_.Data()[index];
+    }
+
+    void Gather(const size_t *indices, size_t count, dataType *inputs, dataType *targets) const override {
+      for (size_t i = 0; i < count; ++i) {
+        const uint8_t *image = Image(indices[i]);
+        dataType *input = inputs + i * input_size_;
+
+        for (size_t j = 0; j < input_size_; ++j) {
+          input[j] = static_cast<dataType>(image[j]) * scale_ + offset_;
+        }
+
+        if (targets) {
+          GatherTarget(indices[i], targets + i * classes_);
+        }
+      }
+    }
+
+    [[nodiscard]] bool HasLabels() const override {
+      return true;
+    }
+
+    void GatherLabels(const size_t *indices, size_t count, uint32_t *labels) const override {
+      for (size_t i = 0; i < count; ++i) {
+        labels[i] = Label(indices[i]);
+      }
+    }
+
+    [[nodiscard]] InputFormat<dataType> EncodedInputFormat() const override {
+      return {InputElement::UInt8, scale_, offset_};
+    }
+
+    void GatherEncoded(const size_t *indices, size_t count, void *inputs, dataType *targets) const override {
+      uint8_t *rows = static_cast<uint8_t *>(inputs);
+
+      for (size_t i = 0; i < count; ++i) {
+        std::memcpy(rows + i * input_size_, Image(indices[i]), input_size_);
+        if (targets) {
+          GatherTarget(indices[i], targets + i * classes_);
+        }
+      }
+    }
+
+   private:
+
+    void GatherTarget(size_t index, dataType *target) const {
+      std::fill(target, target + classes_, dataType(0));
+      target[Label(index)] = 1;
+    }
+  };
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace NeuralNet::ShardFormat {
+
+  //index file:  IndexHeader, then per shard: uint64 samples, uint64 name length, name (relative to the index)
+  //shard file:  ShardHeader padded to kShardHeaderSize, then samples as input_size + target_size values each
+
+  constexpr char kIndexMagic[8] = {'N', 'N', 'S', 'I', 'N', 'D', 'E', 'X'};
+  constexpr char kShardMagic[8] = {'N', 'N', 'S', 'H', 'A', 'R', 'D', '\0'};
+  constexpr uint32_t kVersion = 1;
+  constexpr size_t kShardHeaderSize = 64;
+
+  struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t value_size;
+    uint64_t input_size;
+    uint64_t target_size;
+    uint64_t shards;
+  };
+
+  struct ShardHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t value_size;
+    uint64_t input_size;
+    uint64_t target_size;
+    uint64_t samples;
+  };
+
+  static_assert(sizeof(ShardHeader) <= kShardHeaderSize);
+
+  inline std::string Directory(const std::string &filepath) {
+    const size_t separator = filepath.find_last_of('/');
+    return separator == std::string::npos ? std::string() : filepath.substr(0, separator + 1);
+  }
+
+}
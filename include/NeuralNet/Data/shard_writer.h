@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <NeuralNet/misc/types.h>
+#include <NeuralNet/Data/base_dataset.h>
+#include <NeuralNet/Data/shard_format.h>
+
+namespace NeuralNet {
+
+  //writes samples into shards of samples_per_shard samples each (prefix-00000.shard, ...) and the
+  //prefix.index file that ShardedDataset opens
+  template<std::floating_point dataType = NNFLOAT>
+  class ShardWriter {
+   private:
+    std::string prefix_;
+    size_t input_size_;
+    size_t target_size_;
+    size_t samples_per_shard_;
+
+    std::ofstream shard_;
+    std::string shard_path_;
+    std::vector<std::string> shard_names_;
+    std::vector<uint64_t> shard_samples_;
+    bool closed_ = false;
+
+   public:
+
+    ShardWriter(std::string prefix, size_t input_size, size_t target_size, size_t samples_per_shard)
+        : prefix_(std::move(prefix)), input_size_(input_size), target_size_(target_size),
+          samples_per_shard_(samples_per_shard) {
+      if (samples_per_shard_ == 0) {
+        throw std::runtime_error("Shards need at least one sample");
+      }
+    }
+
+    ~ShardWriter() {
+      if (!closed_) {
+        try {
+          Close();
+        } catch (...) {}
+      }
+    }
+
+    void Write(const dataType *input, const dataType *target) {
+      if (!shard_.is_open() || shard_samples_.back() == samples_per_shard_) {
+        OpenShard();
+      }
+
+      shard_.write(reinterpret_cast<const char *>(input), sizeof(dataType) * input_size_);
+      shard_.write(reinterpret_cast<const char *>(target), sizeof(dataType) * target_size_);
+      if (!shard_) {
+        throw std::runtime_error("Failed to write shard: " + shard_path_);
+      }
+      ++shard_samples_.back();
+    }
+
+    void Write(const BaseDataset<dataType> &dataset) {
+      std::vector<dataType> input(input_size_);
+      std::vector<dataType> target(target_size_);
+
+      for (size_t i = 0; i < dataset.Size(); ++i) {
+        dataset.Gather(&i, 1, input.data(), target.data());
+        Write(input.data(), target.data());
+      }
+    }
+
+    void Close() {
+      closed_ = true;
+      CloseShard();
+
+      std::ofstream os(prefix_ + ".index", std::ios::binary);
+      if (!os.is_open()) {
+        throw std::runtime_error("Failed to open file for writing: " + prefix_ + ".index");
+      }
+
+      ShardFormat::IndexHeader header{};
+      std::memcpy(header.magic, ShardFormat::kIndexMagic, sizeof(header.magic));
+      header.version = ShardFormat::kVersion;
+      header.value_size = sizeof(dataType);
+      header.input_size = input_size_;
+      header.target_size = target_size_;
+      header.shards = shard_names_.size();
+      os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+      for (size_t i = 0; i < shard_names_.size(); ++i) {
+        const uint64_t name_length = shard_names_[i].size();
+        os.write(reinterpret_cast<const char *>(&shard_samples_[i]), sizeof(uint64_t));
+        os.write(reinterpret_cast<const char *>(&name_length), sizeof(name_length));
+        os.write(shard_names_[i].data(), static_cast<std::streamsize>(name_length));
+      }
+
+      os.close();
+      if (!os) {
+        throw std::runtime_error("Failed to write shard index: " + prefix_ + ".index");
+      }
+    }
+
+   private:
+
+    void OpenShard() {
+      CloseShard();
+
+      char number[16];
+      std::snprintf(number, sizeof(number), "-%05zu.shard", shard_names_.size());
+      shard_path_ = prefix_ + number;
+
+      shard_.open(shard_path_, std::ios::binary);
+      if (!shard_.is_open()) {
+        throw std::runtime_error("Failed to open file for writing: " + shard_path_);
+      }
+
+      shard_names_.push_back(shard_path_.substr(ShardFormat::Directory(shard_path_).size()));
+      shard_samples_.push_back(0);
+
+      char header[ShardFormat::kShardHeaderSize] = {};
+      shard_.write(header, sizeof(header));
+      if (!shard_) {
+        throw std::runtime_error("Failed to write shard: " + shard_path_);
+      }
+    }
+
+    void CloseShard() {
+      if (!shard_.is_open()) {
+        return;
+      }
+
+      ShardFormat::ShardHeader header{};
+      std::memcpy(header.magic, ShardFormat::kShardMagic, sizeof(header.magic));
+      header.version = ShardFormat::kVersion;
+      header.value_size = sizeof(dataType);
+      header.input_size = input_size_;
+      header.target_size = target_size_;
+      header.samples = shard_samples_.back();
+
+      //close also flushes the buffered samples, so a full disk may only show here
+      shard_.seekp(0);
+      shard_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      shard_.close();
+      if (!shard_) {
+        throw std::runtime_error("Failed to write shard: " + shard_path_);
+      }
+    }
+  };
+
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Data/base_stream_dataset.h>
+#include <NeuralNet/Data/shard_format.h>
+
+namespace NeuralNet {
+
+  //streams the shards written by ShardWriter with large sequential reads, so the data never has to fit into memory.
+  //every pass visits the shards in a new random order and mixes samples through a bounded shuffle buffer
+  template<std::floating_point dataType = NNFLOAT>
+  class ShardedDataset : public BaseStreamDataset<dataType> {
+   private:
+    std::string directory_;
+    std::vector<std::string> shard_paths_;
+    std::vector<uint64_t> shard_samples_;
+
+    size_t size_ = 0;
+    size_t input_size_ = 0;
+    size_t target_size_ = 0;
+    size_t record_size_ = 0;
+
+    size_t shuffle_buffer_size_;
+    size_t read_size_;
+
+    std::mt19937_64 gen_;
+    std::vector<size_t> shard_order_;
+    size_t next_shard_ = 0;
+
+    std::FILE *file_ = nullptr;
+    std::vector<char> chunk_;
+    size_t chunk_position_ = 0;
+    size_t chunk_end_ = 0;
+    uint64_t shard_remaining_ = 0;
+
+    AlignedVector<dataType> shuffle_buffer_;
+    size_t shuffle_fill_ = 0;
+    bool shuffle_buffer_primed_ = false;
+
+   public:
+
+    //shuffle_buffer_size samples are kept in memory for shuffling (0 streams in shard order),
+    //read_size is the number of bytes requested from the file per read
+    explicit ShardedDataset(const std::string &index_filepath,
+                            size_t shuffle_buffer_size = 8192,
+                            size_t read_size = 8 << 20)
+        : directory_(ShardFormat::Directory(index_filepath)), shuffle_buffer_size_(shuffle_buffer_size),
+          read_size_(read_size) {
+      std::ifstream is(index_filepath, std::ios::binary);
+      if (!is.is_open()) {
+        throw std::runtime_error("Failed to open file for reading: " + index_filepath);
+      }
+
+      ShardFormat::IndexHeader header{};
+      is.read(reinterpret_cast<char *>(&header), sizeof(header));
+      if (!is || std::memcmp(header.magic, ShardFormat::kIndexMagic, sizeof(header.magic)) != 0
+          || header.version != ShardFormat::kVersion) {
+        throw std::runtime_error("Not a shard index: " + index_filepath);
+      }
+      if (header.value_size != sizeof(dataType)) {
+        throw std::runtime_error("Shard value type does not match the dataset type: " + index_filepath);
+      }
+
+      input_size_ = header.input_size;
+      target_size_ = header.target_size;
+      record_size_ = input_size_ + target_size_;
+
+      for (uint64_t i = 0; i < header.shards; ++i) {
+        uint64_t samples, name_length;
+        is.read(reinterpret_cast<char *>(&samples), sizeof(samples));
+        is.read(reinterpret_cast<char *>(&name_length), sizeof(name_length));
+
+        std::string name(name_length, '\0');
+        is.read(name.data(), static_cast<std::streamsize>(name_length));
+        if (!is) {
+          throw std::runtime_error("Truncated shard index: " + index_filepath);
+        }
+
+        shard_paths_.push_back(directory_ + name);
+        shard_samples_.push_back(samples);
+        size_ += samples;
+      }
+
+      read_size_ = std::max(read_size_, record_size_ * sizeof(dataType));
+      chunk_.resize(read_size_);
+      shuffle_buffer_.resize(shuffle_buffer_size_ * record_size_);
+
+      Restart(0);
+    }
+
+    ShardedDataset(const ShardedDataset &) = delete;
+    ShardedDataset &operator=(const ShardedDataset &) = delete;
+
+    ~ShardedDataset() override {
+      CloseShard();
+    }
+
+    [[nodiscard]] size_t Size() const override {
+      return size_;
+    }
+
+    [[nodiscard]] size_t InputSize() const override {
+      return input_size_;
+    }
+
+    [[nodiscard]] size_t TargetSize() const override {
+      return target_size_;
+    }
+
+    [[nodiscard]] size_t ShardsSize() const {
+      return shard_paths_.size();
+    }
+
+    void Restart(uint64_t seed) override {
+      CloseShard();
+      gen_.seed(seed);
+
+      shard_order_.resize(shard_paths_.size());
+      std::iota(shard_order_.begin(), shard_order_.end(), 0);
+      if (shuffle_buffer_size_ != 0) {
+        std::shuffle(shard_order_.begin(), shard_order_.end(), gen_);
+      }
+
+      next_shard_ = 0;
+      shuffle_fill_ = 0;
+      shuffle_buffer_primed_ = false;
+    }
+
+    size_t Read(size_t count, dataType *inputs, dataType *targets) override {
+      //filled on the first read so that the cost lands on the thread doing the reading
+      if (!shuffle_buffer_primed_) {
+        while (shuffle_fill_ < shuffle_buffer_size_
+            && ReadRecord(shuffle_buffer_.data() + shuffle_fill_ * record_size_)) {
+          ++shuffle_fill_;
+        }
+        shuffle_buffer_primed_ = true;
+      }
+
+      for (size_t i = 0; i < count; ++i) {
+        dataType *input = inputs + i * input_size_;
+        dataType *target = targets + i * target_size_;
+
+        if (shuffle_buffer_size_ == 0) {
+          if (!ReadRecord(input, target)) {
+            return i;
+          }
+          continue;
+        }
+
+        if (shuffle_fill_ == 0) {
+          return i;
+        }
+
+        //emit a random buffered sample and refill its slot from the stream
+        const size_t slot = std::uniform_int_distribution<size_t>(0, shuffle_fill_ - 1)(gen_);
+        dataType *record = shuffle_buffer_.data() + slot * record_size_;
+
+        std::copy_n(record, input_size_, input);
+        std::copy_n(record + input_size_, target_size_, target);
+
+        if (!ReadRecord(record)) {
+          --shuffle_fill_;
+          std::copy_n(shuffle_buffer_.data() + shuffle_fill_ * record_size_, record_size_, record);
+        }
+      }
+
+      return count;
+    }
+
+   private:
+
+    bool ReadRecord(dataType *record) {
+      return ReadRecord(record, record + input_size_);
+    }
+
+    bool ReadRecord(dataType *input, dataType *target) {
+      while (shard_remaining_ == 0) {
+        if (next_shard_ == shard_order_.size()) {
+          return false;
+        }
+        OpenShard(shard_order_[next_shard_++]);
+      }
+
+      ReadValues(reinterpret_cast<char *>(input), sizeof(dataType) * input_size_);
+      ReadValues(reinterpret_cast<char *>(target), sizeof(dataType) * target_size_);
+      --shard_remaining_;
+      return true;
+    }
+
+    void ReadValues(char *destination, size_t bytes) {
+      while (bytes != 0) {
+        if (chunk_position_ == chunk_end_) {
+          chunk_end_ = std::fread(chunk_.data(), 1, chunk_.size(), file_);
+          chunk_position_ = 0;
+          if (chunk_end_ == 0) {
+            throw std::runtime_error("Shard ended before all of its samples were read");
+          }
+        }
+
+        const size_t available = std::min(bytes, chunk_end_ - chunk_position_);
+        std::memcpy(destination, chunk_.data() + chunk_position_, available);
+        chunk_position_ += available;
+        destination += available;
+        bytes -= available;
+      }
+    }
+
+    void OpenShard(size_t shard) {
+      CloseShard();
+
+      const std::string &filepath = shard_paths_[shard];
+      file_ = std::fopen(filepath.c_str(), "rb");
+      if (!file_) {
+        throw std::runtime_error("Failed to open file for reading: " + filepath);
+      }
+      //we do our own large reads, a second buffer in stdio would only add a copy
+      std::setvbuf(file_, nullptr, _IONBF, 0);
+
+#if defined(__linux__)
+      posix_fadvise(fileno(file_), 0, 0, POSIX_FADV_SEQUENTIAL);
+      if (next_shard_ < shard_order_.size()) {
+        //start reading the following shard into the page cache while this one is consumed
+        std::FILE *next = std::fopen(shard_paths_[shard_order_[next_shard_]].c_str(), "rb");
+        if (next) {
+          posix_fadvise(fileno(next), 0, 0, POSIX_FADV_WILLNEED);
+          std::fclose(next);
+        }
+      }
+#endif
+
+      ShardFormat::ShardHeader header{};
+      char header_bytes[ShardFormat::kShardHeaderSize];
+      if (std::fread(header_bytes, 1, sizeof(header_bytes), file_) != sizeof(header_bytes)) {
+        throw std::runtime_error("Truncated shard: " + filepath);
+      }
+      std::memcpy(&header, header_bytes, sizeof(header));
+
+      if (std::memcmp(header.magic, ShardFormat::kShardMagic, sizeof(header.magic)) != 0
+          || header.version != ShardFormat::kVersion || header.value_size != sizeof(dataType)
+          || header.input_size != input_size_ || header.target_size != target_size_
+          || header.samples != shard_samples_[shard]) {
+        throw std::runtime_error("Shard does not match its index: " + filepath);
+      }
+
+      shard_remaining_ = header.samples;
+      chunk_position_ = 0;
+      chunk_end_ = 0;
+    }
+
+    void CloseShard() {
+      if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+      }
+      shard_remaining_ = 0;
+    }
+  };
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/bit_fully_connected_layer.h>
 #include <NeuralNet/Model/base_network.h>
 
 #include <utility>
@@ -27,6 +29,21 @@ namespace NeuralNet::Training {
 
    protected:
 
+    //parameters of the layers holding output_size x input_size weights followed by output_size biases, null for
+    //any other layer
+    static std::vector<dataType> *DenseParameters(BaseLayer<dataType> *layer) {
+      if (auto fcl = dynamic_cast<FullyConnectedLayer<dataType> *>(layer)) {
+        return &fcl->Parameters();
+      }
+      if (auto binary = dynamic_cast<BitFullyConnectedLayer<dataType, false> *>(layer); binary && !binary->Packed()) {
+        return &binary->Parameters();
+      }
+      if (auto ternary = dynamic_cast<BitFullyConnectedLayer<dataType, true> *>(layer); ternary && !ternary->Packed()) {
+        return &ternary->Parameters();
+      }
+      return nullptr;
+    }
+
     virtual void InitializeLayer(std::shared_ptr<BaseLayer<dataType>> &layer, std::mt19937 &gen) = 0;
   };
 
@@ -13,12 +13,12 @@ namespace NeuralNet::Training {
    private:
 
     void InitializeLayer(std::shared_ptr<BaseLayer<dataType>> &layer, std::mt19937 &gen) override {
-      if (auto fcl = dynamic_cast<FullyConnectedLayer<dataType> *>(layer.get())) {
-        const size_t input_size = fcl->InputSize();
-        const size_t output_size = fcl->OutputSize();
+      if (std::vector<dataType> *dense = this->DenseParameters(layer.get())) {
+        const size_t input_size = layer->InputSize();
+        const size_t output_size = layer->OutputSize();
         const size_t sep = input_size * output_size;
 
-        std::vector<dataType> &parameters = fcl->Parameters();
+        std::vector<dataType> &parameters = *dense;
 
         std::normal_distribution<dataType> dist(0, sqrt(2 / static_cast<dataType>(input_size)));
 
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Kernels/cpu_features.h>
+
+namespace NeuralNet::Kernels {
+
+  //binary and ternary weights are stored as bit planes of 64 bit words, BitWords(input_size) words per output row
+  //with bit k % 64 of word k / 64 standing for input k and the padding bits zero. the sign plane has the bits of
+  //negative values set, the mask plane of ternary weights the bits of nonzero ones. inputs are binarized to their
+  //sign as well, so the dot product of a row is input_size - 2 * popcount(signs ^ input signs) for binary weights and
+  //nonzeros - 2 * popcount(mask & (signs ^ input signs)) for ternary ones, times the scale of the row
+
+  constexpr size_t BitWords(size_t size) {
+    return (size + 63) / 64;
+  }
+
+  //-1 for values with the sign bit set, 1 otherwise
+  template<typename T>
+  T BinarizeSign(T value) {
+    return std::signbit(value) ? T(-1) : T(1);
+  }
+
+  template<typename T>
+  void PackSigns(const T *values, size_t size, uint64_t *words) {
+    for (size_t w = 0; w < BitWords(size); ++w) {
+      const size_t end = std::min(size, w * 64 + 64);
+      uint64_t word = 0;
+      for (size_t k = w * 64; k < end; ++k) {
+        word |= uint64_t(std::signbit(values[k])) << (k - w * 64);
+      }
+      words[w] = word;
+    }
+  }
+
+  //quantized weights and scale of every row of output_size x input_size float shadow weights. binary weights are
+  //+-mean |w| of the row, ternary weights are 0 up to 0.7 mean |w| and +-the mean |w| of the larger ones otherwise
+  template<typename T>
+  void QuantizeBitWeights(const T *shadow, T *weights, T *scales, size_t input_size, size_t output_size,
+                          bool ternary) {
+    for (size_t j = 0; j < output_size; ++j) {
+      const T *row = shadow + j * input_size;
+      T *quantized = weights + j * input_size;
+
+      T sum = 0;
+      for (size_t k = 0; k < input_size; ++k) {
+        sum += std::abs(row[k]);
+      }
+      T scale = sum / static_cast<T>(input_size);
+
+      if (ternary) {
+        const T threshold = T(0.7) * scale;
+        T kept_sum = 0;
+        size_t kept = 0;
+        for (size_t k = 0; k < input_size; ++k) {
+          if (std::abs(row[k]) > threshold) {
+            kept_sum += std::abs(row[k]);
+            ++kept;
+          }
+        }
+        scale = kept ? kept_sum / static_cast<T>(kept) : T(0);
+        for (size_t k = 0; k < input_size; ++k) {
+          quantized[k] = std::abs(row[k]) > threshold ? std::copysign(scale, row[k]) : T(0);
+        }
+      } else {
+        for (size_t k = 0; k < input_size; ++k) {
+          quantized[k] = std::copysign(scale, row[k]);
+        }
+      }
+
+      scales[j] = scale;
+    }
+  }
+
+  //bit planes of quantized weights, masks and nonzeros are only written for ternary weights and may be null otherwise
+  template<typename T>
+  void PackBitWeights(const T *weights, uint64_t *signs, uint64_t *masks, uint32_t *nonzeros, size_t input_size,
+                      size_t output_size) {
+    const size_t words = BitWords(input_size);
+
+    for (size_t j = 0; j < output_size; ++j) {
+      const T *row = weights + j * input_size;
+      PackSigns(row, input_size, signs + j * words);
+
+      if (masks) {
+        uint32_t count = 0;
+        for (size_t w = 0; w < words; ++w) {
+          const size_t end = std::min(input_size, w * 64 + 64);
+          uint64_t word = 0;
+          for (size_t k = w * 64; k < end; ++k) {
+            word |= uint64_t(row[k] != 0) << (k - w * 64);
+          }
+          masks[j * words + w] = word;
+          count += static_cast<uint32_t>(std::popcount(word));
+        }
+        nonzeros[j] = count;
+      }
+    }
+  }
+
+  //the rows of four samples share every load of weight words
+  template<bool kTernary, typename T>
+  [[gnu::always_inline]] inline void BitForwardRows(const uint64_t *signs, const uint64_t *masks,
+                                                    const uint32_t *nonzeros, const T *scales, const T *biases,
+                                                    const uint64_t *input_signs, T *outputs, size_t batch_size,
+                                                    size_t input_size, size_t output_size) {
+    const size_t words = BitWords(input_size);
+    size_t i = 0;
+
+    for (; i + 4 <= batch_size; i += 4) {
+      const uint64_t *x0 = input_signs + i * words;
+      const uint64_t *x1 = x0 + words;
+      const uint64_t *x2 = x1 + words;
+      const uint64_t *x3 = x2 + words;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const uint64_t *w = signs + j * words;
+        uint32_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+
+        if constexpr (kTernary) {
+          const uint64_t *m = masks + j * words;
+          for (size_t k = 0; k < words; ++k) {
+            c0 += std::popcount(m[k] & (w[k] ^ x0[k]));
+            c1 += std::popcount(m[k] & (w[k] ^ x1[k]));
+            c2 += std::popcount(m[k] & (w[k] ^ x2[k]));
+            c3 += std::popcount(m[k] & (w[k] ^ x3[k]));
+          }
+        } else {
+          for (size_t k = 0; k < words; ++k) {
+            c0 += std::popcount(w[k] ^ x0[k]);
+            c1 += std::popcount(w[k] ^ x1[k]);
+            c2 += std::popcount(w[k] ^ x2[k]);
+            c3 += std::popcount(w[k] ^ x3[k]);
+          }
+        }
+
+        const int64_t n = kTernary ? nonzeros[j] : static_cast<int64_t>(input_size);
+        outputs[i * output_size + j] = scales[j] * static_cast<T>(n - 2 * int64_t(c0)) + biases[j];
+        outputs[(i + 1) * output_size + j] = scales[j] * static_cast<T>(n - 2 * int64_t(c1)) + biases[j];
+        outputs[(i + 2) * output_size + j] = scales[j] * static_cast<T>(n - 2 * int64_t(c2)) + biases[j];
+        outputs[(i + 3) * output_size + j] = scales[j] * static_cast<T>(n - 2 * int64_t(c3)) + biases[j];
+      }
+    }
+
+    for (; i < batch_size; ++i) {
+      const uint64_t *x = input_signs + i * words;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const uint64_t *w = signs + j * words;
+        uint32_t c = 0;
+        for (size_t k = 0; k < words; ++k) {
+          if constexpr (kTernary) {
+            c += std::popcount(masks[j * words + k] & (w[k] ^ x[k]));
+          } else {
+            c += std::popcount(w[k] ^ x[k]);
+          }
+        }
+
+        const int64_t n = kTernary ? nonzeros[j] : static_cast<int64_t>(input_size);
+        outputs[i * output_size + j] = scales[j] * static_cast<T>(n - 2 * int64_t(c)) + biases[j];
+      }
+    }
+  }
+
+  //packs the signs of the inputs and computes the outputs of binary or ternary weights
+  template<bool kTernary, typename T>
+  void BitForward(const uint64_t *signs, const uint64_t *masks, const uint32_t *nonzeros, const T *scales,
+                  const T *biases, const T *inputs, T *outputs, size_t batch_size, size_t input_size,
+                  size_t output_size) {
+    const size_t words = BitWords(input_size);
+    thread_local AlignedVector<uint64_t> input_signs;
+    input_signs.resize(batch_size * words);
+
+    for (size_t i = 0; i < batch_size; ++i) {
+      PackSigns(inputs + i * input_size, input_size, input_signs.data() + i * words);
+    }
+
+    BitForwardRows<kTernary>(signs, masks, nonzeros, scales, biases, input_signs.data(), outputs, batch_size,
+                             input_size, output_size);
+  }
+
+#if NEURALNET_X86_DISPATCH
+
+  //BitForward with every popcount a single instruction
+  template<bool kTernary, typename T>
+  __attribute__((target("popcnt")))
+  void BitForwardPopcnt(const uint64_t *signs, const uint64_t *masks, const uint32_t *nonzeros, const T *scales,
+                        const T *biases, const T *inputs, T *outputs, size_t batch_size, size_t input_size,
+                        size_t output_size) {
+    const size_t words = BitWords(input_size);
+    thread_local AlignedVector<uint64_t> input_signs;
+    input_signs.resize(batch_size * words);
+
+    for (size_t i = 0; i < batch_size; ++i) {
+      PackSigns(inputs + i * input_size, input_size, input_signs.data() + i * words);
+    }
+
+    BitForwardRows<kTernary>(signs, masks, nonzeros, scales, biases, input_signs.data(), outputs, batch_size,
+                             input_size, output_size);
+  }
+
+#endif
+
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <NeuralNet/misc/math_util.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Kernels/cpu_features.h>
+#include <NeuralNet/Kernels/dense_kernels.h>
+
+namespace NeuralNet::Kernels {
+
+  //codebook weights are an index into a table of 1 << bits centroids per weight. every output row takes
+  //CodebookRowBytes(input_size, bits) bytes, 8 bit indices are one byte per input, 4 bit indices two per byte with
+  //the even input in the low nibble and the last nibble of odd sized rows zero
+
+  constexpr size_t CodebookRowBytes(size_t input_size, size_t bits) {
+    return bits == 4 ? (input_size + 1) / 2 : input_size;
+  }
+
+  template<size_t kBits>
+  inline uint8_t CodebookIndex(const uint8_t *row, size_t k) {
+    if constexpr (kBits == 4) {
+      return (row[k / 2] >> (k % 2 * 4)) & 0xF;
+    } else {
+      return row[k];
+    }
+  }
+
+  //1d k-means of values into clusters centroids, sorted ascending. centroids start evenly spaced between the
+  //smallest and the largest value, which keeps the rare large weights representable, and are moved to the mean of
+  //the values closest to them until they stop changing. the values are sorted once, so every iteration only
+  //searches the boundaries between the clusters
+  template<typename T>
+  void ClusterValues(const T *values, size_t size, T *centroids, size_t clusters) {
+    constexpr size_t kMaxIterations = 100;
+
+    std::vector<double> sorted(values, values + size);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<double> prefix(size + 1, 0.0);
+    for (size_t i = 0; i < size; ++i) {
+      prefix[i + 1] = prefix[i] + sorted[i];
+    }
+
+    const double min = size ? sorted.front() : 0.0;
+    const double max = size ? sorted.back() : 0.0;
+    std::vector<double> means(clusters);
+    for (size_t c = 0; c < clusters; ++c) {
+      means[c] = clusters > 1 ? min + (max - min) * static_cast<double>(c) / static_cast<double>(clusters - 1) : min;
+    }
+
+    for (size_t iteration = 0; iteration < kMaxIterations; ++iteration) {
+      bool changed = false;
+      auto begin = sorted.begin();
+
+      for (size_t c = 0; c < clusters; ++c) {
+        const auto end = c + 1 < clusters ? std::lower_bound(begin, sorted.end(), (means[c] + means[c + 1]) / 2)
+                                          : sorted.end();
+        if (end != begin) {
+          const size_t first = begin - sorted.begin();
+          const size_t last = end - sorted.begin();
+          const double mean = (prefix[last] - prefix[first]) / static_cast<double>(last - first);
+          changed |= mean != means[c];
+          means[c] = mean;
+        }
+        begin = end;
+      }
+
+      if (!changed) {
+        break;
+      }
+    }
+
+    for (size_t c = 0; c < clusters; ++c) {
+      centroids[c] = static_cast<T>(means[c]);
+    }
+  }
+
+  //indices of the nearest of the sorted centroids for output_size x input_size weights
+  template<typename T>
+  void AssignCodebook(const T *weights, const T *centroids, size_t clusters, size_t bits, uint8_t *indices,
+                      size_t input_size, size_t output_size) {
+    std::vector<T> boundaries(clusters - 1);
+    for (size_t c = 0; c + 1 < clusters; ++c) {
+      boundaries[c] = (centroids[c] + centroids[c + 1]) / 2;
+    }
+
+    const size_t row_bytes = CodebookRowBytes(input_size, bits);
+    std::fill(indices, indices + output_size * row_bytes, uint8_t(0));
+
+    for (size_t j = 0; j < output_size; ++j) {
+      uint8_t *row = indices + j * row_bytes;
+      for (size_t k = 0; k < input_size; ++k) {
+        const T weight = weights[j * input_size + k];
+        const auto index = static_cast<uint8_t>(
+            std::upper_bound(boundaries.begin(), boundaries.end(), weight) - boundaries.begin());
+        if (bits == 4) {
+          row[k / 2] |= index << (k % 2 * 4);
+        } else {
+          row[k] = index;
+        }
+      }
+    }
+  }
+
+  template<size_t kBits, typename T>
+  void DecodeCodebook(const T *codebook, const uint8_t *row, T *weights, size_t input_size) {
+    size_t k = 0;
+    if constexpr (kBits == 4) {
+      for (; k + 2 <= input_size; k += 2) {
+        weights[k] = codebook[row[k / 2] & 0xF];
+        weights[k + 1] = codebook[row[k / 2] >> 4];
+      }
+    }
+    for (; k < input_size; ++k) {
+      weights[k] = codebook[CodebookIndex<kBits>(row, k)];
+    }
+  }
+
+  //four weight rows at a time are looked up into a tile that stays in L1 and used for the whole batch
+  template<size_t kBits, typename T>
+  void CodebookForward(const T *codebook, const uint8_t *indices, const T *biases, const T *inputs, T *outputs,
+                       size_t batch_size, size_t input_size, size_t output_size) {
+    constexpr size_t kTileRows = 4;
+    const size_t row_bytes = CodebookRowBytes(input_size, kBits);
+    thread_local AlignedVector<T> tile;
+    tile.resize(kTileRows * input_size);
+
+    size_t j = 0;
+    for (; j + kTileRows <= output_size; j += kTileRows) {
+      for (size_t r = 0; r < kTileRows; ++r) {
+        DecodeCodebook<kBits>(codebook, indices + (j + r) * row_bytes, tile.data() + r * input_size, input_size);
+      }
+      const T *weight0 = tile.data();
+      const T *weight1 = weight0 + input_size;
+      const T *weight2 = weight1 + input_size;
+      const T *weight3 = weight2 + input_size;
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const T *input = inputs + i * input_size;
+        T sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+
+        for (size_t k = 0; k < input_size; ++k) {
+          const T x = input[k];
+          sum0 += x * weight0[k];
+          sum1 += x * weight1[k];
+          sum2 += x * weight2[k];
+          sum3 += x * weight3[k];
+        }
+
+        T *output = outputs + i * output_size + j;
+        output[0] = sum0 + biases[j];
+        output[1] = sum1 + biases[j + 1];
+        output[2] = sum2 + biases[j + 2];
+        output[3] = sum3 + biases[j + 3];
+      }
+    }
+
+    for (; j < output_size; ++j) {
+      DecodeCodebook<kBits>(codebook, indices + j * row_bytes, tile.data(), input_size);
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        outputs[i * output_size + j] = MathUtil::Dot(inputs + i * input_size, tile.data(), input_size) + biases[j];
+      }
+    }
+  }
+
+#if NEURALNET_X86_DISPATCH
+
+  //eight weights from k on, 16 float centroids are two registers indexed with permutes, 256 are gathered
+  template<size_t kBits>
+  __attribute__((target("avx2,fma")))
+  inline __m256 LookupCodebookAVX2(const float *codebook, __m256 low, __m256 high, const uint8_t *row, size_t k) {
+    if constexpr (kBits == 4) {
+      uint32_t packed;
+      std::memcpy(&packed, row + k / 2, sizeof(packed));
+      const __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+      const __m256i index = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(packed)), shifts),
+                                             _mm256_set1_epi32(0xF));
+      return _mm256_blendv_ps(_mm256_permutevar8x32_ps(low, index), _mm256_permutevar8x32_ps(high, index),
+                              _mm256_castsi256_ps(_mm256_slli_epi32(index, 28)));
+    } else {
+      const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + k)));
+      return _mm256_i32gather_ps(codebook, index, 4);
+    }
+  }
+
+  //DenseForwardAVX2 with the weights looked up in registers, so only the index bytes of the weights are read
+  template<size_t kBits>
+  __attribute__((target("avx2,fma")))
+  void CodebookForwardAVX2(const float *codebook, const uint8_t *indices, const float *biases, const float *inputs,
+                           float *outputs, size_t batch_size, size_t input_size, size_t output_size) {
+    const size_t row_bytes = CodebookRowBytes(input_size, kBits);
+    const __m256 low = _mm256_loadu_ps(codebook);
+    const __m256 high = kBits == 4 ? _mm256_loadu_ps(codebook + 8) : low;
+    size_t i = 0;
+
+    for (; i + 4 <= batch_size; i += 4) {
+      const float *input0 = inputs + i * input_size;
+      const float *input1 = input0 + input_size;
+      const float *input2 = input1 + input_size;
+      const float *input3 = input2 + input_size;
+      float *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const uint8_t *row = indices + j * row_bytes;
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+
+        size_t k = 0;
+        for (; k + 8 <= input_size; k += 8) {
+          const __m256 w = LookupCodebookAVX2<kBits>(codebook, low, high, row, k);
+          acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(input0 + k), w, acc0);
+          acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(input1 + k), w, acc1);
+          acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(input2 + k), w, acc2);
+          acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(input3 + k), w, acc3);
+        }
+
+        float sum0 = HorizontalSumAVX2(acc0);
+        float sum1 = HorizontalSumAVX2(acc1);
+        float sum2 = HorizontalSumAVX2(acc2);
+        float sum3 = HorizontalSumAVX2(acc3);
+        for (; k < input_size; ++k) {
+          const float w = codebook[CodebookIndex<kBits>(row, k)];
+          sum0 += input0[k] * w;
+          sum1 += input1[k] * w;
+          sum2 += input2[k] * w;
+          sum3 += input3[k] * w;
+        }
+
+        output[j] = sum0 + biases[j];
+        output[output_size + j] = sum1 + biases[j];
+        output[2 * output_size + j] = sum2 + biases[j];
+        output[3 * output_size + j] = sum3 + biases[j];
+      }
+    }
+
+    for (; i < batch_size; ++i) {
+      const float *input = inputs + i * input_size;
+      float *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const uint8_t *row = indices + j * row_bytes;
+        __m256 acc = _mm256_setzero_ps();
+
+        size_t k = 0;
+        for (; k + 8 <= input_size; k += 8) {
+          acc = _mm256_fmadd_ps(_mm256_loadu_ps(input + k), LookupCodebookAVX2<kBits>(codebook, low, high, row, k),
+                                acc);
+        }
+        float sum = HorizontalSumAVX2(acc);
+        for (; k < input_size; ++k) {
+          sum += input[k] * codebook[CodebookIndex<kBits>(row, k)];
+        }
+
+        output[j] = sum + biases[j];
+      }
+    }
+  }
+
+#endif
+
+}
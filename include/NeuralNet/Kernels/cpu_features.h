@@ -0,0 +1,69 @@
+#pragma once
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NEURALNET_X86_DISPATCH 1
+#include <immintrin.h>
+#else
+#define NEURALNET_X86_DISPATCH 0
+#endif
+
+namespace NeuralNet::Kernels {
+
+  //ordered, every level includes the ones below it
+  enum class ISA {
+    Scalar = 0,
+    AVX2 = 1,
+    AVXVNNI = 2,
+  };
+
+  inline const char *ISAName(ISA isa) {
+    switch (isa) {
+      case ISA::AVX2: return "avx2";
+      case ISA::AVXVNNI: return "avx_vnni";
+      default: return "scalar";
+    }
+  }
+
+  //best instruction set supported by the cpu we are running on, kernels for it are compiled with target attributes
+  inline ISA DetectISA() {
+#if NEURALNET_X86_DISPATCH
+    static const ISA isa = !(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? ISA::Scalar
+                           : __builtin_cpu_supports("avxvnni") ? ISA::AVXVNNI : ISA::AVX2;
+    return isa;
+#else
+    return ISA::Scalar;
+#endif
+  }
+
+  //conversion between float and IEEE half precision
+  inline bool HasF16C() {
+#if NEURALNET_X86_DISPATCH
+    static const bool f16c = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    return f16c;
+#else
+    return false;
+#endif
+  }
+
+  //population count of 64 bit words in one instruction
+  inline bool HasPopcnt() {
+#if NEURALNET_X86_DISPATCH
+    static const bool popcnt = __builtin_cpu_supports("popcnt");
+    return popcnt;
+#else
+    return false;
+#endif
+  }
+
+  //bfloat16 conversion and dot products with float accumulation
+  inline bool HasAVX512BF16() {
+#if NEURALNET_X86_DISPATCH
+    static const bool bf16 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512bf16");
+    return bf16;
+#else
+    return false;
+#endif
+  }
+
+}
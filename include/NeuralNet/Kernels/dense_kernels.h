@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+
+#include <NeuralNet/misc/math_util.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Kernels/cpu_features.h>
+
+namespace NeuralNet::Kernels {
+
+  //all kernels work on row-major batches: inputs is batch_size x input_size, outputs is batch_size x output_size,
+  //weights is output_size x input_size followed by output_size biases
+
+  template<typename T>
+  void DenseForwardNaive(const T *weights, const T *biases, const T *inputs, T *outputs,
+                         size_t batch_size, size_t input_size, size_t output_size) {
+    for (size_t i = 0; i < batch_size; ++i) {
+      const T *input = inputs + i * input_size;
+      T *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        output[j] = MathUtil::Dot(input, weights + j * input_size, input_size) + biases[j];
+      }
+    }
+  }
+
+  //four samples share every weight row that is loaded
+  template<typename T>
+  void DenseForwardBlocked(const T *weights, const T *biases, const T *inputs, T *outputs,
+                           size_t batch_size, size_t input_size, size_t output_size) {
+    size_t i = 0;
+
+    for (; i + 4 <= batch_size; i += 4) {
+      const T *input0 = inputs + i * input_size;
+      const T *input1 = input0 + input_size;
+      const T *input2 = input1 + input_size;
+      const T *input3 = input2 + input_size;
+      T *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const T *weight = weights + j * input_size;
+        T sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+
+        for (size_t k = 0; k < input_size; ++k) {
+          const T w = weight[k];
+          sum0 += input0[k] * w;
+          sum1 += input1[k] * w;
+          sum2 += input2[k] * w;
+          sum3 += input3[k] * w;
+        }
+
+        output[j] = sum0 + biases[j];
+        output[output_size + j] = sum1 + biases[j];
+        output[2 * output_size + j] = sum2 + biases[j];
+        output[3 * output_size + j] = sum3 + biases[j];
+      }
+    }
+
+    DenseForwardNaive(weights, biases, inputs + i * input_size, outputs + i * output_size,
+                      batch_size - i, input_size, output_size);
+  }
+
+  //one pass over the weights computes the parameter gradients and, unless prev_deltas is null, the input deltas
+  template<typename T>
+  void DenseBackward(const T *weights, const T *inputs, const T *deltas, T *prev_deltas, T *grad_parameters,
+                     size_t batch_size, size_t input_size, size_t output_size) {
+    T *grad_weights = grad_parameters;
+    T *grad_biases = grad_parameters + input_size * output_size;
+
+    std::fill(grad_parameters, grad_parameters + input_size * output_size + output_size, T(0));
+    if (prev_deltas) {
+      std::fill(prev_deltas, prev_deltas + batch_size * input_size, T(0));
+    }
+
+    for (size_t j = 0; j < output_size; ++j) {
+      const T *weight = weights + j * input_size;
+      T *grad_weight = grad_weights + j * input_size;
+      T grad_bias = 0;
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const T delta = deltas[i * output_size + j];
+        grad_bias += delta;
+
+        MathUtil::Axpy(delta, inputs + i * input_size, grad_weight, input_size);
+        if (prev_deltas) {
+          MathUtil::Axpy(delta, weight, prev_deltas + i * input_size, input_size);
+        }
+      }
+
+      grad_biases[j] = grad_bias;
+    }
+  }
+
+  template<typename T>
+  using DenseForwardKernel = void (*)(const T *weights, const T *biases, const T *inputs, T *outputs,
+                                      size_t batch_size, size_t input_size, size_t output_size);
+
+  //encoded (uint8/int16) inputs are dequantized to input * scale + offset four rows at a time into a tile that
+  //stays in L1 and is fed to the float kernel, so the whole batch is never converted into a separate buffer
+  template<typename T, typename Q>
+  void DenseForwardDequantize(const T *weights, const T *biases, const Q *inputs, T *outputs,
+                              size_t batch_size, size_t input_size, size_t output_size,
+                              T scale, T offset, DenseForwardKernel<T> forward) {
+    constexpr size_t kTileRows = 4;
+    thread_local AlignedVector<T> tile;
+    tile.resize(kTileRows * input_size);
+
+    for (size_t i = 0; i < batch_size; i += kTileRows) {
+      const size_t rows = std::min(kTileRows, batch_size - i);
+      const Q *input = inputs + i * input_size;
+
+      if (scale == T(1) && offset == T(0)) {
+        for (size_t k = 0; k < rows * input_size; ++k) {
+          tile[k] = static_cast<T>(input[k]);
+        }
+      } else {
+        for (size_t k = 0; k < rows * input_size; ++k) {
+          tile[k] = static_cast<T>(input[k]) * scale + offset;
+        }
+      }
+
+      forward(weights, biases, tile.data(), outputs + i * output_size, rows, input_size, output_size);
+    }
+  }
+
+  //parameter gradients for encoded inputs, input deltas are never needed as this is always the first layer:
+  //sum_i delta_i * (x_i * scale + offset) = scale * sum_i delta_i * x_i + offset * sum_i delta_i
+  template<typename T, typename Q>
+  void DenseBackwardDequantize(const Q *inputs, const T *deltas, T *grad_parameters,
+                               size_t batch_size, size_t input_size, size_t output_size, T scale, T offset) {
+    T *grad_weights = grad_parameters;
+    T *grad_biases = grad_parameters + input_size * output_size;
+
+    std::fill(grad_parameters, grad_parameters + input_size * output_size + output_size, T(0));
+
+    for (size_t j = 0; j < output_size; ++j) {
+      T *grad_weight = grad_weights + j * input_size;
+      T grad_bias = 0;
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const T delta = deltas[i * output_size + j];
+        grad_bias += delta;
+
+        MathUtil::Axpy(delta * scale, inputs + i * input_size, grad_weight, input_size);
+      }
+
+      if (offset != 0) {
+        for (size_t k = 0; k < input_size; ++k) {
+          grad_weight[k] += offset * grad_bias;
+        }
+      }
+
+      grad_biases[j] = grad_bias;
+    }
+  }
+
+#if NEURALNET_X86_DISPATCH
+
+  __attribute__((target("avx2,fma")))
+  inline float HorizontalSumAVX2(__m256 v) {
+    __m128 low = _mm256_castps256_ps128(v);
+    __m128 high = _mm256_extractf128_ps(v, 1);
+    low = _mm_add_ps(low, high);
+    low = _mm_add_ps(low, _mm_movehl_ps(low, low));
+    low = _mm_add_ss(low, _mm_movehdup_ps(low));
+    return _mm_cvtss_f32(low);
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline float DotAVX2(const float *vec1, const float *vec2, size_t size) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t k = 0;
+    for (; k + 8 <= size; k += 8) {
+      acc = _mm256_fmadd_ps(_mm256_loadu_ps(vec1 + k), _mm256_loadu_ps(vec2 + k), acc);
+    }
+    float sum = HorizontalSumAVX2(acc);
+    for (; k < size; ++k) {
+      sum += vec1[k] * vec2[k];
+    }
+    return sum;
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline void AxpyAVX2(float alpha, const float *x, float *y, size_t size) {
+    const __m256 a = _mm256_set1_ps(alpha);
+    size_t k = 0;
+    for (; k + 8 <= size; k += 8) {
+      _mm256_storeu_ps(y + k, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + k), _mm256_loadu_ps(y + k)));
+    }
+    for (; k < size; ++k) {
+      y[k] += alpha * x[k];
+    }
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline void DenseForwardAVX2(const float *weights, const float *biases, const float *inputs, float *outputs,
+                               size_t batch_size, size_t input_size, size_t output_size) {
+    size_t i = 0;
+
+    for (; i + 4 <= batch_size; i += 4) {
+      const float *input0 = inputs + i * input_size;
+      const float *input1 = input0 + input_size;
+      const float *input2 = input1 + input_size;
+      const float *input3 = input2 + input_size;
+      float *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const float *weight = weights + j * input_size;
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+
+        size_t k = 0;
+        for (; k + 8 <= input_size; k += 8) {
+          const __m256 w = _mm256_loadu_ps(weight + k);
+          acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(input0 + k), w, acc0);
+          acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(input1 + k), w, acc1);
+          acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(input2 + k), w, acc2);
+          acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(input3 + k), w, acc3);
+        }
+
+        float sum0 = HorizontalSumAVX2(acc0);
+        float sum1 = HorizontalSumAVX2(acc1);
+        float sum2 = HorizontalSumAVX2(acc2);
+        float sum3 = HorizontalSumAVX2(acc3);
+        for (; k < input_size; ++k) {
+          sum0 += input0[k] * weight[k];
+          sum1 += input1[k] * weight[k];
+          sum2 += input2[k] * weight[k];
+          sum3 += input3[k] * weight[k];
+        }
+
+        output[j] = sum0 + biases[j];
+        output[output_size + j] = sum1 + biases[j];
+        output[2 * output_size + j] = sum2 + biases[j];
+        output[3 * output_size + j] = sum3 + biases[j];
+      }
+    }
+
+    for (; i < batch_size; ++i) {
+      const float *input = inputs + i * input_size;
+      float *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        output[j] = DotAVX2(input, weights + j * input_size, input_size) + biases[j];
+      }
+    }
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline void DenseBackwardAVX2(const float *weights, const float *inputs, const float *deltas, float *prev_deltas,
+                                float *grad_parameters, size_t batch_size, size_t input_size, size_t output_size) {
+    float *grad_weights = grad_parameters;
+    float *grad_biases = grad_parameters + input_size * output_size;
+
+    std::fill(grad_parameters, grad_parameters + input_size * output_size + output_size, 0.0f);
+    if (prev_deltas) {
+      std::fill(prev_deltas, prev_deltas + batch_size * input_size, 0.0f);
+    }
+
+    for (size_t j = 0; j < output_size; ++j) {
+      const float *weight = weights + j * input_size;
+      float *grad_weight = grad_weights + j * input_size;
+      float grad_bias = 0;
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const float delta = deltas[i * output_size + j];
+        grad_bias += delta;
+
+        AxpyAVX2(delta, inputs + i * input_size, grad_weight, input_size);
+        if (prev_deltas) {
+          AxpyAVX2(delta, weight, prev_deltas + i * input_size, input_size);
+        }
+      }
+
+      grad_biases[j] = grad_bias;
+    }
+  }
+
+#endif
+
+}
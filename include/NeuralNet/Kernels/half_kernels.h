@@ -0,0 +1,347 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include <NeuralNet/misc/half.h>
+#include <NeuralNet/misc/math_util.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Kernels/cpu_features.h>
+#include <NeuralNet/Kernels/dense_kernels.h>
+
+namespace NeuralNet::Kernels {
+
+#if NEURALNET_X86_DISPATCH
+
+  __attribute__((target("avx,f16c")))
+  inline void FloatToHalfF16C(const float *values, uint16_t *halves, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(halves + i),
+                       _mm256_cvtps_ph(_mm256_loadu_ps(values + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+    for (; i < size; ++i) {
+      halves[i] = FloatToHalf(values[i]);
+    }
+  }
+
+  __attribute__((target("avx,f16c")))
+  inline void HalfToFloatF16C(const uint16_t *halves, float *values, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+      _mm256_storeu_ps(values + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(halves + i))));
+    }
+    for (; i < size; ++i) {
+      values[i] = HalfToFloat(halves[i]);
+    }
+  }
+
+  __attribute__((target("avx512f,avx512bw,avx512bf16")))
+  inline void FloatToBFloat16AVX512(const float *values, uint16_t *halves, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+      const __m256bh converted = _mm512_cvtneps_pbh(_mm512_loadu_ps(values + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(halves + i), reinterpret_cast<const __m256i &>(converted));
+    }
+    for (; i < size; ++i) {
+      halves[i] = FloatToBFloat16(values[i]);
+    }
+  }
+
+  __attribute__((target("avx2")))
+  inline void BFloat16ToFloatAVX2(const uint16_t *halves, float *values, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+      const __m256i widened = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(halves + i)));
+      _mm256_storeu_ps(values + i, _mm256_castsi256_ps(_mm256_slli_epi32(widened, 16)));
+    }
+    for (; i < size; ++i) {
+      values[i] = BFloat16ToFloat(halves[i]);
+    }
+  }
+
+#endif
+
+  template<typename T>
+  void ToHalf(Precision precision, const T *values, uint16_t *halves, size_t size) {
+#if NEURALNET_X86_DISPATCH
+    if constexpr (std::is_same_v<T, float>) {
+      if (precision == Precision::Float16 && HasF16C()) {
+        FloatToHalfF16C(values, halves, size);
+        return;
+      }
+      if (precision == Precision::BFloat16 && HasAVX512BF16()) {
+        FloatToBFloat16AVX512(values, halves, size);
+        return;
+      }
+    }
+#endif
+    if (precision == Precision::Float16) {
+      for (size_t i = 0; i < size; ++i) {
+        halves[i] = FloatToHalf(static_cast<float>(values[i]));
+      }
+    } else {
+      for (size_t i = 0; i < size; ++i) {
+        halves[i] = FloatToBFloat16(static_cast<float>(values[i]));
+      }
+    }
+  }
+
+  template<typename T>
+  void FromHalf(Precision precision, const uint16_t *halves, T *values, size_t size) {
+#if NEURALNET_X86_DISPATCH
+    if constexpr (std::is_same_v<T, float>) {
+      if (precision == Precision::Float16 && HasF16C()) {
+        HalfToFloatF16C(halves, values, size);
+        return;
+      }
+      if (precision == Precision::BFloat16 && DetectISA() >= ISA::AVX2) {
+        BFloat16ToFloatAVX2(halves, values, size);
+        return;
+      }
+    }
+#endif
+    if (precision == Precision::Float16) {
+      for (size_t i = 0; i < size; ++i) {
+        values[i] = HalfToFloat(halves[i]);
+      }
+    } else {
+      for (size_t i = 0; i < size; ++i) {
+        values[i] = BFloat16ToFloat(halves[i]);
+      }
+    }
+  }
+
+#if NEURALNET_X86_DISPATCH
+
+  //32 bfloat16 pairs of values and weights per instruction summed into float, the tail is loaded masked
+  __attribute__((target("avx512f,avx512bw,avx512bf16")))
+  inline __m512 DotBFloat16AVX512(__m512 acc, const uint16_t *vec1, const uint16_t *vec2, __mmask32 mask) {
+    const __m512i a = _mm512_maskz_loadu_epi16(mask, vec1);
+    const __m512i b = _mm512_maskz_loadu_epi16(mask, vec2);
+    return _mm512_dpbf16_ps(acc, reinterpret_cast<const __m512bh &>(a), reinterpret_cast<const __m512bh &>(b));
+  }
+
+  //the upper half is added onto the lower one and summed like an AVX2 register. the extract, and also
+  //_mm512_reduce_add_ps, start from _mm256_undefined_pd, which GCC reports as maybe uninitialized once inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+  __attribute__((target("avx512f,avx512bw,avx512bf16")))
+  inline float HorizontalSumAVX512(__m512 v) {
+    const __m256 low = _mm512_castps512_ps256(v);
+    const __m256 high = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1));
+    return HorizontalSumAVX2(_mm256_add_ps(low, high));
+  }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+  //inputs and weights are bfloat16, biases and outputs float, four samples share every weight row that is loaded
+  __attribute__((target("avx512f,avx512bw,avx512bf16")))
+  inline void DenseForwardBFloat16AVX512(const uint16_t *weights, const float *biases, const uint16_t *inputs,
+                                         float *outputs, size_t batch_size, size_t input_size, size_t output_size) {
+    const __mmask32 tail = static_cast<__mmask32>((uint64_t(1) << (input_size % 32)) - 1);
+    size_t i = 0;
+
+    for (; i + 4 <= batch_size; i += 4) {
+      const uint16_t *input0 = inputs + i * input_size;
+      const uint16_t *input1 = input0 + input_size;
+      const uint16_t *input2 = input1 + input_size;
+      const uint16_t *input3 = input2 + input_size;
+      float *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const uint16_t *weight = weights + j * input_size;
+        __m512 acc0 = _mm512_setzero_ps();
+        __m512 acc1 = _mm512_setzero_ps();
+        __m512 acc2 = _mm512_setzero_ps();
+        __m512 acc3 = _mm512_setzero_ps();
+
+        size_t k = 0;
+        for (; k + 32 <= input_size; k += 32) {
+          acc0 = DotBFloat16AVX512(acc0, input0 + k, weight + k, ~__mmask32(0));
+          acc1 = DotBFloat16AVX512(acc1, input1 + k, weight + k, ~__mmask32(0));
+          acc2 = DotBFloat16AVX512(acc2, input2 + k, weight + k, ~__mmask32(0));
+          acc3 = DotBFloat16AVX512(acc3, input3 + k, weight + k, ~__mmask32(0));
+        }
+        if (tail) {
+          acc0 = DotBFloat16AVX512(acc0, input0 + k, weight + k, tail);
+          acc1 = DotBFloat16AVX512(acc1, input1 + k, weight + k, tail);
+          acc2 = DotBFloat16AVX512(acc2, input2 + k, weight + k, tail);
+          acc3 = DotBFloat16AVX512(acc3, input3 + k, weight + k, tail);
+        }
+
+        output[j] = HorizontalSumAVX512(acc0) + biases[j];
+        output[output_size + j] = HorizontalSumAVX512(acc1) + biases[j];
+        output[2 * output_size + j] = HorizontalSumAVX512(acc2) + biases[j];
+        output[3 * output_size + j] = HorizontalSumAVX512(acc3) + biases[j];
+      }
+    }
+
+    for (; i < batch_size; ++i) {
+      const uint16_t *input = inputs + i * input_size;
+      float *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const uint16_t *weight = weights + j * input_size;
+        __m512 acc = _mm512_setzero_ps();
+
+        size_t k = 0;
+        for (; k + 32 <= input_size; k += 32) {
+          acc = DotBFloat16AVX512(acc, input + k, weight + k, ~__mmask32(0));
+        }
+        if (tail) {
+          acc = DotBFloat16AVX512(acc, input + k, weight + k, tail);
+        }
+
+        output[j] = HorizontalSumAVX512(acc) + biases[j];
+      }
+    }
+  }
+
+#endif
+
+  //weights are output_size x input_size bfloat16/fp16 values, inputs, biases and outputs are T. four weight rows at
+  //a time are converted into a tile that stays in L1 and used for the whole batch
+  template<typename T>
+  void DenseForwardHalf(Precision precision, const uint16_t *weights, const T *biases, const T *inputs, T *outputs,
+                        size_t batch_size, size_t input_size, size_t output_size) {
+    constexpr size_t kTileRows = 4;
+    thread_local AlignedVector<T> tile;
+    tile.resize(kTileRows * input_size);
+
+    size_t j = 0;
+    for (; j + kTileRows <= output_size; j += kTileRows) {
+      FromHalf(precision, weights + j * input_size, tile.data(), kTileRows * input_size);
+      const T *weight0 = tile.data();
+      const T *weight1 = weight0 + input_size;
+      const T *weight2 = weight1 + input_size;
+      const T *weight3 = weight2 + input_size;
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const T *input = inputs + i * input_size;
+        T sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+
+        for (size_t k = 0; k < input_size; ++k) {
+          const T x = input[k];
+          sum0 += x * weight0[k];
+          sum1 += x * weight1[k];
+          sum2 += x * weight2[k];
+          sum3 += x * weight3[k];
+        }
+
+        T *output = outputs + i * output_size + j;
+        output[0] = sum0 + biases[j];
+        output[1] = sum1 + biases[j + 1];
+        output[2] = sum2 + biases[j + 2];
+        output[3] = sum3 + biases[j + 3];
+      }
+    }
+
+    for (; j < output_size; ++j) {
+      FromHalf(precision, weights + j * input_size, tile.data(), input_size);
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        outputs[i * output_size + j] = MathUtil::Dot(inputs + i * input_size, tile.data(), input_size) + biases[j];
+      }
+    }
+  }
+
+#if NEURALNET_X86_DISPATCH
+
+  template<Precision precision>
+  __attribute__((target("avx2,fma,f16c")))
+  inline __m256 LoadHalfAVX2(const uint16_t *halves) {
+    const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(halves));
+    if constexpr (precision == Precision::Float16) {
+      return _mm256_cvtph_ps(values);
+    } else {
+      return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(values), 16));
+    }
+  }
+
+  template<Precision precision>
+  inline float HalfValue(uint16_t half) {
+    return precision == Precision::Float16 ? HalfToFloat(half) : BFloat16ToFloat(half);
+  }
+
+  template<Precision precision>
+  __attribute__((target("avx2,fma,f16c")))
+  inline float DotHalfAVX2(const float *input, const uint16_t *weight, size_t size) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t k = 0;
+    for (; k + 8 <= size; k += 8) {
+      acc = _mm256_fmadd_ps(_mm256_loadu_ps(input + k), LoadHalfAVX2<precision>(weight + k), acc);
+    }
+    float sum = HorizontalSumAVX2(acc);
+    for (; k < size; ++k) {
+      sum += input[k] * HalfValue<precision>(weight[k]);
+    }
+    return sum;
+  }
+
+  //DenseForwardAVX2 with the weights widened to float in registers, so only half the weight bytes are read.
+  //fp16 weights need F16C
+  template<Precision precision>
+  __attribute__((target("avx2,fma,f16c")))
+  void DenseForwardHalfAVX2(const uint16_t *weights, const float *biases, const float *inputs, float *outputs,
+                            size_t batch_size, size_t input_size, size_t output_size) {
+    size_t i = 0;
+
+    for (; i + 4 <= batch_size; i += 4) {
+      const float *input0 = inputs + i * input_size;
+      const float *input1 = input0 + input_size;
+      const float *input2 = input1 + input_size;
+      const float *input3 = input2 + input_size;
+      float *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const uint16_t *weight = weights + j * input_size;
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+
+        size_t k = 0;
+        for (; k + 8 <= input_size; k += 8) {
+          const __m256 w = LoadHalfAVX2<precision>(weight + k);
+          acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(input0 + k), w, acc0);
+          acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(input1 + k), w, acc1);
+          acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(input2 + k), w, acc2);
+          acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(input3 + k), w, acc3);
+        }
+
+        float sum0 = HorizontalSumAVX2(acc0);
+        float sum1 = HorizontalSumAVX2(acc1);
+        float sum2 = HorizontalSumAVX2(acc2);
+        float sum3 = HorizontalSumAVX2(acc3);
+        for (; k < input_size; ++k) {
+          const float w = HalfValue<precision>(weight[k]);
+          sum0 += input0[k] * w;
+          sum1 += input1[k] * w;
+          sum2 += input2[k] * w;
+          sum3 += input3[k] * w;
+        }
+
+        output[j] = sum0 + biases[j];
+        output[output_size + j] = sum1 + biases[j];
+        output[2 * output_size + j] = sum2 + biases[j];
+        output[3 * output_size + j] = sum3 + biases[j];
+      }
+    }
+
+    for (; i < batch_size; ++i) {
+      const float *input = inputs + i * input_size;
+      float *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        output[j] = DotHalfAVX2<precision>(input, weights + j * input_size, input_size) + biases[j];
+      }
+    }
+  }
+
+#endif
+
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include <NeuralNet/Kernels/cpu_features.h>
+
+namespace NeuralNet::Kernels {
+
+  //symmetric int8 quantization, value ~ code * scale with codes in [-127, 127]. -128 is never produced, so the
+  //AVX2 kernels can move the sign of an input onto the weight and multiply its absolute value as unsigned
+
+  template<typename T>
+  inline int8_t QuantizeInt8(T value, T inverse_scale) {
+    return static_cast<int8_t>(std::clamp(std::nearbyint(value * inverse_scale), T(-127), T(127)));
+  }
+
+  template<typename T>
+  void QuantizeInt8(const T *values, int8_t *codes, size_t size, T inverse_scale) {
+    for (size_t i = 0; i < size; ++i) {
+      codes[i] = QuantizeInt8(values[i], inverse_scale);
+    }
+  }
+
+  inline int32_t DotInt8(const int8_t *vec1, const int8_t *vec2, size_t size) {
+    int32_t sum = 0;
+    for (size_t k = 0; k < size; ++k) {
+      sum += int32_t(vec1[k]) * int32_t(vec2[k]);
+    }
+    return sum;
+  }
+
+  //dot products of one weight row with four input rows
+  inline void DotInt8x4(const int8_t *weight, const int8_t *const inputs[4], size_t size, int32_t sums[4]) {
+    for (int r = 0; r < 4; ++r) {
+      sums[r] = DotInt8(weight, inputs[r], size);
+    }
+  }
+
+#if NEURALNET_X86_DISPATCH
+
+  __attribute__((target("avx2")))
+  inline int32_t HorizontalSumAVX2(__m256i v) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+  }
+
+  //|input| * (weight with the sign of input) in pairs of int16, at most 2 * 127 * 127 so maddubs never saturates
+  __attribute__((target("avx2")))
+  inline __m256i MultiplyAddInt8AVX2(__m256i acc, __m256i weight, __m256i input) {
+    const __m256i products = _mm256_maddubs_epi16(_mm256_sign_epi8(input, input), _mm256_sign_epi8(weight, input));
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(products, _mm256_set1_epi16(1)));
+  }
+
+  __attribute__((target("avx2")))
+  inline void DotInt8x4AVX2(const int8_t *weight, const int8_t *const inputs[4], size_t size, int32_t sums[4]) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    __m256i acc2 = _mm256_setzero_si256();
+    __m256i acc3 = _mm256_setzero_si256();
+
+    size_t k = 0;
+    for (; k + 32 <= size; k += 32) {
+      const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weight + k));
+      acc0 = MultiplyAddInt8AVX2(acc0, w, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[0] + k)));
+      acc1 = MultiplyAddInt8AVX2(acc1, w, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[1] + k)));
+      acc2 = MultiplyAddInt8AVX2(acc2, w, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[2] + k)));
+      acc3 = MultiplyAddInt8AVX2(acc3, w, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[3] + k)));
+    }
+
+    sums[0] = HorizontalSumAVX2(acc0) + DotInt8(weight + k, inputs[0] + k, size - k);
+    sums[1] = HorizontalSumAVX2(acc1) + DotInt8(weight + k, inputs[1] + k, size - k);
+    sums[2] = HorizontalSumAVX2(acc2) + DotInt8(weight + k, inputs[2] + k, size - k);
+    sums[3] = HorizontalSumAVX2(acc3) + DotInt8(weight + k, inputs[3] + k, size - k);
+  }
+
+  __attribute__((target("avx2")))
+  inline int32_t DotInt8AVX2(const int8_t *weight, const int8_t *input, size_t size) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t k = 0;
+    for (; k + 32 <= size; k += 32) {
+      acc = MultiplyAddInt8AVX2(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weight + k)),
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + k)));
+    }
+    return HorizontalSumAVX2(acc) + DotInt8(weight + k, input + k, size - k);
+  }
+
+  //vpdpbusd sums four unsigned by signed products straight into int32
+  __attribute__((target("avx2,avxvnni")))
+  inline __m256i MultiplyAddInt8VNNI(__m256i acc, __m256i weight, __m256i input) {
+    return _mm256_dpbusd_avx_epi32(acc, _mm256_sign_epi8(input, input), _mm256_sign_epi8(weight, input));
+  }
+
+  __attribute__((target("avx2,avxvnni")))
+  inline void DotInt8x4VNNI(const int8_t *weight, const int8_t *const inputs[4], size_t size, int32_t sums[4]) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    __m256i acc2 = _mm256_setzero_si256();
+    __m256i acc3 = _mm256_setzero_si256();
+
+    size_t k = 0;
+    for (; k + 32 <= size; k += 32) {
+      const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weight + k));
+      acc0 = MultiplyAddInt8VNNI(acc0, w, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[0] + k)));
+      acc1 = MultiplyAddInt8VNNI(acc1, w, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[1] + k)));
+      acc2 = MultiplyAddInt8VNNI(acc2, w, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[2] + k)));
+      acc3 = MultiplyAddInt8VNNI(acc3, w, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(inputs[3] + k)));
+    }
+
+    sums[0] = HorizontalSumAVX2(acc0) + DotInt8(weight + k, inputs[0] + k, size - k);
+    sums[1] = HorizontalSumAVX2(acc1) + DotInt8(weight + k, inputs[1] + k, size - k);
+    sums[2] = HorizontalSumAVX2(acc2) + DotInt8(weight + k, inputs[2] + k, size - k);
+    sums[3] = HorizontalSumAVX2(acc3) + DotInt8(weight + k, inputs[3] + k, size - k);
+  }
+
+  __attribute__((target("avx2,avxvnni")))
+  inline int32_t DotInt8VNNI(const int8_t *weight, const int8_t *input, size_t size) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t k = 0;
+    for (; k + 32 <= size; k += 32) {
+      acc = MultiplyAddInt8VNNI(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weight + k)),
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + k)));
+    }
+    return HorizontalSumAVX2(acc) + DotInt8(weight + k, input + k, size - k);
+  }
+
+#endif
+
+  //output (i, j) = dot(input i, weight j) * scales[j] + biases[j], clamped at 0 with relu, written as T or,
+  //when codes is set, requantized to int8 codes of output * output_inverse_scale
+  template<typename T>
+  struct DenseInt8Output {
+    const T *scales;
+    const T *biases;
+    bool relu;
+    T *outputs;
+    int8_t *codes;
+    T output_inverse_scale;
+
+    void Store(size_t index, size_t j, int32_t sum) const {
+      T value = static_cast<T>(sum) * scales[j] + biases[j];
+      if (relu && value < 0) {
+        value = 0;
+      }
+      if (codes) {
+        codes[index] = QuantizeInt8(value, output_inverse_scale);
+      } else {
+        outputs[index] = value;
+      }
+    }
+  };
+
+  //int8 weights are output_size x input_size, inputs are row-major int8 codes,
+  //four samples share every weight row that is loaded
+  template<typename T, ISA isa>
+  void DenseForwardInt8(const int8_t *weights, const int8_t *inputs, const DenseInt8Output<T> &output,
+                        size_t batch_size, size_t input_size, size_t output_size) {
+    size_t i = 0;
+
+    for (; i + 4 <= batch_size; i += 4) {
+      const int8_t *rows[4] = {inputs + i * input_size, inputs + (i + 1) * input_size,
+                               inputs + (i + 2) * input_size, inputs + (i + 3) * input_size};
+
+      for (size_t j = 0; j < output_size; ++j) {
+        int32_t sums[4];
+#if NEURALNET_X86_DISPATCH
+        if constexpr (isa == ISA::AVXVNNI) {
+          DotInt8x4VNNI(weights + j * input_size, rows, input_size, sums);
+        } else if constexpr (isa == ISA::AVX2) {
+          DotInt8x4AVX2(weights + j * input_size, rows, input_size, sums);
+        } else
+#endif
+        {
+          DotInt8x4(weights + j * input_size, rows, input_size, sums);
+        }
+
+        for (size_t r = 0; r < 4; ++r) {
+          output.Store((i + r) * output_size + j, j, sums[r]);
+        }
+      }
+    }
+
+    for (; i < batch_size; ++i) {
+      const int8_t *input = inputs + i * input_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        int32_t sum;
+#if NEURALNET_X86_DISPATCH
+        if constexpr (isa == ISA::AVXVNNI) {
+          sum = DotInt8VNNI(weights + j * input_size, input, input_size);
+        } else if constexpr (isa == ISA::AVX2) {
+          sum = DotInt8AVX2(weights + j * input_size, input, input_size);
+        } else
+#endif
+        {
+          sum = DotInt8(weights + j * input_size, input, input_size);
+        }
+
+        output.Store(i * output_size + j, j, sum);
+      }
+    }
+  }
+
+}
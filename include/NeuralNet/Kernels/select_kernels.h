@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+
+namespace NeuralNet::Kernels {
+
+  //indices of the k largest of size values, largest first and the lower index first among equal values. the k best
+  //so far are kept sorted and a value only costs a comparison with the smallest of them unless it enters
+  template<typename T>
+  void TopK(const T *values, size_t size, size_t k, size_t *indices) {
+    size_t kept = 0;
+
+    for (size_t i = 0; i < size; ++i) {
+      if (kept == k && !(values[i] > values[indices[k - 1]])) {
+        continue;
+      }
+
+      size_t position = kept < k ? kept++ : k - 1;
+      for (; position > 0 && values[i] > values[indices[position - 1]]; --position) {
+        indices[position] = indices[position - 1];
+      }
+      indices[position] = i;
+    }
+  }
+
+  //TopK of every row of a row-major batch_size x size batch, indices is batch_size x k
+  template<typename T>
+  void TopKRows(const T *values, size_t batch_size, size_t size, size_t k, size_t *indices) {
+    if (k == 1) {
+      for (size_t i = 0; i < batch_size; ++i) {
+        const T *row = values + i * size;
+        size_t best = 0;
+        for (size_t j = 1; j < size; ++j) {
+          if (row[j] > row[best]) {
+            best = j;
+          }
+        }
+        indices[i] = best;
+      }
+      return;
+    }
+
+    for (size_t i = 0; i < batch_size; ++i) {
+      TopK(values + i * size, size, k, indices + i * k);
+    }
+  }
+
+}
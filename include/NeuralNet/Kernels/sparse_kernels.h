@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Kernels/cpu_features.h>
+#include <NeuralNet/Kernels/dense_kernels.h>
+
+namespace NeuralNet::Kernels {
+
+  //weights in compressed sparse rows: the nonzero weights of output j are values[row_offsets[j] .. row_offsets[j + 1]]
+  //at input columns[...], inputs and outputs are row-major batches as for the dense kernels
+
+  template<typename T>
+  T SparseDot(const uint32_t *columns, const T *values, size_t count, const T *input) {
+    T sum = 0;
+    for (size_t k = 0; k < count; ++k) {
+      sum += values[k] * input[columns[k]];
+    }
+    return sum;
+  }
+
+  //samples are transposed kTileRows at a time into an input_size x kTileRows tile, so every nonzero weight is
+  //applied to all of them with one contiguous multiply add
+  template<typename T>
+  void SparseForward(const uint32_t *row_offsets, const uint32_t *columns, const T *values, const T *biases,
+                     const T *inputs, T *outputs, size_t batch_size, size_t input_size, size_t output_size) {
+    constexpr size_t kTileRows = 8;
+    size_t i = 0;
+
+    if (batch_size >= kTileRows) {
+      thread_local AlignedVector<T> tile_storage;
+      tile_storage.resize(input_size * kTileRows);
+      T *tile = tile_storage.data();
+
+      for (; i + kTileRows <= batch_size; i += kTileRows) {
+        for (size_t r = 0; r < kTileRows; ++r) {
+          const T *input = inputs + (i + r) * input_size;
+          for (size_t k = 0; k < input_size; ++k) {
+            tile[k * kTileRows + r] = input[k];
+          }
+        }
+
+        for (size_t j = 0; j < output_size; ++j) {
+          T sums[kTileRows] = {};
+          for (uint32_t k = row_offsets[j]; k < row_offsets[j + 1]; ++k) {
+            const T value = values[k];
+            const T *column = tile + columns[k] * kTileRows;
+            for (size_t r = 0; r < kTileRows; ++r) {
+              sums[r] += value * column[r];
+            }
+          }
+          for (size_t r = 0; r < kTileRows; ++r) {
+            outputs[(i + r) * output_size + j] = sums[r] + biases[j];
+          }
+        }
+      }
+    }
+
+    for (; i < batch_size; ++i) {
+      const T *input = inputs + i * input_size;
+      T *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        output[j] = SparseDot(columns + row_offsets[j], values + row_offsets[j], row_offsets[j + 1] - row_offsets[j],
+                              input) + biases[j];
+      }
+    }
+  }
+
+#if NEURALNET_X86_DISPATCH
+
+  //eight nonzeros per gather
+  __attribute__((target("avx2,fma")))
+  inline float SparseDotAVX2(const uint32_t *columns, const float *values, size_t count, const float *input) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t k = 0;
+    for (; k + 8 <= count; k += 8) {
+      const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(columns + k));
+      acc = _mm256_fmadd_ps(_mm256_loadu_ps(values + k), _mm256_i32gather_ps(input, index, 4), acc);
+    }
+    float sum = HorizontalSumAVX2(acc);
+    for (; k < count; ++k) {
+      sum += values[k] * input[columns[k]];
+    }
+    return sum;
+  }
+
+  //SparseForward with a tile of sixteen samples held in two registers per input column
+  __attribute__((target("avx2,fma")))
+  inline void SparseForwardAVX2(const uint32_t *row_offsets, const uint32_t *columns, const float *values,
+                                const float *biases, const float *inputs, float *outputs, size_t batch_size,
+                                size_t input_size, size_t output_size) {
+    constexpr size_t kTileRows = 16;
+    size_t i = 0;
+
+    if (batch_size >= kTileRows) {
+      thread_local AlignedVector<float> tile_storage;
+      tile_storage.resize(input_size * kTileRows);
+      float *tile = tile_storage.data();
+
+      for (; i + kTileRows <= batch_size; i += kTileRows) {
+        for (size_t r = 0; r < kTileRows; ++r) {
+          const float *input = inputs + (i + r) * input_size;
+          for (size_t k = 0; k < input_size; ++k) {
+            tile[k * kTileRows + r] = input[k];
+          }
+        }
+
+        for (size_t j = 0; j < output_size; ++j) {
+          __m256 acc0 = _mm256_setzero_ps();
+          __m256 acc1 = _mm256_setzero_ps();
+          __m256 acc2 = _mm256_setzero_ps();
+          __m256 acc3 = _mm256_setzero_ps();
+
+          uint32_t k = row_offsets[j];
+          const uint32_t end = row_offsets[j + 1];
+          for (; k + 2 <= end; k += 2) {
+            const __m256 value0 = _mm256_set1_ps(values[k]);
+            const __m256 value1 = _mm256_set1_ps(values[k + 1]);
+            const float *column0 = tile + columns[k] * kTileRows;
+            const float *column1 = tile + columns[k + 1] * kTileRows;
+            acc0 = _mm256_fmadd_ps(value0, _mm256_load_ps(column0), acc0);
+            acc1 = _mm256_fmadd_ps(value0, _mm256_load_ps(column0 + 8), acc1);
+            acc2 = _mm256_fmadd_ps(value1, _mm256_load_ps(column1), acc2);
+            acc3 = _mm256_fmadd_ps(value1, _mm256_load_ps(column1 + 8), acc3);
+          }
+          if (k < end) {
+            const __m256 value = _mm256_set1_ps(values[k]);
+            const float *column = tile + columns[k] * kTileRows;
+            acc0 = _mm256_fmadd_ps(value, _mm256_load_ps(column), acc0);
+            acc1 = _mm256_fmadd_ps(value, _mm256_load_ps(column + 8), acc1);
+          }
+
+          const __m256 bias = _mm256_set1_ps(biases[j]);
+          alignas(32) float sums[kTileRows];
+          _mm256_store_ps(sums, _mm256_add_ps(_mm256_add_ps(acc0, acc2), bias));
+          _mm256_store_ps(sums + 8, _mm256_add_ps(_mm256_add_ps(acc1, acc3), bias));
+          for (size_t r = 0; r < kTileRows; ++r) {
+            outputs[(i + r) * output_size + j] = sums[r];
+          }
+        }
+      }
+    }
+
+    for (; i < batch_size; ++i) {
+      const float *input = inputs + i * input_size;
+      float *output = outputs + i * output_size;
+
+      for (size_t j = 0; j < output_size; ++j) {
+        output[j] = SparseDotAVX2(columns + row_offsets[j], values + row_offsets[j],
+                                  row_offsets[j + 1] - row_offsets[j], input) + biases[j];
+      }
+    }
+  }
+
+#endif
+
+}
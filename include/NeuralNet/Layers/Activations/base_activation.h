@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+#include <stdexcept>
+
 #include <NeuralNet/Layers/base_layer.h>
 
 namespace NeuralNet {
@@ -18,33 +21,15 @@ namespace NeuralNet {
       return 0;
     }
 
-    void Forward(const std::vector<std::vector<dataType> *> &inputs,
-                 std::vector<std::vector<dataType> *> &outputs) override {
-      this->ForwardAssert(inputs, outputs);
+   protected:
 
-      const size_t inputs_size = inputs.size();
-      for (int i = 0; i < inputs_size; ++i) {
-        ForwardActivate(*(inputs[i]), *(outputs[i]));
+    PlanStep<dataType> MakeStep() const {
+      if (this->input_size_ != this->output_size_) {
+        throw std::runtime_error("Activation layer " + std::to_string(this->layer_id_) + " maps " +
+            std::to_string(this->input_size_) + " inputs to " + std::to_string(this->output_size_) + " outputs");
       }
+      return BaseLayer<dataType>::MakeStep();
     }
-
-    void Backward(const std::vector<std::vector<dataType> *> &inputs,
-                  const std::vector<std::vector<dataType> *> &outputs,
-                  const std::vector<std::vector<dataType>> &deltas,
-                  std::vector<std::vector<dataType>> &prev_deltas,
-                  std::vector<dataType> &grad_weights) override {
-      this->BackwardAssert(inputs, outputs, deltas, prev_deltas, grad_weights);
-
-      const size_t inputs_size = inputs.size();
-      for (int i = 0; i < inputs_size; ++i) {
-        BackwardActivate(*(inputs[i]), *(outputs[i]), deltas[i], prev_deltas[i]);
-      }
-    }
-
-    virtual void ForwardActivate(const std::vector<dataType> &input, std::vector<dataType> &output) = 0;
-
-    virtual void BackwardActivate(const std::vector<dataType> &input, const std::vector<dataType> &output,
-                                  const std::vector<dataType> &delta, std::vector<dataType> &prev_delta) = 0;
   };
 
-}
\ No newline at end of file
+}
@@ -23,18 +23,35 @@ namespace NeuralNet {
     explicit LeakyReLuActivation(size_t input_size, size_t output_size, float alpha = 0.01f)
         : BaseActivation<dataType>(input_size, output_size), alpha_(alpha) {}
 
-    void ForwardActivate(const std::vector<dataType> &input, std::vector<dataType> &output) override {
-      size_t input_size = input.size();
-      for (size_t i = 0; i < input_size; ++i) {
-        output[i] = (input[i] > 0) ? input[i] : alpha_ * input[i];
+    [[nodiscard]] dataType Alpha() const {
+      return alpha_;
+    }
+
+    [[nodiscard]] PlanStep<dataType> Lower(size_t, Kernels::ISA) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.forward = &ForwardKernel;
+      step.backward = &BackwardKernel;
+      step.kernel_name = "leaky_relu";
+      return step;
+    }
+
+    static void ForwardKernel(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                              size_t batch_size) {
+      const dataType alpha = static_cast<const LeakyReLuActivation *>(step.layer)->alpha_;
+      const size_t size = batch_size * step.input_size;
+      for (size_t i = 0; i < size; ++i) {
+        outputs[i] = (inputs[i] > 0) ? inputs[i] : alpha * inputs[i];
       }
     }
 
-    void BackwardActivate(const std::vector<dataType> &input, const std::vector<dataType> &output,
-                          const std::vector<dataType> &delta, std::vector<dataType> &prev_delta) override {
-      size_t input_size = input.size();
-      for (size_t i = 0; i < input_size; ++i) {
-        prev_delta[i] = (output[i] > 0) ? delta[i] : alpha_ * delta[i];
+    static void BackwardKernel(const PlanStep<dataType> &step, const dataType *, const dataType *outputs,
+                               const dataType *deltas, dataType *prev_deltas, dataType *, size_t batch_size) {
+      if (!prev_deltas) return;
+
+      const dataType alpha = static_cast<const LeakyReLuActivation *>(step.layer)->alpha_;
+      const size_t size = batch_size * step.input_size;
+      for (size_t i = 0; i < size; ++i) {
+        prev_deltas[i] = (outputs[i] > 0) ? deltas[i] : alpha * deltas[i];
       }
     }
 
@@ -43,11 +60,9 @@ namespace NeuralNet {
          << this->output_size_ << std::endl;
     }
 
-    void Save(std::ofstream &file) const override {
-      file.write(reinterpret_cast<const char *>(&LayerTypeTraits<LeakyReLuActivation<dataType>>::type),
-                 sizeof(LayerTypeTraits<LeakyReLuActivation<dataType>>::type));
-      file.write(reinterpret_cast<const char *>(&this->input_size_), sizeof(this->input_size_));
-      file.write(reinterpret_cast<const char *>(&alpha_), sizeof(alpha_));
+    void Save(ModelWriter &writer) const override {
+      writer.Layer(LayerTypeTraits<LeakyReLuActivation<dataType>>::type, this->input_size_, this->output_size_)
+          .Attribute(0, alpha_);
     }
 
   };
@@ -19,18 +19,29 @@ namespace NeuralNet {
 
     ReLuActivation(size_t input_size, size_t output_size) : BaseActivation<dataType>(input_size, output_size) {}
 
-    void ForwardActivate(const std::vector<dataType> &input, std::vector<dataType> &output) override {
-      size_t input_size = input.size();
-      for (size_t i = 0; i < input_size; ++i) {
-        output[i] = (input[i] > 0) ? input[i] : 0;
+    [[nodiscard]] PlanStep<dataType> Lower(size_t, Kernels::ISA) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.forward = &ForwardKernel;
+      step.backward = &BackwardKernel;
+      step.kernel_name = "relu";
+      return step;
+    }
+
+    static void ForwardKernel(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                              size_t batch_size) {
+      const size_t size = batch_size * step.input_size;
+      for (size_t i = 0; i < size; ++i) {
+        outputs[i] = (inputs[i] > 0) ? inputs[i] : 0;
       }
     }
 
-    void BackwardActivate(const std::vector<dataType> &input, const std::vector<dataType> &output,
-                          const std::vector<dataType> &delta, std::vector<dataType> &prev_delta) override {
-      size_t input_size = input.size();
-      for (size_t i = 0; i < input_size; ++i) {
-        prev_delta[i] = (output[i] > 0) ? delta[i] : 0;
+    static void BackwardKernel(const PlanStep<dataType> &step, const dataType *, const dataType *outputs,
+                               const dataType *deltas, dataType *prev_deltas, dataType *, size_t batch_size) {
+      if (!prev_deltas) return;
+
+      const size_t size = batch_size * step.input_size;
+      for (size_t i = 0; i < size; ++i) {
+        prev_deltas[i] = (outputs[i] > 0) ? deltas[i] : 0;
       }
     }
 
@@ -39,9 +50,8 @@ namespace NeuralNet {
          << std::endl;
     }
 
-    void Save(std::ofstream &file) const override {
-      file.write(reinterpret_cast<const char *>(&LayerTypeTraits<ReLuActivation<dataType>>::type), sizeof(LayerType));
-      file.write(reinterpret_cast<const char *>(&this->input_size_), sizeof(size_t));
+    void Save(ModelWriter &writer) const override {
+      writer.Layer(LayerTypeTraits<ReLuActivation<dataType>>::type, this->input_size_, this->output_size_);
     }
   };
 
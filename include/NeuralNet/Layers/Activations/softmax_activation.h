@@ -20,24 +20,39 @@ namespace NeuralNet {
     SoftmaxActivation(size_t input_size, size_t output_size) : BaseActivation<dataType>(input_size,
                                                                                         output_size) {}
 
-    void ForwardActivate(const std::vector<dataType> &input, std::vector<dataType> &output) override {
-      size_t input_size = input.size();
-      dataType sum = 0;
-      for (size_t i = 0; i < input_size; ++i) {
-        output[i] = exp(input[i]);
-        sum += output[i];
-      }
-      for (size_t i = 0; i < input_size; ++i) {
-        output[i] /= sum;
+    [[nodiscard]] PlanStep<dataType> Lower(size_t, Kernels::ISA) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.forward = &ForwardKernel;
+      step.backward = &BackwardKernel;
+      step.kernel_name = "softmax";
+      return step;
+    }
+
+    static void ForwardKernel(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                              size_t batch_size) {
+      const size_t input_size = step.input_size;
+      for (size_t b = 0; b < batch_size; ++b) {
+        const dataType *input = inputs + b * input_size;
+        dataType *output = outputs + b * input_size;
+
+        dataType sum = 0;
+        for (size_t i = 0; i < input_size; ++i) {
+          output[i] = std::exp(input[i]);
+          sum += output[i];
+        }
+        for (size_t i = 0; i < input_size; ++i) {
+          output[i] /= sum;
+        }
       }
     }
 
-    void BackwardActivate(const std::vector<dataType> &input, const std::vector<dataType> &output,
-                          const std::vector<dataType> &delta, std::vector<dataType> &prev_delta) override {
-      size_t input_size = input.size();
-      for (size_t i = 0; i < input_size; ++i) {
-        prev_delta[i] = output[i] * (dataType(1) - output[i]) * delta[i];
+    static void BackwardKernel(const PlanStep<dataType> &step, const dataType *, const dataType *outputs,
+                               const dataType *deltas, dataType *prev_deltas, dataType *, size_t batch_size) {
+      if (!prev_deltas) return;
 
+      const size_t size = batch_size * step.input_size;
+      for (size_t i = 0; i < size; ++i) {
+        prev_deltas[i] = outputs[i] * (dataType(1) - outputs[i]) * deltas[i];
       }
     }
 
@@ -46,10 +61,8 @@ namespace NeuralNet {
          << this->output_size_ << std::endl;
     }
 
-    void Save(std::ofstream &file) const override {
-      file.write(reinterpret_cast<const char *>(&LayerTypeTraits<SoftmaxActivation<dataType>>::type),
-                 sizeof(LayerType));
-      file.write(reinterpret_cast<const char *>(&this->input_size_), sizeof(size_t));
+    void Save(ModelWriter &writer) const override {
+      writer.Layer(LayerTypeTraits<SoftmaxActivation<dataType>>::type, this->input_size_, this->output_size_);
     }
   };
 
@@ -4,9 +4,14 @@
 #include <cstdio>
 #include <fstream>
 #include <cassert>
+#include <string>
+#include <stdexcept>
 
 #include <NeuralNet/misc/types.h>
 #include <NeuralNet/misc/layer_type.h>
+#include <NeuralNet/Model/plan_step.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Kernels/cpu_features.h>
 
 namespace NeuralNet {
 
@@ -44,55 +49,35 @@ namespace NeuralNet {
 
     [[nodiscard]] virtual bool Trainable() const = 0;
 
-    virtual void Forward(const std::vector<std::vector<dataType> *> &inputs,
-                         std::vector<std::vector<dataType> *> &outputs) = 0;
+    //picks the kernels used for this layer, called once when an ExecutionPlan is compiled
+    [[nodiscard]] virtual PlanStep<dataType> Lower(size_t batch_size, Kernels::ISA isa) const = 0;
 
-    virtual void Backward(const std::vector<std::vector<dataType> *> &inputs,
-                          const std::vector<std::vector<dataType> *> &outputs,
-                          const std::vector<std::vector<dataType>> &deltas,
-                          std::vector<std::vector<dataType>> &prev_deltas,
-                          std::vector<dataType> &grad_weights) = 0;
+    //whether the layer can be first in a plan whose inputs are stored as uint8/int16
+    [[nodiscard]] virtual bool AcceptsEncodedInput() const {
+      return false;
+    }
+
+    //like Lower, but the kernels dequantize the encoded inputs themselves
+    [[nodiscard]] virtual PlanStep<dataType> LowerEncodedInput(size_t, Kernels::ISA, const InputFormat<dataType> &) const {
+      throw std::runtime_error("Layer " + std::to_string(layer_id_) + " does not accept encoded inputs");
+    }
 
     virtual void Print(std::ostream &os, bool weights) const = 0;
 
-    virtual void Save(std::ofstream &os) const = 0;
+    //appends the layer record and its parameter blocks, see ModelFormat
+    virtual void Save(ModelWriter &writer) const = 0;
 
     friend class NeuralNetwork<dataType>;
 
    protected:
 
-    void ForwardAssert(const std::vector<std::vector<dataType> *> &inputs,
-                       const std::vector<std::vector<dataType> *> &outputs) const {
-      assert(inputs.size() == outputs.size());
-      for (int i = 0; i < inputs.size(); ++i) {
-        assert(inputs[i]->size() == this->input_size_);
-      }
-      for (int i = 0; i < outputs.size(); ++i) {
-        assert(outputs[i]->size() == this->output_size_);
-      }
-    }
-
-    void BackwardAssert(const std::vector<std::vector<dataType> *> &inputs,
-                        const std::vector<std::vector<dataType> *> &outputs,
-                        const std::vector<std::vector<dataType>> &deltas,
-                        const std::vector<std::vector<dataType>> &prev_deltas,
-                        const std::vector<dataType> &) const {
-      assert(inputs.size() == outputs.size());
-      assert(inputs.size() == deltas.size());
-      assert(inputs.size() == prev_deltas.size());
-      for (int i = 0; i < inputs.size(); ++i) {
-        assert(inputs[i]->size() == this->input_size_);
-      }
-      for (int i = 0; i < outputs.size(); ++i) {
-        assert(outputs[i]->size() == this->output_size_);
-      }
-      for (int i = 0; i < deltas.size(); ++i) {
-        assert(deltas[i].size() == this->output_size_);
-      }
-      for (int i = 0; i < prev_deltas.size(); ++i) {
-        assert(prev_deltas[i].size() == this->input_size_);
-      }
+    PlanStep<dataType> MakeStep() const {
+      PlanStep<dataType> step;
+      step.layer = this;
+      step.input_size = input_size_;
+      step.output_size = output_size_;
+      return step;
     }
   };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <NeuralNet/Layers/bit_fully_connected_layer.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType = NNFLOAT>
+  class BinaryFullyConnectedLayer;
+
+  template<std::floating_point T>
+  struct LayerTypeTraits<BinaryFullyConnectedLayer<T>> {
+    static constexpr LayerType type = LayerType::BinaryFullyConnected;
+  };
+
+  //fully connected layer with +-scale weights, one scale per output, and inputs binarized to their sign, so every
+  //dot product is an xor and popcount over 64 inputs at a time. trains through float shadow weights, see
+  //BitFullyConnectedLayer, and packs 32 weights per float of a FullyConnectedLayer, see PackBitWeights
+  template<std::floating_point dataType>
+  class BinaryFullyConnectedLayer : public BitFullyConnectedLayer<dataType, false> {
+   public:
+
+    using BitFullyConnectedLayer<dataType, false>::BitFullyConnectedLayer;
+  };
+
+}
@@ -0,0 +1,391 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include <stdexcept>
+
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Model/model_reader.h>
+#include <NeuralNet/Kernels/dense_kernels.h>
+#include <NeuralNet/Kernels/bit_kernels.h>
+#include <NeuralNet/Layers/base_trainable_layer.h>
+
+namespace NeuralNet {
+
+  //fully connected layer with binary, +-scale, or ternary, 0 or +-scale, weights and one scale per output, see
+  //BinaryFullyConnectedLayer and TernaryFullyConnectedLayer. its inputs are binarized to their sign, so the dot
+  //products are popcounts over bit planes, see bit_kernels.h.
+  //a layer is either trainable, keeping float shadow weights quantized before every forward pass and receiving the
+  //gradients of the quantized ones unchanged (straight through estimator, input deltas are zeroed where |input| > 1
+  //and the shadow weights are clipped to [-1, 1]), or packed into bit planes for inference only, see PackBitWeights.
+  //the model file stores the shadow weights of trainable layers, attribute 0 is 0, or the bit planes followed by
+  //the scales and biases of packed ones, attribute 0 is 1
+  template<std::floating_point dataType, bool kTernary>
+  class BitFullyConnectedLayer : public BaseTrainableLayer<dataType> {
+   private:
+
+    std::vector<dataType> weights_biases_;
+
+    //shadow weights followed by biases, either weights_biases_ or the block of a mapped model file kept alive by
+    //mapping_, null for packed layers
+    const dataType *parameters_ = nullptr;
+    std::shared_ptr<const MappedFile> mapping_;
+
+    std::vector<dataType> scales_storage_;
+    std::vector<dataType> biases_storage_;
+    std::vector<uint32_t> nonzeros_;
+
+    //mapped bit planes and the output_size scales and biases of packed layers, either the storage_ vectors or
+    //mapped blocks as well
+    const uint64_t *signs_ = nullptr;
+    const uint64_t *masks_ = nullptr;
+    const dataType *scales_ = nullptr;
+    const dataType *biases_ = nullptr;
+
+    static constexpr LayerType kType = kTernary ? LayerType::TernaryFullyConnected : LayerType::BinaryFullyConnected;
+
+   public:
+
+    //trainable layer, the shadow weights start at zero for an initializer to set
+    BitFullyConnectedLayer(size_t input_size, size_t output_size) :
+        BaseTrainableLayer<dataType>(input_size, output_size), weights_biases_(input_size * output_size + output_size),
+        parameters_(weights_biases_.data()) {}
+
+    //uses the blocks in place when the file stores dataType values
+    explicit BitFullyConnectedLayer(const ModelReader::LayerView &layer) :
+        BaseTrainableLayer<dataType>(layer.InputSize(), layer.OutputSize()) {
+      const size_t input_size = layer.InputSize();
+      const size_t output_size = layer.OutputSize();
+
+      const double encoding = layer.Attribute(0);
+      if (encoding == 0) {
+        if (layer.BlockIs<dataType>(0)) {
+          parameters_ = layer.Block<dataType>(0, ParametersSize());
+          mapping_ = layer.Mapping();
+        } else {
+          weights_biases_ = layer.ConvertBlock<dataType>(0, ParametersSize());
+          parameters_ = weights_biases_.data();
+        }
+        return;
+      }
+      if (encoding != 1) {
+        throw layer.Error("invalid bit weight encoding");
+      }
+
+      const size_t words = Kernels::BitWords(input_size);
+      const size_t planes = kTernary ? 2 : 1;
+
+      signs_ = layer.Block<uint64_t>(0, output_size * words);
+      masks_ = kTernary ? layer.Block<uint64_t>(1, output_size * words) : nullptr;
+      mapping_ = layer.Mapping();
+
+      if (layer.BlockIs<dataType>(planes)) {
+        scales_ = layer.Block<dataType>(planes, output_size);
+        biases_ = layer.Block<dataType>(planes + 1, output_size);
+      } else {
+        scales_storage_ = layer.ConvertBlock<dataType>(planes, output_size);
+        biases_storage_ = layer.ConvertBlock<dataType>(planes + 1, output_size);
+        scales_ = scales_storage_.data();
+        biases_ = biases_storage_.data();
+      }
+
+      //the kernels count every bit of the words, the ones past input_size have to be clear
+      const uint64_t padding = input_size % 64 ? ~uint64_t(0) << (input_size % 64) : 0;
+      const uint64_t *counted = kTernary ? masks_ : signs_;
+      for (size_t j = 0; j < output_size; ++j) {
+        if (counted[j * words + words - 1] & padding) {
+          throw layer.Error("bit planes have padding bits set");
+        }
+      }
+
+      if constexpr (kTernary) {
+        nonzeros_.resize(output_size);
+        for (size_t j = 0; j < output_size; ++j) {
+          uint32_t count = 0;
+          for (size_t w = 0; w < words; ++w) {
+            count += static_cast<uint32_t>(std::popcount(masks_[j * words + w]));
+          }
+          nonzeros_[j] = count;
+        }
+      }
+    }
+
+    [[nodiscard]] bool Packed() const {
+      return parameters_ == nullptr;
+    }
+
+    [[nodiscard]] size_t ParametersSize() const override {
+      return Packed() ? 0 : this->input_size_ * this->output_size_ + this->output_size_;
+    }
+
+    [[nodiscard]] bool Trainable() const override {
+      return !Packed();
+    }
+
+    //shadow weights followed by biases without detaching a mapped model file, null for packed layers
+    [[nodiscard]] const dataType *WeightsBiases() const {
+      return parameters_;
+    }
+
+    //copies mapped parameters into the layer first
+    [[nodiscard]] std::vector<dataType> &Parameters() override {
+      if (Packed()) {
+        throw std::runtime_error("Packed bit layer " + std::to_string(this->layer_id_) + " has no shadow weights");
+      }
+      if (mapping_) {
+        weights_biases_.assign(parameters_, parameters_ + ParametersSize());
+        parameters_ = weights_biases_.data();
+        mapping_.reset();
+      }
+      return weights_biases_;
+    }
+
+    void UpdateParameters(const std::vector<dataType> &updates) override {
+      std::vector<dataType> &weights_biases = Parameters();
+      const size_t weights_size = this->input_size_ * this->output_size_;
+
+      for (size_t i = 0; i < weights_size; ++i) {
+        weights_biases[i] = std::clamp(weights_biases[i] + updates[i], dataType(-1), dataType(1));
+      }
+      for (size_t i = weights_size; i < weights_biases.size(); ++i) {
+        weights_biases[i] += updates[i];
+      }
+    }
+
+    //output_size x input_size weights as used by the kernels, -scale, 0 or scale
+    [[nodiscard]] std::vector<dataType> QuantizedWeights() const {
+      const size_t input_size = this->input_size_;
+      const size_t output_size = this->output_size_;
+      std::vector<dataType> weights(input_size * output_size);
+
+      if (!Packed()) {
+        std::vector<dataType> scales(output_size);
+        Kernels::QuantizeBitWeights(parameters_, weights.data(), scales.data(), input_size, output_size, kTernary);
+        return weights;
+      }
+
+      const size_t words = Kernels::BitWords(input_size);
+      for (size_t j = 0; j < output_size; ++j) {
+        for (size_t k = 0; k < input_size; ++k) {
+          const size_t word = j * words + k / 64;
+          const uint64_t bit = uint64_t(1) << (k % 64);
+          if (!masks_ || (masks_[word] & bit)) {
+            weights[j * input_size + k] = signs_[word] & bit ? -scales_[j] : scales_[j];
+          }
+        }
+      }
+      return weights;
+    }
+
+    [[nodiscard]] PlanStep<dataType> Lower(size_t, Kernels::ISA isa) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.mapping = mapping_;
+      const bool popcnt = isa >= Kernels::ISA::AVX2 && Kernels::HasPopcnt();
+
+      if (Packed()) {
+        step.backward = &BackwardPacked;
+        step.forward = &ForwardPacked<false>;
+        step.kernel_name = kTernary ? "ternary" : "binary";
+#if NEURALNET_X86_DISPATCH
+        if (popcnt) {
+          step.forward = &ForwardPacked<true>;
+          step.kernel_name = kTernary ? "ternary_popcnt" : "binary_popcnt";
+        }
+#endif
+        return step;
+      }
+
+      step.parameters = parameters_;
+      step.parameters_size = ParametersSize();
+      step.forward = &ForwardShadow<false>;
+      step.backward = &BackwardShadow<false>;
+      step.kernel_name = kTernary ? "ternary_shadow" : "binary_shadow";
+#if NEURALNET_X86_DISPATCH
+      if (popcnt) {
+        step.forward = &ForwardShadow<true>;
+        step.kernel_name = kTernary ? "ternary_shadow_popcnt" : "binary_shadow_popcnt";
+        if constexpr (std::is_same_v<dataType, float>) {
+          step.backward = &BackwardShadow<true>;
+        }
+      }
+#endif
+      return step;
+    }
+
+    void Print(std::ostream &os, bool weights) const override {
+      const size_t input_size = this->input_size_;
+      const size_t output_size = this->output_size_;
+
+      os << "ID: " << this->layer_id_ << (kTernary ? " TernaryFullyConnectedLayer: " : " BinaryFullyConnectedLayer: ")
+         << input_size << " -> " << output_size << (Packed() ? ", packed" : "") << std::endl;
+
+      if (weights) {
+        const std::vector<dataType> quantized = QuantizedWeights();
+        const dataType *biases = Packed() ? biases_ : parameters_ + input_size * output_size;
+
+        os << "Parameters: " << std::endl;
+        for (size_t i = 0; i < output_size; ++i) {
+          for (size_t j = 0; j < input_size; ++j) {
+            os << quantized[i * input_size + j] << " ";
+          }
+          os << std::endl;
+        }
+        os << "Biases: " << std::endl;
+        for (size_t i = 0; i < output_size; ++i) {
+          os << biases[i] << " ";
+        }
+        os << std::endl;
+      }
+    }
+
+    void Save(ModelWriter &writer) const override {
+      if (!Packed()) {
+        writer.Layer(kType, this->input_size_, this->output_size_)
+            .Attribute(0, 0)
+            .Block(parameters_, ParametersSize());
+        return;
+      }
+
+      const size_t planes_size = this->output_size_ * Kernels::BitWords(this->input_size_);
+      writer.Layer(kType, this->input_size_, this->output_size_).Attribute(0, 1).Block(signs_, planes_size);
+      if (kTernary) {
+        writer.Block(masks_, planes_size);
+      }
+      writer.Block(scales_, this->output_size_).Block(biases_, this->output_size_);
+    }
+
+    //saves the layer in the packed encoding, which loads as an inference only layer
+    void SavePacked(ModelWriter &writer) const {
+      if (Packed()) {
+        Save(writer);
+        return;
+      }
+
+      const size_t input_size = this->input_size_;
+      const size_t output_size = this->output_size_;
+      const size_t planes_size = output_size * Kernels::BitWords(input_size);
+
+      std::vector<dataType> weights(input_size * output_size);
+      std::vector<dataType> scales(output_size);
+      AlignedVector<uint64_t> signs(planes_size);
+      AlignedVector<uint64_t> masks(kTernary ? planes_size : 0);
+      std::vector<uint32_t> nonzeros(output_size);
+
+      Kernels::QuantizeBitWeights(parameters_, weights.data(), scales.data(), input_size, output_size, kTernary);
+      Kernels::PackBitWeights(weights.data(), signs.data(), kTernary ? masks.data() : nullptr, nonzeros.data(),
+                              input_size, output_size);
+
+      writer.Layer(kType, input_size, output_size).Attribute(0, 1).BlockCopy(signs.data(), planes_size);
+      if (kTernary) {
+        writer.BlockCopy(masks.data(), planes_size);
+      }
+      writer.BlockCopy(scales.data(), output_size).Block(parameters_ + input_size * output_size, output_size);
+    }
+
+   private:
+
+    template<bool kPopcnt>
+    static void RunBitForward(const uint64_t *signs, const uint64_t *masks, const uint32_t *nonzeros,
+                              const dataType *scales, const dataType *biases, const dataType *inputs,
+                              dataType *outputs, size_t batch_size, size_t input_size, size_t output_size) {
+#if NEURALNET_X86_DISPATCH
+      if constexpr (kPopcnt) {
+        Kernels::BitForwardPopcnt<kTernary>(signs, masks, nonzeros, scales, biases, inputs, outputs, batch_size,
+                                            input_size, output_size);
+        return;
+      }
+#endif
+      Kernels::BitForward<kTernary>(signs, masks, nonzeros, scales, biases, inputs, outputs, batch_size,
+                                    input_size, output_size);
+    }
+
+    template<bool kPopcnt>
+    static void ForwardPacked(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                              size_t batch_size) {
+      const auto &layer = *static_cast<const BitFullyConnectedLayer *>(step.layer);
+      RunBitForward<kPopcnt>(layer.signs_, layer.masks_, layer.nonzeros_.data(), layer.scales_, layer.biases_, inputs,
+                             outputs, batch_size, step.input_size, step.output_size);
+    }
+
+    //the shadow weights are quantized and packed on every call, so training runs the arithmetic of inference
+    template<bool kPopcnt>
+    static void ForwardShadow(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                              size_t batch_size) {
+      const size_t input_size = step.input_size;
+      const size_t output_size = step.output_size;
+      const size_t planes_size = output_size * Kernels::BitWords(input_size);
+
+      thread_local std::vector<dataType> weights;
+      thread_local std::vector<dataType> scales;
+      thread_local AlignedVector<uint64_t> signs;
+      thread_local AlignedVector<uint64_t> masks;
+      thread_local std::vector<uint32_t> nonzeros;
+      weights.resize(input_size * output_size);
+      scales.resize(output_size);
+      signs.resize(planes_size);
+      masks.resize(kTernary ? planes_size : 0);
+      nonzeros.resize(output_size);
+
+      Kernels::QuantizeBitWeights(step.parameters, weights.data(), scales.data(), input_size, output_size, kTernary);
+      Kernels::PackBitWeights(weights.data(), signs.data(), kTernary ? masks.data() : nullptr, nonzeros.data(),
+                              input_size, output_size);
+
+      RunBitForward<kPopcnt>(signs.data(), kTernary ? masks.data() : nullptr, nonzeros.data(), scales.data(),
+                             step.parameters + input_size * output_size, inputs, outputs, batch_size, input_size,
+                             output_size);
+    }
+
+    //gradients of the quantized weights and binarized inputs, passed straight through to the shadow weights and
+    //to the inputs within [-1, 1]
+    template<bool kAVX2>
+    static void BackwardShadow(const PlanStep<dataType> &step, const dataType *inputs, const dataType *,
+                               const dataType *deltas, dataType *prev_deltas, dataType *grad_parameters,
+                               size_t batch_size) {
+      const size_t input_size = step.input_size;
+      const size_t output_size = step.output_size;
+
+      thread_local AlignedVector<dataType> weights;
+      thread_local std::vector<dataType> scales;
+      thread_local AlignedVector<dataType> binarized;
+      weights.resize(input_size * output_size);
+      scales.resize(output_size);
+      binarized.resize(batch_size * input_size);
+
+      Kernels::QuantizeBitWeights(step.parameters, weights.data(), scales.data(), input_size, output_size, kTernary);
+      for (size_t i = 0; i < batch_size * input_size; ++i) {
+        binarized[i] = Kernels::BinarizeSign(inputs[i]);
+      }
+
+#if NEURALNET_X86_DISPATCH
+      if constexpr (kAVX2) {
+        Kernels::DenseBackwardAVX2(weights.data(), binarized.data(), deltas, prev_deltas, grad_parameters,
+                                   batch_size, input_size, output_size);
+      } else
+#endif
+      {
+        Kernels::DenseBackward(weights.data(), binarized.data(), deltas, prev_deltas, grad_parameters, batch_size,
+                               input_size, output_size);
+      }
+
+      if (prev_deltas) {
+        for (size_t i = 0; i < batch_size * input_size; ++i) {
+          if (std::abs(inputs[i]) > 1) {
+            prev_deltas[i] = 0;
+          }
+        }
+      }
+    }
+
+    static void BackwardPacked(const PlanStep<dataType> &step, const dataType *, const dataType *, const dataType *,
+                               dataType *, dataType *, size_t) {
+      throw std::runtime_error("Packed bit layer " + std::to_string(step.layer->LayerID()) + " cannot be trained");
+    }
+  };
+
+}
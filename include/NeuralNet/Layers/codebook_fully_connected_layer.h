@@ -0,0 +1,235 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <stdexcept>
+
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Model/model_reader.h>
+#include <NeuralNet/Kernels/codebook_kernels.h>
+#include <NeuralNet/Layers/base_layer.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType = NNFLOAT>
+  class CodebookFullyConnectedLayer;
+
+  template<std::floating_point T>
+  struct LayerTypeTraits<CodebookFullyConnectedLayer<T>> {
+    static constexpr LayerType type = LayerType::CodebookFullyConnected;
+  };
+
+  //inference only fully connected layer whose weights are 4 or 8 bit indices into a codebook of 16 or 256 values
+  //clustered from the trained weights, see CodebookWeights. the indices are looked up inside the kernels, biases
+  //stay dataType
+  template<std::floating_point dataType>
+  class CodebookFullyConnectedLayer : public BaseLayer<dataType> {
+   private:
+
+    std::vector<dataType> codebook_storage_;
+    AlignedVector<uint8_t> indices_storage_;
+    std::vector<dataType> biases_storage_;
+
+    //1 << index_bits_ codebook values, output_size rows of indices and output_size biases, either the storage_
+    //vectors or the blocks of a mapped model file kept alive by mapping_
+    const dataType *codebook_;
+    const uint8_t *indices_;
+    const dataType *biases_;
+    std::shared_ptr<const MappedFile> mapping_;
+
+    size_t index_bits_;
+
+   public:
+
+    //clusters the output_size x input_size weights of weights_biases into 1 << index_bits values, the output_size
+    //biases following them are kept as they are
+    CodebookFullyConnectedLayer(size_t input_size, size_t output_size, const dataType *weights_biases,
+                                size_t index_bits)
+        : BaseLayer<dataType>(input_size, output_size), codebook_storage_(size_t(1) << index_bits),
+          indices_storage_(output_size * Kernels::CodebookRowBytes(input_size, index_bits)),
+          biases_storage_(weights_biases + input_size * output_size,
+                          weights_biases + input_size * output_size + output_size),
+          index_bits_(index_bits) {
+      if (index_bits_ != 4 && index_bits_ != 8) {
+        throw std::runtime_error("Codebook indices must be 4 or 8 bits");
+      }
+
+      Kernels::ClusterValues(weights_biases, input_size * output_size, codebook_storage_.data(),
+                             codebook_storage_.size());
+      Kernels::AssignCodebook(weights_biases, codebook_storage_.data(), codebook_storage_.size(), index_bits_,
+                              indices_storage_.data(), input_size, output_size);
+
+      codebook_ = codebook_storage_.data();
+      indices_ = indices_storage_.data();
+      biases_ = biases_storage_.data();
+    }
+
+    //uses the indices in place, and the codebook and biases as well when the file stores dataType values
+    explicit CodebookFullyConnectedLayer(const ModelReader::LayerView &layer)
+        : BaseLayer<dataType>(layer.InputSize(), layer.OutputSize()),
+          index_bits_(static_cast<size_t>(layer.Attribute(0))) {
+      if (index_bits_ != 4 && index_bits_ != 8) {
+        throw layer.Error("invalid codebook index bits");
+      }
+
+      const size_t codebook_size = size_t(1) << index_bits_;
+      if (layer.BlockIs<dataType>(0)) {
+        codebook_ = layer.Block<dataType>(0, codebook_size);
+      } else {
+        codebook_storage_ = layer.ConvertBlock<dataType>(0, codebook_size);
+        codebook_ = codebook_storage_.data();
+      }
+
+      indices_ = layer.Block<uint8_t>(1, layer.OutputSize() * Kernels::CodebookRowBytes(layer.InputSize(),
+                                                                                       index_bits_));
+      mapping_ = layer.Mapping();
+
+      if (layer.BlockIs<dataType>(2)) {
+        biases_ = layer.Block<dataType>(2, layer.OutputSize());
+      } else {
+        biases_storage_ = layer.ConvertBlock<dataType>(2, layer.OutputSize());
+        biases_ = biases_storage_.data();
+      }
+    }
+
+    [[nodiscard]] size_t ParametersSize() const override {
+      return 0;
+    }
+
+    [[nodiscard]] bool Trainable() const override {
+      return false;
+    }
+
+    [[nodiscard]] size_t IndexBits() const {
+      return index_bits_;
+    }
+
+    [[nodiscard]] const dataType *Codebook() const {
+      return codebook_;
+    }
+
+    [[nodiscard]] const uint8_t *Indices() const {
+      return indices_;
+    }
+
+    [[nodiscard]] const dataType *Biases() const {
+      return biases_;
+    }
+
+    //output_size x input_size weights looked up from the codebook followed by the output_size biases, the layout
+    //of FullyConnectedLayer
+    [[nodiscard]] std::vector<dataType> DecodedWeightsBiases() const {
+      const size_t input_size = this->input_size_;
+      const size_t output_size = this->output_size_;
+      const size_t row_bytes = Kernels::CodebookRowBytes(input_size, index_bits_);
+
+      std::vector<dataType> weights_biases(input_size * output_size + output_size);
+      for (size_t j = 0; j < output_size; ++j) {
+        Decode(indices_ + j * row_bytes, weights_biases.data() + j * input_size);
+      }
+      std::copy(biases_, biases_ + output_size, weights_biases.begin() + input_size * output_size);
+      return weights_biases;
+    }
+
+    [[nodiscard]] PlanStep<dataType> Lower(size_t, Kernels::ISA isa) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.mapping = mapping_;
+      step.backward = &BackwardKernel;
+
+      if (index_bits_ == 4) {
+        step.forward = &ForwardGeneric<4>;
+        step.kernel_name = "codebook4";
+      } else {
+        step.forward = &ForwardGeneric<8>;
+        step.kernel_name = "codebook8";
+      }
+
+#if NEURALNET_X86_DISPATCH
+      if constexpr (std::is_same_v<dataType, float>) {
+        if (isa >= Kernels::ISA::AVX2 && this->input_size_ >= 8) {
+          if (index_bits_ == 4) {
+            step.forward = &ForwardAVX2<4>;
+            step.kernel_name = "codebook4_avx2";
+          } else {
+            step.forward = &ForwardAVX2<8>;
+            step.kernel_name = "codebook8_avx2";
+          }
+        }
+      }
+#endif
+      return step;
+    }
+
+    void Print(std::ostream &os, bool weights) const override {
+      const size_t input_size = this->input_size_;
+      const size_t output_size = this->output_size_;
+      const size_t row_bytes = Kernels::CodebookRowBytes(input_size, index_bits_);
+
+      os << "ID: " << this->layer_id_ << " CodebookFullyConnectedLayer: " << input_size << " -> " << output_size
+         << ", " << (size_t(1) << index_bits_) << " weight values" << std::endl;
+
+      if (weights) {
+        std::vector<dataType> row(input_size);
+        os << "Parameters: " << std::endl;
+        for (size_t i = 0; i < output_size; ++i) {
+          Decode(indices_ + i * row_bytes, row.data());
+          for (size_t j = 0; j < input_size; ++j) {
+            os << row[j] << " ";
+          }
+          os << std::endl;
+        }
+        os << "Biases: " << std::endl;
+        for (size_t i = 0; i < output_size; ++i) {
+          os << biases_[i] << " ";
+        }
+        os << std::endl;
+      }
+    }
+
+    void Save(ModelWriter &writer) const override {
+      writer.Layer(LayerTypeTraits<CodebookFullyConnectedLayer<dataType>>::type, this->input_size_,
+                   this->output_size_)
+          .Attribute(0, static_cast<double>(index_bits_))
+          .Block(codebook_, size_t(1) << index_bits_)
+          .Block(indices_, this->output_size_ * Kernels::CodebookRowBytes(this->input_size_, index_bits_))
+          .Block(biases_, this->output_size_);
+    }
+
+   private:
+
+    void Decode(const uint8_t *row, dataType *weights) const {
+      if (index_bits_ == 4) {
+        Kernels::DecodeCodebook<4>(codebook_, row, weights, this->input_size_);
+      } else {
+        Kernels::DecodeCodebook<8>(codebook_, row, weights, this->input_size_);
+      }
+    }
+
+    template<size_t kBits>
+    static void ForwardGeneric(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                               size_t batch_size) {
+      const auto &layer = *static_cast<const CodebookFullyConnectedLayer *>(step.layer);
+      Kernels::CodebookForward<kBits>(layer.codebook_, layer.indices_, layer.biases_, inputs, outputs, batch_size,
+                                      step.input_size, step.output_size);
+    }
+
+#if NEURALNET_X86_DISPATCH
+    template<size_t kBits>
+    static void ForwardAVX2(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                            size_t batch_size) {
+      const auto &layer = *static_cast<const CodebookFullyConnectedLayer *>(step.layer);
+      Kernels::CodebookForwardAVX2<kBits>(layer.codebook_, layer.indices_, layer.biases_, inputs, outputs,
+                                          batch_size, step.input_size, step.output_size);
+    }
+#endif
+
+    static void BackwardKernel(const PlanStep<dataType> &step, const dataType *, const dataType *, const dataType *,
+                               dataType *, dataType *, size_t) {
+      throw std::runtime_error("Codebook layer " + std::to_string(step.layer->LayerID()) + " cannot be trained");
+    }
+  };
+
+}
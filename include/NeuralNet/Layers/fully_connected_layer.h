@@ -1,6 +1,14 @@
 #pragma once
 
+#include <memory>
+#include <cstdint>
+#include <type_traits>
+
 #include <NeuralNet/misc/math_util.h>
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/Model/model_reader.h>
+#include <NeuralNet/Kernels/dense_kernels.h>
+#include <NeuralNet/Kernels/half_kernels.h>
 #include <NeuralNet/Layers/base_trainable_layer.h>
 
 namespace NeuralNet {
@@ -19,99 +27,105 @@ namespace NeuralNet {
 
     std::vector<dataType> weights_biases_;
 
-    const dataType *weights_;
-    const dataType *biases_;
+    //weights followed by biases, either weights_biases_ or the block of a mapped model file kept alive by mapping_
+    const dataType *parameters_;
+    std::shared_ptr<const MappedFile> mapping_;
 
    public:
 
     FullyConnectedLayer(size_t input_size, size_t output_size) :
-        BaseTrainableLayer<dataType>(input_size, output_size), weights_biases_(input_size * output_size + output_size) {
-      weights_ = weights_biases_.data();
-      biases_ = weights_ + this->input_size_ * this->output_size_;
+        BaseTrainableLayer<dataType>(input_size, output_size), weights_biases_(input_size * output_size + output_size),
+        parameters_(weights_biases_.data()) {}
+
+    //uses the parameters in place when the file stores dataType values, plans compiled before the parameters are
+    //first modified through Parameters() keep reading the mapped values
+    explicit FullyConnectedLayer(const ModelReader::LayerView &layer) :
+        BaseTrainableLayer<dataType>(layer.InputSize(), layer.OutputSize()) {
+      if (layer.BlockIs<dataType>(0)) {
+        parameters_ = layer.Block<dataType>(0, ParametersSize());
+        mapping_ = layer.Mapping();
+      } else {
+        weights_biases_ = layer.ConvertBlock<dataType>(0, ParametersSize());
+        parameters_ = weights_biases_.data();
+      }
     }
 
     [[nodiscard]] size_t ParametersSize() const override {
-      return weights_biases_.size();
+      return this->input_size_ * this->output_size_ + this->output_size_;
     }
 
-    [[nodiscard]] std::vector<dataType> &Parameters() override {
-      return weights_biases_;
+    //weights followed by biases without detaching a mapped model file
+    [[nodiscard]] const dataType *WeightsBiases() const {
+      return parameters_;
     }
 
-    void Forward(const std::vector<std::vector<dataType> *> &inputs,
-                 std::vector<std::vector<dataType> *> &outputs) override {
-      this->ForwardAssert(inputs, outputs);
-
-      const size_t inputs_size = inputs.size();
-      const size_t input_size = this->input_size_;
-      const size_t output_size = this->output_size_;
-
-      for (int i = 0; i < inputs_size; ++i) {
-        const dataType *input = inputs[i]->data();
-        std::vector<dataType> &output = *(outputs[i]);
-
-        for (size_t j = 0; j < output_size; ++j) {
-          output[j] = MathUtil::Dot(input, weights_ + j * input_size, input_size) + biases_[j];
-        }
+    //copies mapped parameters into the layer first
+    [[nodiscard]] std::vector<dataType> &Parameters() override {
+      if (mapping_) {
+        weights_biases_.assign(parameters_, parameters_ + ParametersSize());
+        parameters_ = weights_biases_.data();
+        mapping_.reset();
       }
+      return weights_biases_;
     }
 
-    void Backward(const std::vector<std::vector<dataType> *> &inputs,
-                  const std::vector<std::vector<dataType> *> &outputs,
-                  const std::vector<std::vector<dataType>> &deltas,
-                  std::vector<std::vector<dataType>> &prev_deltas,
-                  std::vector<dataType> &grad_weights) override {
-      this->BackwardAssert(inputs, outputs, deltas, prev_deltas, grad_weights);
-
-      const size_t inputs_size = inputs.size();
-      const size_t input_size = this->input_size_;
-      const size_t output_size = this->output_size_;
-
-      dataType *grad_weights_data = grad_weights.data();
-      dataType *grad_biases_data = grad_weights_data + input_size * output_size;
-
-      for (size_t i = 0; i < inputs_size; ++i) {
-        std::vector<dataType> &prev_delta = prev_deltas[i];
-        const std::vector<dataType> &delta = deltas[i];
-
-        for (size_t j = 0; j < input_size; ++j) {
-          dataType sum = 0;
-
-          const dataType *weights_data_shifted = weights_ + j;
-
-          for (size_t k = 0; k < output_size; ++k) {
-            sum += delta[k] * weights_data_shifted[k * input_size];
+    [[nodiscard]] PlanStep<dataType> Lower(size_t batch_size, Kernels::ISA isa) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.mapping = mapping_;
+      step.parameters = parameters_;
+      step.parameters_size = ParametersSize();
+
+#if NEURALNET_X86_DISPATCH
+      if constexpr (std::is_same_v<dataType, float>) {
+        if (isa >= Kernels::ISA::AVX2 && this->input_size_ >= 8) {
+          step.forward = &ForwardAVX2;
+          step.backward = &BackwardAVX2;
+          step.kernel_name = "dense_avx2";
+          if (Kernels::HasAVX512BF16()) {
+            step.half_forward = &ForwardBFloat16AVX512;
+            step.half_kernel_name = "dense_bf16_avx512";
           }
-
-          prev_delta[j] = sum;
+          return step;
         }
       }
-
-      for (size_t i = 0; i < output_size; ++i) {
-        for (size_t j = 0; j < inputs_size; ++j) {
-          const std::vector<dataType> &input = *(inputs[j]);
-          dataType *grad_weights_data_shifted = grad_weights_data + i * input_size;
-          const dataType delta_value = deltas[j][i];
-
-          for (size_t k = 0; k < input_size; ++k) {
-            grad_weights_data_shifted[k] += delta_value * input[k];
-          }
-        }
+#endif
+
+      step.backward = &BackwardGeneric;
+      if (batch_size >= 4 && this->input_size_ >= 4) {
+        step.forward = &ForwardBlocked;
+        step.kernel_name = "dense_blocked";
+      } else {
+        step.forward = &ForwardNaive;
+        step.kernel_name = "dense_naive";
       }
+      return step;
+    }
 
-      for (size_t i = 0; i < inputs_size; ++i) {
-        const std::vector<dataType> &delta = deltas[i];
+    [[nodiscard]] bool AcceptsEncodedInput() const override {
+      return true;
+    }
 
-        for (size_t j = 0; j < output_size; ++j) {
-          grad_biases_data[j] += delta[j];
+    [[nodiscard]] PlanStep<dataType> LowerEncodedInput(size_t batch_size, Kernels::ISA isa,
+                                                       const InputFormat<dataType> &format) const override {
+      switch (format.element) {
+        case InputElement::UInt8: {
+          static constexpr const char *names[] = {"dense_uint8_naive", "dense_uint8_blocked", "dense_uint8_avx2"};
+          return LowerEncoded<uint8_t>(batch_size, isa, format, names);
+        }
+        case InputElement::Int16: {
+          static constexpr const char *names[] = {"dense_int16_naive", "dense_int16_blocked", "dense_int16_avx2"};
+          return LowerEncoded<int16_t>(batch_size, isa, format, names);
         }
+        default:
+          return Lower(batch_size, isa);
       }
     }
 
     void UpdateParameters(const std::vector<dataType> &updates) override {
-      const size_t weights_biases_size = weights_biases_.size();
+      std::vector<dataType> &weights_biases = Parameters();
+      const size_t weights_biases_size = weights_biases.size();
       for (size_t i = 0; i < weights_biases_size; ++i) {
-        weights_biases_[i] += updates[i];
+        weights_biases[i] += updates[i];
       }
     }
 
@@ -126,26 +140,118 @@ namespace NeuralNet {
         os << "Parameters: " << std::endl;
         for (size_t i = 0; i < output_size; ++i) {
           for (size_t j = 0; j < input_size; ++j) {
-            os << weights_[i * input_size + j] << " ";
+            os << parameters_[i * input_size + j] << " ";
           }
           os << std::endl;
         }
         os << "Biases: " << std::endl;
         for (size_t i = 0; i < output_size; ++i) {
-          os << biases_[i] << " ";
+          os << parameters_[input_size * output_size + i] << " ";
         }
         os << std::endl;
       }
     }
 
-    void Save(std::ofstream &file) const override {
-      file.write(reinterpret_cast<const char *>(&LayerTypeTraits<FullyConnectedLayer<dataType>>::type),
-                 sizeof(LayerTypeTraits<FullyConnectedLayer<dataType>>::type));
-      file.write(reinterpret_cast<const char *>(&this->input_size_), sizeof(this->input_size_));
-      file.write(reinterpret_cast<const char *>(&this->output_size_), sizeof(this->output_size_));
-      file.write(reinterpret_cast<const char *>(weights_biases_.data()),
-                 sizeof(dataType) * weights_biases_.size());
+    void Save(ModelWriter &writer) const override {
+      writer.Layer(LayerTypeTraits<FullyConnectedLayer<dataType>>::type, this->input_size_, this->output_size_)
+          .Block(parameters_, ParametersSize());
+    }
+
+   private:
+
+    //same kernel choice as Lower with the float kernel wrapped in a dequantizing one, names is {naive, blocked, avx2}
+    template<typename Q>
+    [[nodiscard]] PlanStep<dataType> LowerEncoded(size_t batch_size, Kernels::ISA isa,
+                                                  const InputFormat<dataType> &format, const char *const names[3]) const {
+      PlanStep<dataType> step = this->MakeStep();
+      step.mapping = mapping_;
+      step.parameters = parameters_;
+      step.parameters_size = ParametersSize();
+      step.input_format = format;
+      step.backward = &BackwardEncoded<Q>;
+
+#if NEURALNET_X86_DISPATCH
+      if constexpr (std::is_same_v<dataType, float>) {
+        if (isa >= Kernels::ISA::AVX2 && this->input_size_ >= 8) {
+          step.forward = &ForwardEncoded<Q, &Kernels::DenseForwardAVX2>;
+          step.kernel_name = names[2];
+          return step;
+        }
+      }
+#endif
+
+      if (batch_size >= 4 && this->input_size_ >= 4) {
+        step.forward = &ForwardEncoded<Q, &Kernels::DenseForwardBlocked<dataType>>;
+        step.kernel_name = names[1];
+      } else {
+        step.forward = &ForwardEncoded<Q, &Kernels::DenseForwardNaive<dataType>>;
+        step.kernel_name = names[0];
+      }
+      return step;
+    }
+
+    template<typename Q, Kernels::DenseForwardKernel<dataType> Kernel>
+    static void ForwardEncoded(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                               size_t batch_size) {
+      const dataType *biases = step.parameters + step.input_size * step.output_size;
+      Kernels::DenseForwardDequantize(step.parameters, biases, reinterpret_cast<const Q *>(inputs), outputs,
+                                      batch_size, step.input_size, step.output_size, step.input_format.scale,
+                                      step.input_format.offset, Kernel);
+    }
+
+    template<typename Q>
+    static void BackwardEncoded(const PlanStep<dataType> &step, const dataType *inputs, const dataType *,
+                                const dataType *deltas, [[maybe_unused]] dataType *prev_deltas,
+                                dataType *grad_parameters, size_t batch_size) {
+      assert(!prev_deltas);
+      Kernels::DenseBackwardDequantize(reinterpret_cast<const Q *>(inputs), deltas, grad_parameters, batch_size,
+                                       step.input_size, step.output_size, step.input_format.scale,
+                                       step.input_format.offset);
+    }
+
+    static void ForwardNaive(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                             size_t batch_size) {
+      const dataType *biases = step.parameters + step.input_size * step.output_size;
+      Kernels::DenseForwardNaive(step.parameters, biases, inputs, outputs, batch_size, step.input_size,
+                                 step.output_size);
+    }
+
+    static void ForwardBlocked(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                               size_t batch_size) {
+      const dataType *biases = step.parameters + step.input_size * step.output_size;
+      Kernels::DenseForwardBlocked(step.parameters, biases, inputs, outputs, batch_size, step.input_size,
+                                   step.output_size);
+    }
+
+    static void BackwardGeneric(const PlanStep<dataType> &step, const dataType *inputs, const dataType *,
+                                const dataType *deltas, dataType *prev_deltas, dataType *grad_parameters,
+                                size_t batch_size) {
+      Kernels::DenseBackward(step.parameters, inputs, deltas, prev_deltas, grad_parameters, batch_size,
+                             step.input_size, step.output_size);
+    }
+
+#if NEURALNET_X86_DISPATCH
+    static void ForwardAVX2(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                            size_t batch_size) {
+      const dataType *biases = step.parameters + step.input_size * step.output_size;
+      Kernels::DenseForwardAVX2(step.parameters, biases, inputs, outputs, batch_size, step.input_size,
+                                step.output_size);
+    }
+
+    static void BackwardAVX2(const PlanStep<dataType> &step, const dataType *inputs, const dataType *,
+                             const dataType *deltas, dataType *prev_deltas, dataType *grad_parameters,
+                             size_t batch_size) {
+      Kernels::DenseBackwardAVX2(step.parameters, inputs, deltas, prev_deltas, grad_parameters, batch_size,
+                                 step.input_size, step.output_size);
+    }
+
+    static void ForwardBFloat16AVX512(const PlanStep<dataType> &step, const uint16_t *inputs, const uint16_t *weights,
+                                      dataType *outputs, size_t batch_size) {
+      const dataType *biases = step.parameters + step.input_size * step.output_size;
+      Kernels::DenseForwardBFloat16AVX512(weights, biases, inputs, outputs, batch_size, step.input_size,
+                                          step.output_size);
     }
+#endif
   };
 
 }
\ No newline at end of file
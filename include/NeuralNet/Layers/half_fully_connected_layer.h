@@ -0,0 +1,180 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <stdexcept>
+
+#include <NeuralNet/misc/half.h>
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Model/model_reader.h>
+#include <NeuralNet/Kernels/half_kernels.h>
+#include <NeuralNet/Layers/base_layer.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType = NNFLOAT>
+  class HalfFullyConnectedLayer;
+
+  template<std::floating_point T>
+  struct LayerTypeTraits<HalfFullyConnectedLayer<T>> {
+    static constexpr LayerType type = LayerType::HalfFullyConnected;
+  };
+
+  //inference only fully connected layer storing its weights as bfloat16 or fp16, see HalfPrecisionWeights.
+  //the weights stay 16 bit in memory and are widened inside the kernels, inputs, biases and outputs are dataType
+  template<std::floating_point dataType>
+  class HalfFullyConnectedLayer : public BaseLayer<dataType> {
+   private:
+
+    AlignedVector<uint16_t> weights_storage_;
+    std::vector<dataType> biases_storage_;
+
+    //output_size x input_size weights and output_size biases, either the storage_ vectors or the blocks of a
+    //mapped model file kept alive by mapping_
+    const uint16_t *weights_;
+    const dataType *biases_;
+    std::shared_ptr<const MappedFile> mapping_;
+
+    Precision precision_;
+
+   public:
+
+    //rounds weights_biases, output_size x input_size weights followed by output_size biases, to precision
+    HalfFullyConnectedLayer(size_t input_size, size_t output_size, const dataType *weights_biases,
+                            Precision precision)
+        : BaseLayer<dataType>(input_size, output_size), weights_storage_(input_size * output_size),
+          biases_storage_(weights_biases + input_size * output_size,
+                          weights_biases + input_size * output_size + output_size),
+          precision_(precision) {
+      if (precision_ == Precision::Native) {
+        throw std::runtime_error("Half precision weights need bf16 or fp16");
+      }
+
+      Kernels::ToHalf(precision_, weights_biases, weights_storage_.data(), weights_storage_.size());
+      weights_ = weights_storage_.data();
+      biases_ = biases_storage_.data();
+    }
+
+    //uses the weights in place, and the biases as well when the file stores dataType values
+    explicit HalfFullyConnectedLayer(const ModelReader::LayerView &layer)
+        : BaseLayer<dataType>(layer.InputSize(), layer.OutputSize()),
+          precision_(static_cast<Precision>(layer.Attribute(0))) {
+      if (precision_ != Precision::BFloat16 && precision_ != Precision::Float16) {
+        throw layer.Error("invalid weight precision");
+      }
+
+      weights_ = layer.Block<uint16_t>(0, layer.InputSize() * layer.OutputSize());
+      mapping_ = layer.Mapping();
+
+      if (layer.BlockIs<dataType>(1)) {
+        biases_ = layer.Block<dataType>(1, layer.OutputSize());
+      } else {
+        biases_storage_ = layer.ConvertBlock<dataType>(1, layer.OutputSize());
+        biases_ = biases_storage_.data();
+      }
+    }
+
+    [[nodiscard]] size_t ParametersSize() const override {
+      return 0;
+    }
+
+    [[nodiscard]] bool Trainable() const override {
+      return false;
+    }
+
+    [[nodiscard]] Precision WeightPrecision() const {
+      return precision_;
+    }
+
+    [[nodiscard]] const uint16_t *Weights() const {
+      return weights_;
+    }
+
+    [[nodiscard]] const dataType *Biases() const {
+      return biases_;
+    }
+
+    [[nodiscard]] PlanStep<dataType> Lower(size_t, Kernels::ISA isa) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.mapping = mapping_;
+      step.backward = &BackwardKernel;
+      step.forward = &ForwardGeneric;
+      step.kernel_name = precision_ == Precision::Float16 ? "dense_fp16" : "dense_bf16";
+
+#if NEURALNET_X86_DISPATCH
+      if constexpr (std::is_same_v<dataType, float>) {
+        if (isa >= Kernels::ISA::AVX2 && this->input_size_ >= 8 && Kernels::HasF16C()) {
+          if (precision_ == Precision::Float16) {
+            step.forward = &ForwardAVX2<Precision::Float16>;
+            step.kernel_name = "dense_fp16_avx2";
+          } else {
+            step.forward = &ForwardAVX2<Precision::BFloat16>;
+            step.kernel_name = "dense_bf16_avx2";
+          }
+        }
+      }
+#endif
+      return step;
+    }
+
+    void Print(std::ostream &os, bool weights) const override {
+      const size_t input_size = this->input_size_;
+      const size_t output_size = this->output_size_;
+
+      os << "ID: " << this->layer_id_ << " HalfFullyConnectedLayer: " << input_size << " -> " << output_size
+         << ", " << PrecisionName(precision_) << " weights" << std::endl;
+
+      if (weights) {
+        std::vector<dataType> row(input_size);
+        os << "Parameters: " << std::endl;
+        for (size_t i = 0; i < output_size; ++i) {
+          Kernels::FromHalf(precision_, weights_ + i * input_size, row.data(), input_size);
+          for (size_t j = 0; j < input_size; ++j) {
+            os << row[j] << " ";
+          }
+          os << std::endl;
+        }
+        os << "Biases: " << std::endl;
+        for (size_t i = 0; i < output_size; ++i) {
+          os << biases_[i] << " ";
+        }
+        os << std::endl;
+      }
+    }
+
+    void Save(ModelWriter &writer) const override {
+      writer.Layer(LayerTypeTraits<HalfFullyConnectedLayer<dataType>>::type, this->input_size_, this->output_size_)
+          .Attribute(0, static_cast<double>(precision_))
+          .Block(weights_, this->input_size_ * this->output_size_)
+          .Block(biases_, this->output_size_);
+    }
+
+   private:
+
+    static void ForwardGeneric(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                               size_t batch_size) {
+      const auto &layer = *static_cast<const HalfFullyConnectedLayer *>(step.layer);
+      Kernels::DenseForwardHalf(layer.precision_, layer.weights_, layer.biases_, inputs, outputs, batch_size,
+                                step.input_size, step.output_size);
+    }
+
+#if NEURALNET_X86_DISPATCH
+    template<Precision precision>
+    static void ForwardAVX2(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                            size_t batch_size) {
+      const auto &layer = *static_cast<const HalfFullyConnectedLayer *>(step.layer);
+      Kernels::DenseForwardHalfAVX2<precision>(layer.weights_, layer.biases_, inputs, outputs, batch_size,
+                                               step.input_size, step.output_size);
+    }
+#endif
+
+    static void BackwardKernel(const PlanStep<dataType> &step, const dataType *, const dataType *, const dataType *,
+                               dataType *, dataType *, size_t) {
+      throw std::runtime_error("Half precision layer " + std::to_string(step.layer->LayerID()) + " cannot be trained");
+    }
+  };
+
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+#include <NeuralNet/Model/model_reader.h>
+#include <NeuralNet/Layers/base_layer.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType = NNFLOAT>
+  class NormalizationLayer;
+
+  template<std::floating_point T>
+  struct LayerTypeTraits<NormalizationLayer<T>> {
+    static constexpr LayerType type = LayerType::Normalization;
+  };
+
+  //scales and shifts every input feature by fixed values, outputs[k] = inputs[k] * scale[k] + offset[k], e.g. to
+  //standardize the inputs of a network inside the model instead of in a separate pass. the values are not trained,
+  //deltas are propagated through them. for inference GraphPasses::FoldNormalization folds the layer into the fully
+  //connected layer reading it
+  template<std::floating_point dataType>
+  class NormalizationLayer : public BaseLayer<dataType> {
+   private:
+
+    std::vector<dataType> scale_;
+    std::vector<dataType> offset_;
+
+   public:
+
+    NormalizationLayer(const std::vector<dataType> &scale, const std::vector<dataType> &offset)
+        : BaseLayer<dataType>(scale.size(), scale.size()), scale_(scale), offset_(offset) {
+      if (scale_.size() != offset_.size()) {
+        throw std::runtime_error("Normalization needs as many offsets as scales");
+      }
+    }
+
+    //the same scale and offset for all size features
+    NormalizationLayer(size_t size, dataType scale, dataType offset)
+        : BaseLayer<dataType>(size, size), scale_(size, scale), offset_(size, offset) {}
+
+    explicit NormalizationLayer(const ModelReader::LayerView &layer)
+        : BaseLayer<dataType>(layer.InputSize(), layer.OutputSize()),
+          scale_(layer.ConvertBlock<dataType>(0, layer.InputSize())),
+          offset_(layer.ConvertBlock<dataType>(1, layer.InputSize())) {
+      if (layer.InputSize() != layer.OutputSize()) {
+        throw layer.Error("normalization inputs and outputs differ");
+      }
+    }
+
+    [[nodiscard]] size_t ParametersSize() const override {
+      return 0;
+    }
+
+    [[nodiscard]] bool Trainable() const override {
+      return false;
+    }
+
+    [[nodiscard]] const std::vector<dataType> &Scale() const {
+      return scale_;
+    }
+
+    [[nodiscard]] const std::vector<dataType> &Offset() const {
+      return offset_;
+    }
+
+    //e.g. to set the statistics of a layer added by NetworkBuilder, which starts as the identity. compiled plans
+    //read the values when they run, the vectors must keep InputSize() values
+    [[nodiscard]] std::vector<dataType> &Scale() {
+      return scale_;
+    }
+
+    [[nodiscard]] std::vector<dataType> &Offset() {
+      return offset_;
+    }
+
+    [[nodiscard]] PlanStep<dataType> Lower(size_t, Kernels::ISA) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.forward = &ForwardKernel;
+      step.backward = &BackwardKernel;
+      step.kernel_name = "normalize";
+      return step;
+    }
+
+    [[nodiscard]] bool AcceptsEncodedInput() const override {
+      return true;
+    }
+
+    //the encoded inputs are dequantized and normalized in one pass
+    [[nodiscard]] PlanStep<dataType> LowerEncodedInput(size_t batch_size, Kernels::ISA isa,
+                                                       const InputFormat<dataType> &format) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.input_format = format;
+      step.backward = &BackwardKernel;
+      switch (format.element) {
+        case InputElement::UInt8:
+          step.forward = &ForwardEncoded<uint8_t>;
+          step.kernel_name = "normalize_uint8";
+          return step;
+        case InputElement::Int16:
+          step.forward = &ForwardEncoded<int16_t>;
+          step.kernel_name = "normalize_int16";
+          return step;
+        default:
+          return Lower(batch_size, isa);
+      }
+    }
+
+    static void ForwardKernel(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                              size_t batch_size) {
+      const auto layer = static_cast<const NormalizationLayer *>(step.layer);
+      const dataType *scale = layer->scale_.data();
+      const dataType *offset = layer->offset_.data();
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const dataType *input = inputs + i * step.input_size;
+        dataType *output = outputs + i * step.output_size;
+        for (size_t k = 0; k < step.input_size; ++k) {
+          output[k] = input[k] * scale[k] + offset[k];
+        }
+      }
+    }
+
+    template<typename Q>
+    static void ForwardEncoded(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                               size_t batch_size) {
+      const auto layer = static_cast<const NormalizationLayer *>(step.layer);
+      const dataType *scale = layer->scale_.data();
+      const dataType *offset = layer->offset_.data();
+      const Q *encoded = reinterpret_cast<const Q *>(inputs);
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const Q *input = encoded + i * step.input_size;
+        dataType *output = outputs + i * step.output_size;
+        for (size_t k = 0; k < step.input_size; ++k) {
+          const dataType x = static_cast<dataType>(input[k]) * step.input_format.scale + step.input_format.offset;
+          output[k] = x * scale[k] + offset[k];
+        }
+      }
+    }
+
+    static void BackwardKernel(const PlanStep<dataType> &step, const dataType *, const dataType *,
+                               const dataType *deltas, dataType *prev_deltas, dataType *, size_t batch_size) {
+      if (!prev_deltas) {
+        return;
+      }
+
+      const dataType *scale = static_cast<const NormalizationLayer *>(step.layer)->scale_.data();
+      for (size_t i = 0; i < batch_size; ++i) {
+        for (size_t k = 0; k < step.input_size; ++k) {
+          prev_deltas[i * step.input_size + k] = deltas[i * step.input_size + k] * scale[k];
+        }
+      }
+    }
+
+    void Print(std::ostream &os, bool weights) const override {
+      os << "ID: " << this->layer_id_ << " Normalization: " << this->input_size_ << " -> " << this->output_size_
+         << std::endl;
+
+      if (weights) {
+        os << "Scale: " << std::endl;
+        for (dataType scale : scale_) {
+          os << scale << " ";
+        }
+        os << std::endl << "Offset: " << std::endl;
+        for (dataType offset : offset_) {
+          os << offset << " ";
+        }
+        os << std::endl;
+      }
+    }
+
+    void Save(ModelWriter &writer) const override {
+      writer.Layer(LayerTypeTraits<NormalizationLayer<dataType>>::type, this->input_size_, this->output_size_)
+          .Block(scale_.data(), scale_.size())
+          .Block(offset_.data(), offset_.size());
+    }
+
+  };
+
+}
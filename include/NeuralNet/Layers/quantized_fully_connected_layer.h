@@ -0,0 +1,245 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Model/model_reader.h>
+#include <NeuralNet/Kernels/quantized_kernels.h>
+#include <NeuralNet/Layers/base_layer.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType = NNFLOAT>
+  class QuantizedFullyConnectedLayer;
+
+  template<std::floating_point T>
+  struct LayerTypeTraits<QuantizedFullyConnectedLayer<T>> {
+    static constexpr LayerType type = LayerType::QuantizedFullyConnected;
+  };
+
+  //inference only fully connected layer with int8 weights quantized symmetrically per output, see Quantize.
+  //inputs are quantized with a calibrated scale unless the previous layer already outputs int8 codes, the int32
+  //sums are rescaled, biased and, with relu, clamped in one pass that writes dataType values or int8 codes
+  //for the next quantized layer
+  template<std::floating_point dataType>
+  class QuantizedFullyConnectedLayer : public BaseLayer<dataType> {
+   private:
+
+    AlignedVector<int8_t> weights_storage_;
+    std::vector<dataType> weight_scales_storage_;
+    std::vector<dataType> biases_storage_;
+
+    //output_size x input_size weights, per output weight scales and biases, either the storage_ vectors or the
+    //blocks of a mapped model file kept alive by mapping_
+    const int8_t *weights_;
+    const dataType *weight_scales_;
+    const dataType *biases_;
+    std::shared_ptr<const MappedFile> mapping_;
+
+    dataType input_scale_;
+    dataType output_scale_;
+    bool relu_;
+    bool quantized_input_;
+
+    //input_scale_ * weight scale, turns the int32 sums back into values
+    std::vector<dataType> scales_;
+
+   public:
+
+    //quantizes weights_biases, output_size x input_size weights followed by output_size biases. an output_scale of
+    //0 writes dataType outputs, quantized_input takes the int8 codes written by a previous quantized layer
+    QuantizedFullyConnectedLayer(size_t input_size, size_t output_size, const dataType *weights_biases,
+                                 dataType input_scale, dataType output_scale = 0, bool relu = false,
+                                 bool quantized_input = false)
+        : BaseLayer<dataType>(input_size, output_size), weights_storage_(input_size * output_size),
+          weight_scales_storage_(output_size), biases_storage_(weights_biases + input_size * output_size,
+                                                               weights_biases + input_size * output_size + output_size),
+          input_scale_(input_scale), output_scale_(output_scale), relu_(relu), quantized_input_(quantized_input) {
+      for (size_t j = 0; j < output_size; ++j) {
+        const dataType *row = weights_biases + j * input_size;
+
+        dataType max = 0;
+        for (size_t k = 0; k < input_size; ++k) {
+          max = std::max(max, std::abs(row[k]));
+        }
+
+        weight_scales_storage_[j] = max > 0 ? max / 127 : 1;
+        Kernels::QuantizeInt8(row, weights_storage_.data() + j * input_size, input_size,
+                              1 / weight_scales_storage_[j]);
+      }
+
+      weights_ = weights_storage_.data();
+      weight_scales_ = weight_scales_storage_.data();
+      biases_ = biases_storage_.data();
+      ComputeScales();
+    }
+
+    //uses the int8 weights in place, and the scales and biases as well when the file stores dataType values
+    explicit QuantizedFullyConnectedLayer(const ModelReader::LayerView &layer)
+        : BaseLayer<dataType>(layer.InputSize(), layer.OutputSize()),
+          input_scale_(static_cast<dataType>(layer.Attribute(0))),
+          output_scale_(static_cast<dataType>(layer.Attribute(1))),
+          relu_(layer.Attribute(2) != 0), quantized_input_(layer.Attribute(3) != 0) {
+      const size_t input_size = layer.InputSize();
+      const size_t output_size = layer.OutputSize();
+
+      weights_ = layer.Block<int8_t>(0, input_size * output_size);
+      mapping_ = layer.Mapping();
+
+      if (layer.BlockIs<dataType>(1)) {
+        weight_scales_ = layer.Block<dataType>(1, output_size);
+        biases_ = layer.Block<dataType>(2, output_size);
+      } else {
+        weight_scales_storage_ = layer.ConvertBlock<dataType>(1, output_size);
+        biases_storage_ = layer.ConvertBlock<dataType>(2, output_size);
+        weight_scales_ = weight_scales_storage_.data();
+        biases_ = biases_storage_.data();
+      }
+
+      if (!(input_scale_ > 0) || output_scale_ < 0) {
+        throw layer.Error("invalid quantization scales");
+      }
+      ComputeScales();
+    }
+
+    [[nodiscard]] size_t ParametersSize() const override {
+      return 0;
+    }
+
+    [[nodiscard]] bool Trainable() const override {
+      return false;
+    }
+
+    [[nodiscard]] dataType InputScale() const {
+      return input_scale_;
+    }
+
+    //0 when the outputs are dataType values
+    [[nodiscard]] dataType OutputScale() const {
+      return output_scale_;
+    }
+
+    [[nodiscard]] bool Relu() const {
+      return relu_;
+    }
+
+    [[nodiscard]] bool QuantizedInput() const {
+      return quantized_input_;
+    }
+
+    [[nodiscard]] const int8_t *Weights() const {
+      return weights_;
+    }
+
+    [[nodiscard]] const dataType *WeightScales() const {
+      return weight_scales_;
+    }
+
+    [[nodiscard]] const dataType *Biases() const {
+      return biases_;
+    }
+
+    [[nodiscard]] PlanStep<dataType> Lower(size_t, Kernels::ISA isa) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.mapping = mapping_;
+      step.backward = &BackwardKernel;
+      step.native_buffers = quantized_input_ || output_scale_ != 0;
+
+      switch (isa) {
+        case Kernels::ISA::AVXVNNI:
+          step.forward = &ForwardKernel<Kernels::ISA::AVXVNNI>;
+          step.kernel_name = "dense_int8_avx_vnni";
+          break;
+        case Kernels::ISA::AVX2:
+          step.forward = &ForwardKernel<Kernels::ISA::AVX2>;
+          step.kernel_name = "dense_int8_avx2";
+          break;
+        default:
+          step.forward = &ForwardKernel<Kernels::ISA::Scalar>;
+          step.kernel_name = "dense_int8";
+          break;
+      }
+      return step;
+    }
+
+    void Print(std::ostream &os, bool weights) const override {
+      const size_t input_size = this->input_size_;
+      const size_t output_size = this->output_size_;
+
+      os << "ID: " << this->layer_id_ << " QuantizedFullyConnectedLayer: " << input_size << " -> " << output_size
+         << (relu_ ? " relu" : "") << (quantized_input_ ? ", int8 inputs" : "")
+         << (output_scale_ != 0 ? ", int8 outputs" : "") << std::endl;
+
+      if (weights) {
+        os << "Input scale: " << input_scale_ << " Output scale: " << output_scale_ << std::endl;
+        os << "Parameters: " << std::endl;
+        for (size_t i = 0; i < output_size; ++i) {
+          os << weight_scales_[i] << " *";
+          for (size_t j = 0; j < input_size; ++j) {
+            os << " " << int(weights_[i * input_size + j]);
+          }
+          os << std::endl;
+        }
+        os << "Biases: " << std::endl;
+        for (size_t i = 0; i < output_size; ++i) {
+          os << biases_[i] << " ";
+        }
+        os << std::endl;
+      }
+    }
+
+    void Save(ModelWriter &writer) const override {
+      writer.Layer(LayerTypeTraits<QuantizedFullyConnectedLayer<dataType>>::type, this->input_size_,
+                   this->output_size_)
+          .Attribute(0, input_scale_)
+          .Attribute(1, output_scale_)
+          .Attribute(2, relu_)
+          .Attribute(3, quantized_input_)
+          .Block(weights_, this->input_size_ * this->output_size_)
+          .Block(weight_scales_, this->output_size_)
+          .Block(biases_, this->output_size_);
+    }
+
+   private:
+
+    void ComputeScales() {
+      scales_.resize(this->output_size_);
+      for (size_t j = 0; j < this->output_size_; ++j) {
+        scales_[j] = input_scale_ * weight_scales_[j];
+      }
+    }
+
+    template<Kernels::ISA isa>
+    static void ForwardKernel(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                              size_t batch_size) {
+      const auto &layer = *static_cast<const QuantizedFullyConnectedLayer *>(step.layer);
+
+      const int8_t *codes = reinterpret_cast<const int8_t *>(inputs);
+      if (!layer.quantized_input_) {
+        thread_local AlignedVector<int8_t> quantized;
+        quantized.resize(batch_size * step.input_size);
+        Kernels::QuantizeInt8(inputs, quantized.data(), quantized.size(), 1 / layer.input_scale_);
+        codes = quantized.data();
+      }
+
+      const bool requantize = layer.output_scale_ != 0;
+      const Kernels::DenseInt8Output<dataType> output{layer.scales_.data(), layer.biases_, layer.relu_, outputs,
+                                                      requantize ? reinterpret_cast<int8_t *>(outputs) : nullptr,
+                                                      requantize ? 1 / layer.output_scale_ : 0};
+
+      Kernels::DenseForwardInt8<dataType, isa>(layer.weights_, codes, output, batch_size, step.input_size,
+                                               step.output_size);
+    }
+
+    static void BackwardKernel(const PlanStep<dataType> &step, const dataType *, const dataType *, const dataType *,
+                               dataType *, dataType *, size_t) {
+      throw std::runtime_error("Quantized layer " + std::to_string(step.layer->LayerID()) + " cannot be trained");
+    }
+  };
+
+}
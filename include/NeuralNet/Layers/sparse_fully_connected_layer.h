@@ -0,0 +1,214 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <stdexcept>
+
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/Model/model_reader.h>
+#include <NeuralNet/Kernels/sparse_kernels.h>
+#include <NeuralNet/Layers/base_layer.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType = NNFLOAT>
+  class SparseFullyConnectedLayer;
+
+  template<std::floating_point T>
+  struct LayerTypeTraits<SparseFullyConnectedLayer<T>> {
+    static constexpr LayerType type = LayerType::SparseFullyConnected;
+  };
+
+  //inference only fully connected layer keeping just the nonzero weights of a pruned one in compressed sparse rows,
+  //see Sparsify. the kernels only touch the nonzeros, so the work shrinks with the sparsity
+  template<std::floating_point dataType>
+  class SparseFullyConnectedLayer : public BaseLayer<dataType> {
+   private:
+
+    std::vector<uint32_t> row_offsets_storage_;
+    std::vector<uint32_t> columns_storage_;
+    std::vector<dataType> values_storage_;
+    std::vector<dataType> biases_storage_;
+
+    //output_size + 1 row offsets, the columns and values of the nonzero weights and output_size biases, either the
+    //storage_ vectors or the blocks of a mapped model file kept alive by mapping_
+    const uint32_t *row_offsets_;
+    const uint32_t *columns_;
+    const dataType *values_;
+    const dataType *biases_;
+    std::shared_ptr<const MappedFile> mapping_;
+
+   public:
+
+    //keeps the nonzeros of weights_biases, output_size x input_size weights followed by output_size biases
+    SparseFullyConnectedLayer(size_t input_size, size_t output_size, const dataType *weights_biases)
+        : BaseLayer<dataType>(input_size, output_size),
+          biases_storage_(weights_biases + input_size * output_size,
+                          weights_biases + input_size * output_size + output_size) {
+      row_offsets_storage_.reserve(output_size + 1);
+      row_offsets_storage_.push_back(0);
+
+      for (size_t j = 0; j < output_size; ++j) {
+        const dataType *row = weights_biases + j * input_size;
+        for (size_t k = 0; k < input_size; ++k) {
+          if (row[k] != 0) {
+            columns_storage_.push_back(static_cast<uint32_t>(k));
+            values_storage_.push_back(row[k]);
+          }
+        }
+        row_offsets_storage_.push_back(static_cast<uint32_t>(values_storage_.size()));
+      }
+
+      row_offsets_ = row_offsets_storage_.data();
+      columns_ = columns_storage_.data();
+      values_ = values_storage_.data();
+      biases_ = biases_storage_.data();
+    }
+
+    //uses the sparse rows in place, and the values and biases as well when the file stores dataType values
+    explicit SparseFullyConnectedLayer(const ModelReader::LayerView &layer)
+        : BaseLayer<dataType>(layer.InputSize(), layer.OutputSize()) {
+      const size_t input_size = layer.InputSize();
+      const size_t output_size = layer.OutputSize();
+      const size_t nonzeros = layer.BlockCount(1);
+
+      row_offsets_ = layer.Block<uint32_t>(0, output_size + 1);
+      columns_ = layer.Block<uint32_t>(1, nonzeros);
+      mapping_ = layer.Mapping();
+
+      if (layer.BlockIs<dataType>(2)) {
+        values_ = layer.Block<dataType>(2, nonzeros);
+        biases_ = layer.Block<dataType>(3, output_size);
+      } else {
+        values_storage_ = layer.ConvertBlock<dataType>(2, nonzeros);
+        biases_storage_ = layer.ConvertBlock<dataType>(3, output_size);
+        values_ = values_storage_.data();
+        biases_ = biases_storage_.data();
+      }
+
+      //the kernels index without bounds checks
+      if (row_offsets_[0] != 0 || row_offsets_[output_size] != nonzeros) {
+        throw layer.Error("invalid sparse row offsets");
+      }
+      for (size_t j = 0; j < output_size; ++j) {
+        if (row_offsets_[j] > row_offsets_[j + 1]) {
+          throw layer.Error("invalid sparse row offsets");
+        }
+      }
+      for (size_t k = 0; k < nonzeros; ++k) {
+        if (columns_[k] >= input_size) {
+          throw layer.Error("sparse column out of range");
+        }
+      }
+    }
+
+    [[nodiscard]] size_t ParametersSize() const override {
+      return 0;
+    }
+
+    [[nodiscard]] bool Trainable() const override {
+      return false;
+    }
+
+    [[nodiscard]] size_t NonZeros() const {
+      return row_offsets_[this->output_size_];
+    }
+
+    //fraction of the weights that are zero
+    [[nodiscard]] double Sparsity() const {
+      return 1 - static_cast<double>(NonZeros()) / static_cast<double>(this->input_size_ * this->output_size_);
+    }
+
+    [[nodiscard]] const uint32_t *RowOffsets() const {
+      return row_offsets_;
+    }
+
+    [[nodiscard]] const uint32_t *Columns() const {
+      return columns_;
+    }
+
+    [[nodiscard]] const dataType *Values() const {
+      return values_;
+    }
+
+    [[nodiscard]] const dataType *Biases() const {
+      return biases_;
+    }
+
+    [[nodiscard]] PlanStep<dataType> Lower(size_t, Kernels::ISA isa) const override {
+      PlanStep<dataType> step = this->MakeStep();
+      step.mapping = mapping_;
+      step.backward = &BackwardKernel;
+
+#if NEURALNET_X86_DISPATCH
+      if constexpr (std::is_same_v<dataType, float>) {
+        if (isa >= Kernels::ISA::AVX2) {
+          step.forward = &ForwardAVX2;
+          step.kernel_name = "sparse_avx2";
+          return step;
+        }
+      }
+#endif
+
+      step.forward = &ForwardGeneric;
+      step.kernel_name = "sparse";
+      return step;
+    }
+
+    void Print(std::ostream &os, bool weights) const override {
+      const size_t output_size = this->output_size_;
+
+      os << "ID: " << this->layer_id_ << " SparseFullyConnectedLayer: " << this->input_size_ << " -> "
+         << output_size << ", " << NonZeros() << " nonzeros (" << Sparsity() * 100 << "% sparse)" << std::endl;
+
+      if (weights) {
+        os << "Parameters: " << std::endl;
+        for (size_t j = 0; j < output_size; ++j) {
+          for (uint32_t k = row_offsets_[j]; k < row_offsets_[j + 1]; ++k) {
+            os << columns_[k] << ":" << values_[k] << " ";
+          }
+          os << std::endl;
+        }
+        os << "Biases: " << std::endl;
+        for (size_t j = 0; j < output_size; ++j) {
+          os << biases_[j] << " ";
+        }
+        os << std::endl;
+      }
+    }
+
+    void Save(ModelWriter &writer) const override {
+      writer.Layer(LayerTypeTraits<SparseFullyConnectedLayer<dataType>>::type, this->input_size_, this->output_size_)
+          .Block(row_offsets_, this->output_size_ + 1)
+          .Block(columns_, NonZeros())
+          .Block(values_, NonZeros())
+          .Block(biases_, this->output_size_);
+    }
+
+   private:
+
+    static void ForwardGeneric(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                               size_t batch_size) {
+      const auto &layer = *static_cast<const SparseFullyConnectedLayer *>(step.layer);
+      Kernels::SparseForward(layer.row_offsets_, layer.columns_, layer.values_, layer.biases_, inputs, outputs,
+                             batch_size, step.input_size, step.output_size);
+    }
+
+#if NEURALNET_X86_DISPATCH
+    static void ForwardAVX2(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs,
+                            size_t batch_size) {
+      const auto &layer = *static_cast<const SparseFullyConnectedLayer *>(step.layer);
+      Kernels::SparseForwardAVX2(layer.row_offsets_, layer.columns_, layer.values_, layer.biases_, inputs, outputs,
+                                 batch_size, step.input_size, step.output_size);
+    }
+#endif
+
+    static void BackwardKernel(const PlanStep<dataType> &step, const dataType *, const dataType *, const dataType *,
+                               dataType *, dataType *, size_t) {
+      throw std::runtime_error("Sparse layer " + std::to_string(step.layer->LayerID()) + " cannot be trained");
+    }
+  };
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <NeuralNet/Layers/bit_fully_connected_layer.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType = NNFLOAT>
+  class TernaryFullyConnectedLayer;
+
+  template<std::floating_point T>
+  struct LayerTypeTraits<TernaryFullyConnectedLayer<T>> {
+    static constexpr LayerType type = LayerType::TernaryFullyConnected;
+  };
+
+  //fully connected layer with 0 or +-scale weights, one scale per output, and inputs binarized to their sign, so
+  //every dot product is an xor, and and popcount over 64 inputs at a time. trains through float shadow weights,
+  //see BitFullyConnectedLayer, and packs 16 weights per float of a FullyConnectedLayer, see PackBitWeights
+  template<std::floating_point dataType>
+  class TernaryFullyConnectedLayer : public BitFullyConnectedLayer<dataType, true> {
+   public:
+
+    using BitFullyConnectedLayer<dataType, true>::BitFullyConnectedLayer;
+  };
+
+}
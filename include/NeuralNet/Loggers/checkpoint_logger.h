@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include <NeuralNet/Loggers/baser_logger.h>
+
+namespace NeuralNet::Training {
+
+  //takes an asynchronous checkpoint of the network every mod iterations, with training_state one that
+  //NetworkTraining::LoadState can resume from
+  template<std::floating_point dataType>
+  class CheckpointLogger : public BaseLogger<dataType> {
+    size_t mod_;
+    long long last_logged_iteration_ = std::numeric_limits<long long>::min();
+
+    std::string filepath_;
+    bool training_state_;
+
+   public:
+
+    explicit CheckpointLogger(std::string filepath, size_t mod = 99999, bool training_state = false)
+        : mod_(mod), filepath_(std::move(filepath)), training_state_(training_state) {}
+
+    void Log(NetworkTraining<dataType> *network_training) override {
+      long long current_iteration = network_training->TrainingIterations();
+      //taken unsigned, the first iteration is logged while last_logged_iteration_ is still the minimum
+      const auto elapsed = static_cast<unsigned long long>(current_iteration)
+          - static_cast<unsigned long long>(last_logged_iteration_);
+      if (elapsed > mod_) {
+        last_logged_iteration_ = current_iteration;
+        network_training->Checkpoint(filepath_, training_state_);
+      }
+    }
+
+  };
+
+}
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include <NeuralNet/misc/types.h>
 #include <NeuralNet/misc/layer_type.h>
 #include <NeuralNet/Layers/base_layer.h>
 #include <NeuralNet/Layers/base_trainable_layer.h>
+#include <NeuralNet/Model/model_reader.h>
+#include <NeuralNet/Model/model_writer.h>
 
 namespace NeuralNet {
 
@@ -80,92 +83,107 @@ namespace NeuralNet {
       }
     }
 
+    //writes the network in the ModelFormat layout, see Load
     void Save(const std::string &filepath) const {
-      std::ofstream os(filepath, std::ios::binary);
-      if (!os.is_open()) {
-        throw std::runtime_error("Failed to open file for writing: " + filepath);
-      }
+      ModelWriter writer;
+      Save(writer);
+      writer.Write(filepath, ModelFormat::ElementOf<dataType>());
+    }
 
+    void Save(ModelWriter &writer) const {
       for (auto &layer : layers_) {
-        layer->Save(os);
+        layer->Save(writer);
       }
+    }
 
-      os.close();
+    //copies parameters used in place from a loaded model file into the layers, so they can be modified,
+    //execution plans compiled before keep reading the file
+    void OwnParameters() {
+      for (auto &layer : layers_) {
+        if (layer->Trainable()) {
+          (void) std::static_pointer_cast<BaseTrainableLayer<dataType>>(layer)->Parameters();
+        }
+      }
     }
   };
 
+  //maps the model file and validates its header and tables, parameter blocks are used in place without copying
+  //when they are stored as dataType, so loading is independent of the model size and processes mapping the same
+  //file share its pages. verify also checksums every parameter block
   template<std::floating_point dataType = NNFLOAT>
-  std::shared_ptr<NeuralNetwork<dataType>> Load(const std::string &filepath) {
-    std::ifstream is(filepath, std::ios::binary);
-    if (!is.is_open()) {
-      throw std::runtime_error("Failed to open file for reading: " + filepath);
-    }
+  std::shared_ptr<NeuralNetwork<dataType>> Load(const std::string &filepath, bool verify = false) {
+    return Load<dataType>(ModelReader(filepath, verify));
+  }
 
+  //the layers of an open model file, training state records are skipped
+  template<std::floating_point dataType = NNFLOAT>
+  std::shared_ptr<NeuralNetwork<dataType>> Load(const ModelReader &reader) {
     auto network = std::make_shared<NeuralNetwork<dataType>>();
 
-    while (is.peek() != EOF) {
-      int layerType;
-      is.read(reinterpret_cast<char *>(&layerType), sizeof(layerType));
-
-      switch (layerType) {
-        case LayerType::FullyConnected: {
-          size_t inputsCount, outputsCount;
-          is.read(reinterpret_cast<char *>(&inputsCount), sizeof(inputsCount));
-          is.read(reinterpret_cast<char *>(&outputsCount), sizeof(outputsCount));
-
-          auto layer = std::make_shared<FullyConnectedLayer<dataType>>(inputsCount, outputsCount);
-
-          layer->Parameters().resize(inputsCount * outputsCount + outputsCount);
-          is.read(reinterpret_cast<char *>(layer->Parameters().data()), sizeof(dataType) * layer->Parameters().size());
+    for (size_t i = 0; i < reader.LayersSize(); ++i) {
+      const ModelReader::LayerView layer = reader.Layer(i);
+      if (layer.Type() & ModelFormat::kStateRecord) {
+        continue;
+      }
 
-          network->AddLayer(layer);
+      switch (layer.Type()) {
+        case LayerType::FullyConnected:
+          network->AddLayer(std::make_shared<FullyConnectedLayer<dataType>>(layer));
           break;
-        }
-        case LayerType::LeakyReLU : {
-          size_t inputsCount;
-          is.read(reinterpret_cast<char *>(&inputsCount), sizeof(inputsCount));
-
-          auto layer = std::make_shared<LeakyReLuActivation<dataType>>(inputsCount, inputsCount);
-          network->AddLayer(layer);
+        case LayerType::QuantizedFullyConnected:
+          network->AddLayer(std::make_shared<QuantizedFullyConnectedLayer<dataType>>(layer));
           break;
-        }
-        case LayerType::ReLU : {
-          size_t inputsCount;
-          is.read(reinterpret_cast<char *>(&inputsCount), sizeof(inputsCount));
-
-          auto layer = std::make_shared<ReLuActivation<dataType>>(inputsCount, inputsCount);
-          network->AddLayer(layer);
+        case LayerType::HalfFullyConnected:
+          network->AddLayer(std::make_shared<HalfFullyConnectedLayer<dataType>>(layer));
           break;
-        }
-        case LayerType::Sigmoid: {
-          size_t inputsCount;
-          is.read(reinterpret_cast<char *>(&inputsCount), sizeof(inputsCount));
-
-          auto layer = std::make_shared<SigmoidActivation<dataType>>(inputsCount, inputsCount);
-          network->AddLayer(layer);
+        case LayerType::SparseFullyConnected:
+          network->AddLayer(std::make_shared<SparseFullyConnectedLayer<dataType>>(layer));
           break;
-        }
-        case LayerType::Softmax: {
-          size_t inputsCount;
-          is.read(reinterpret_cast<char *>(&inputsCount), sizeof(inputsCount));
-
-          auto layer = std::make_shared<SoftmaxActivation<dataType>>(inputsCount, inputsCount);
-          network->AddLayer(layer);
+        case LayerType::BinaryFullyConnected:
+          network->AddLayer(std::make_shared<BinaryFullyConnectedLayer<dataType>>(layer));
           break;
-        }
-        case LayerType::Tanh: {
-          size_t inputsCount;
-          is.read(reinterpret_cast<char *>(&inputsCount), sizeof(inputsCount));
-
-          auto layer = std::make_shared<TanhActivation<dataType>>(inputsCount, inputsCount);
-          network->AddLayer(layer);
+        case LayerType::TernaryFullyConnected:
+          network->AddLayer(std::make_shared<TernaryFullyConnectedLayer<dataType>>(layer));
           break;
-        }
-        default:break;
+        case LayerType::CodebookFullyConnected:
+          network->AddLayer(std::make_shared<CodebookFullyConnectedLayer<dataType>>(layer));
+          break;
+        case LayerType::Normalization:
+          network->AddLayer(std::make_shared<NormalizationLayer<dataType>>(layer));
+          break;
+        case LayerType::LeakyReLU:
+          network->AddLayer(std::make_shared<LeakyReLuActivation<dataType>>(
+              layer.InputSize(), layer.OutputSize(), static_cast<dataType>(layer.Attribute(0))));
+          break;
+        case LayerType::ReLU:
+          network->AddLayer(std::make_shared<ReLuActivation<dataType>>(layer.InputSize(), layer.OutputSize()));
+          break;
+        case LayerType::Sigmoid:
+          network->AddLayer(std::make_shared<SigmoidActivation<dataType>>(layer.InputSize(), layer.OutputSize()));
+          break;
+        case LayerType::Softmax:
+          network->AddLayer(std::make_shared<SoftmaxActivation<dataType>>(layer.InputSize(), layer.OutputSize()));
+          break;
+        case LayerType::Tanh:
+          network->AddLayer(std::make_shared<TanhActivation<dataType>>(layer.InputSize(), layer.OutputSize()));
+          break;
+        default:
+          throw layer.Error("unknown layer type " + std::to_string(layer.Type()));
       }
     }
 
     return network;
   }
 
-}
\ No newline at end of file
+  //network of the layers saved to writer, named name in errors. the converters, e.g. Quantize or Sparsify, build
+  //their results this way rather than assembling the layers themselves, so a converted network is exactly what
+  //saving and loading it gives: the layers use their blocks in place from the in-memory image like from a mapped
+  //file, compressed weights stay compressed, and it saves and loads like any other network
+  template<std::floating_point dataType = NNFLOAT>
+  std::shared_ptr<NeuralNetwork<dataType>> Load(ModelWriter &writer, const std::string &name) {
+    AlignedVector<uint8_t> image;
+    writer.Write(image, ModelFormat::ElementOf<dataType>());
+    return Load<dataType>(ModelReader(std::make_shared<const MappedFile>(std::move(image)), name));
+  }
+
+}
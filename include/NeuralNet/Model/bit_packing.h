@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+
+#include <NeuralNet/Layers/binary_fully_connected_layer.h>
+#include <NeuralNet/Layers/ternary_fully_connected_layer.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/base_network.h>
+
+namespace NeuralNet {
+
+  //inference network from a trained one where every BinaryFullyConnectedLayer and TernaryFullyConnectedLayer drops
+  //its shadow weights and keeps the bit planes of its quantized weights, the outputs do not change
+  template<std::floating_point dataType>
+  std::shared_ptr<NeuralNetwork<dataType>> PackBitWeights(const std::shared_ptr<NeuralNetwork<dataType>> &network) {
+    ModelWriter writer;
+
+    for (size_t i = 0; i < network->LayersSize(); ++i) {
+      const auto layer = network->LayerAt(i);
+
+      if (const auto binary = std::dynamic_pointer_cast<BitFullyConnectedLayer<dataType, false>>(layer)) {
+        binary->SavePacked(writer);
+      } else if (const auto ternary = std::dynamic_pointer_cast<BitFullyConnectedLayer<dataType, true>>(layer)) {
+        ternary->SavePacked(writer);
+      } else {
+        layer->Save(writer);
+      }
+    }
+
+    return Load<dataType>(writer, "packed network");
+  }
+
+}
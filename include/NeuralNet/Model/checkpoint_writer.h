@@ -0,0 +1,169 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <filesystem>
+#include <exception>
+#include <condition_variable>
+
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/delta_checkpoint.h>
+#include <NeuralNet/Model/base_network.h>
+
+namespace NeuralNet {
+
+  //saves networks on a background thread. Write only copies the parameters into one of two snapshot buffers,
+  //the other one can be on its way to disk meanwhile. files are written next to their destination and renamed
+  //over it when complete, so readers never see a partial checkpoint
+  class CheckpointWriter {
+   private:
+    struct Slot {
+      ModelWriter model;
+      ModelFormat::Element dtype = ModelFormat::Element::Float32;
+      std::string filepath;
+      bool delta = false;
+    };
+
+    Slot slots_[2];
+    int pending_ = -1;
+    int writing_ = -1;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    size_t written_ = 0;
+
+    DeltaCheckpointWriter deltas_;
+
+    std::thread worker_;
+
+   public:
+
+    CheckpointWriter() : worker_([this]() { Run(); }) {}
+
+    CheckpointWriter(const CheckpointWriter &) = delete;
+    CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+    //finishes the checkpoints already taken
+    ~CheckpointWriter() {
+      {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+      }
+      condition_.notify_all();
+      worker_.join();
+    }
+
+    //snapshots network to be saved to filepath. a snapshot for the same file that is still waiting for the disk
+    //is replaced, one for another file is waited for. rethrows the error of a failed earlier write.
+    //with delta only the chunks changed since the previous checkpoint are written as a DeltaFormat file, the
+    //first one is a full model file. every delta needs its own filepath, see CompactCheckpoints
+    template<std::floating_point dataType>
+    void Write(const NeuralNetwork<dataType> &network, const std::string &filepath, bool delta = false) {
+      Write(filepath, ModelFormat::ElementOf<dataType>(), [&](ModelWriter &model) { network.Save(model); }, delta);
+    }
+
+    //like above with the records added by save(ModelWriter &), which runs on the calling thread
+    template<typename Save>
+    void Write(const std::string &filepath, ModelFormat::Element dtype, Save save, bool delta = false) {
+      std::unique_lock lock(mutex_);
+      condition_.wait(lock, [&]() { return error_ || pending_ == -1 || slots_[pending_].filepath == filepath; });
+      RethrowError();
+
+      const int slot = pending_ != -1 ? pending_ : (writing_ == 0 ? 1 : 0);
+
+      ModelWriter &model = slots_[slot].model;
+      model.Clear();
+      save(model);
+      model.CopyBlocks();
+
+      slots_[slot].dtype = dtype;
+      slots_[slot].filepath = filepath;
+      slots_[slot].delta = delta;
+      pending_ = slot;
+
+      condition_.notify_all();
+    }
+
+    //blocks until every snapshot taken so far is on disk
+    void Wait() {
+      std::unique_lock lock(mutex_);
+      condition_.wait(lock, [&]() { return pending_ == -1 && writing_ == -1; });
+      RethrowError();
+    }
+
+    [[nodiscard]] size_t Written() {
+      std::lock_guard lock(mutex_);
+      return written_;
+    }
+
+   private:
+
+    void RethrowError() {
+      if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+      }
+    }
+
+    void Run() {
+      std::unique_lock lock(mutex_);
+
+      while (true) {
+        condition_.wait(lock, [&]() { return stop_ || pending_ != -1; });
+        if (pending_ == -1) {
+          return;
+        }
+
+        writing_ = std::exchange(pending_, -1);
+        Slot &slot = slots_[writing_];
+        condition_.notify_all();
+
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+          WriteFile(slot);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        lock.lock();
+
+        if (error) {
+          error_ = error;
+        } else {
+          ++written_;
+        }
+        writing_ = -1;
+        condition_.notify_all();
+      }
+    }
+
+    void WriteFile(Slot &slot) {
+      const std::string temporary = slot.filepath + ".tmp";
+
+      //the writers close their streams before checking them, so a failed final flush throws here and the
+      //previous checkpoint stays in place
+      try {
+        //once deltas are requested every checkpoint is tracked, as the next delta is taken against it
+        if (slot.delta && deltas_.HasParent()) {
+          deltas_.WriteDelta(slot.model, slot.dtype, temporary);
+        } else if (slot.delta || deltas_.HasParent()) {
+          deltas_.WriteFull(slot.model, slot.dtype, temporary);
+        } else {
+          slot.model.Write(temporary, slot.dtype);
+        }
+
+        //the data has to be on disk before the rename makes it visible
+        SyncFile(temporary);
+      } catch (...) {
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+        throw;
+      }
+      std::filesystem::rename(temporary, slot.filepath);
+    }
+  };
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/codebook_fully_connected_layer.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/base_network.h>
+
+namespace NeuralNet {
+
+  //inference network from a trained one with every FullyConnectedLayer replaced by a CodebookFullyConnectedLayer,
+  //its weights clustered by k-means into 16 (index_bits 4) or 256 (index_bits 8) values. the weights of a saved
+  //model shrink 8x or 4x for float, and stay compressed when it is loaded
+  template<std::floating_point dataType>
+  std::shared_ptr<NeuralNetwork<dataType>> CodebookWeights(const std::shared_ptr<NeuralNetwork<dataType>> &network,
+                                                           size_t index_bits) {
+    ModelWriter writer;
+    std::vector<std::unique_ptr<CodebookFullyConnectedLayer<dataType>>> converted;
+
+    for (size_t i = 0; i < network->LayersSize(); ++i) {
+      const auto layer = network->LayerAt(i);
+      const auto dense = std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(layer);
+      if (!dense) {
+        layer->Save(writer);
+        continue;
+      }
+
+      converted.push_back(std::make_unique<CodebookFullyConnectedLayer<dataType>>(
+          dense->InputSize(), dense->OutputSize(), dense->WeightsBiases(), index_bits));
+      converted.back()->Save(writer);
+    }
+
+    return Load<dataType>(writer, "codebook network");
+  }
+
+  //network with every CodebookFullyConnectedLayer looked up into a plain FullyConnectedLayer, for hosts that
+  //download the small codebook model but would rather run, or fine-tune, the dense kernels
+  template<std::floating_point dataType>
+  std::shared_ptr<NeuralNetwork<dataType>> DecodeCodebookWeights(
+      const std::shared_ptr<NeuralNetwork<dataType>> &network) {
+    ModelWriter writer;
+    std::vector<std::unique_ptr<FullyConnectedLayer<dataType>>> decoded;
+
+    for (size_t i = 0; i < network->LayersSize(); ++i) {
+      const auto layer = network->LayerAt(i);
+      const auto codebook = std::dynamic_pointer_cast<CodebookFullyConnectedLayer<dataType>>(layer);
+      if (!codebook) {
+        layer->Save(writer);
+        continue;
+      }
+
+      decoded.push_back(std::make_unique<FullyConnectedLayer<dataType>>(codebook->InputSize(),
+                                                                        codebook->OutputSize()));
+      const std::vector<dataType> weights_biases = codebook->DecodedWeightsBiases();
+      std::copy(weights_biases.begin(), weights_biases.end(), decoded.back()->Parameters().begin());
+      decoded.back()->Save(writer);
+    }
+
+    return Load<dataType>(writer, "decoded network");
+  }
+
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <stdexcept>
+#include <filesystem>
+
+#include <NeuralNet/misc/checksum.h>
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/delta_format.h>
+
+namespace NeuralNet {
+
+  //writes a chain of checkpoints where each one after the first only holds the chunks that changed since the
+  //previous one, so frozen or slowly changing layers cost nothing to checkpoint again. only the chunk hashes of
+  //the previous checkpoint are kept, not its contents
+  class DeltaCheckpointWriter {
+   private:
+    size_t chunk_size_;
+
+    AlignedVector<uint8_t> image_;
+    std::vector<uint64_t> hashes_;
+    size_t size_ = 0;
+    uint64_t fingerprint_ = 0;
+    bool has_parent_ = false;
+
+   public:
+
+    explicit DeltaCheckpointWriter(size_t chunk_size = DeltaFormat::kChunkSize) : chunk_size_(chunk_size) {
+      if (chunk_size == 0 || chunk_size % ModelFormat::kAlignment != 0 || chunk_size > UINT32_MAX) {
+        throw std::runtime_error("Delta checkpoint chunk size has to be a multiple of "
+                                     + std::to_string(ModelFormat::kAlignment) + " bytes");
+      }
+    }
+
+    [[nodiscard]] size_t ChunkSize() const {
+      return chunk_size_;
+    }
+
+    //whether a checkpoint was written or set that the next delta can be taken against
+    [[nodiscard]] bool HasParent() const {
+      return has_parent_;
+    }
+
+    //continues the chain from a checkpoint on disk, a model file or one compacted from a chain
+    void SetParent(const std::string &filepath) {
+      const MappedFile file(filepath);
+      Track(DeltaFormat::ChunkHashes(file.Data(), file.Size(), chunk_size_), file.Size());
+    }
+
+    //writes model as a complete model file that the following deltas build on
+    void WriteFull(ModelWriter &model, ModelFormat::Element dtype, const std::string &filepath) {
+      model.Write(image_, dtype);
+      WriteBytes(filepath, {{image_.data(), image_.size()}});
+      Track(DeltaFormat::ChunkHashes(image_.data(), image_.size(), chunk_size_), image_.size());
+    }
+
+    //writes the chunks of model that differ from the previous checkpoint, returns the number of chunk bytes written
+    size_t WriteDelta(ModelWriter &model, ModelFormat::Element dtype, const std::string &filepath) {
+      using namespace DeltaFormat;
+
+      if (!has_parent_) {
+        throw std::runtime_error("Delta checkpoint without a previous checkpoint: " + filepath);
+      }
+
+      model.Write(image_, dtype);
+      std::vector<uint64_t> hashes = ChunkHashes(image_.data(), image_.size(), chunk_size_);
+
+      std::vector<ChunkRecord> chunks;
+      for (size_t i = 0; i < hashes.size(); ++i) {
+        if (i >= hashes_.size() || hashes[i] != hashes_[i]) {
+          ChunkRecord chunk{};
+          chunk.index = i;
+          chunk.size = static_cast<uint32_t>(std::min(chunk_size_, image_.size() - i * chunk_size_));
+          chunk.checksum = Crc32(image_.data() + i * chunk_size_, chunk.size);
+          chunks.push_back(chunk);
+        }
+      }
+
+      const size_t tables_end = sizeof(Header) + chunks.size() * sizeof(ChunkRecord);
+      size_t offset = ModelFormat::AlignUp(tables_end);
+      size_t chunk_bytes = 0;
+      for (auto &chunk : chunks) {
+        chunk.offset = offset;
+        offset = ModelFormat::AlignUp(offset + chunk.size);
+        chunk_bytes += chunk.size;
+      }
+
+      Header header{};
+      std::memcpy(header.magic, kMagic, sizeof(kMagic));
+      header.version = kVersion;
+      header.byte_order = ModelFormat::kByteOrderMark;
+      header.chunk_size = static_cast<uint32_t>(chunk_size_);
+      header.parent_size = size_;
+      header.parent_fingerprint = fingerprint_;
+      header.size = image_.size();
+      header.fingerprint = Fingerprint(hashes, image_.size());
+      header.chunks = chunks.size();
+      header.table_checksum = Crc32(chunks.data(), chunks.size() * sizeof(ChunkRecord));
+      header.header_checksum = Crc32(&header, offsetof(Header, header_checksum));
+
+      std::vector<std::pair<const void *, size_t>> parts = {{&header, sizeof(header)},
+                                                            {chunks.data(), chunks.size() * sizeof(ChunkRecord)}};
+      for (const auto &chunk : chunks) {
+        parts.emplace_back(image_.data() + chunk.index * chunk_size_, chunk.size);
+      }
+      WriteBytes(filepath, parts, true);
+
+      Track(std::move(hashes), image_.size());
+      return chunk_bytes;
+    }
+
+   private:
+
+    void Track(std::vector<uint64_t> hashes, size_t size) {
+      fingerprint_ = DeltaFormat::Fingerprint(hashes, size);
+      hashes_ = std::move(hashes);
+      size_ = size;
+      has_parent_ = true;
+    }
+
+    //writes the parts one after another, with align every part after the first two starts at a multiple of
+    //ModelFormat::kAlignment
+    static void WriteBytes(const std::string &filepath, const std::vector<std::pair<const void *, size_t>> &parts,
+                           bool align = false) {
+      std::ofstream os(filepath, std::ios::binary);
+      if (!os.is_open()) {
+        throw std::runtime_error("Failed to open file for writing: " + filepath);
+      }
+
+      const char padding[ModelFormat::kAlignment] = {};
+      size_t position = 0;
+      for (size_t i = 0; i < parts.size(); ++i) {
+        if (align && i >= 2) {
+          os.write(padding, std::streamsize(ModelFormat::AlignUp(position) - position));
+          position = ModelFormat::AlignUp(position);
+        }
+        os.write(static_cast<const char *>(parts[i].first), std::streamsize(parts[i].second));
+        position += parts[i].second;
+      }
+
+      //the last buffered bytes are only written by the close
+      os.close();
+      if (!os) {
+        throw std::runtime_error("Failed to write checkpoint: " + filepath);
+      }
+    }
+  };
+
+  //applies the delta file at filepath to image, which has to hold the checkpoint the delta was taken after
+  inline void ApplyDelta(AlignedVector<uint8_t> &image, const std::string &filepath) {
+    using namespace DeltaFormat;
+
+    const MappedFile file(filepath);
+    const uint8_t *data = file.Data();
+    const size_t size = file.Size();
+
+    if (size < sizeof(Header) || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+      throw std::runtime_error("Not a delta checkpoint: " + filepath);
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != kVersion) {
+      throw std::runtime_error("Unsupported delta checkpoint version " + std::to_string(header.version) + ": "
+                                   + filepath);
+    }
+    if (header.byte_order != ModelFormat::kByteOrderMark) {
+      throw std::runtime_error("Delta checkpoint was written with a different byte order: " + filepath);
+    }
+    if (header.header_checksum != Crc32(&header, offsetof(Header, header_checksum)) || header.chunk_size == 0) {
+      throw std::runtime_error("Corrupted delta checkpoint header: " + filepath);
+    }
+    if (header.chunks > (size - sizeof(Header)) / sizeof(ChunkRecord)) {
+      throw std::runtime_error("Truncated delta checkpoint: " + filepath);
+    }
+
+    std::vector<ChunkRecord> chunks(header.chunks);
+    std::memcpy(chunks.data(), data + sizeof(Header), chunks.size() * sizeof(ChunkRecord));
+    if (header.table_checksum != Crc32(chunks.data(), chunks.size() * sizeof(ChunkRecord))) {
+      throw std::runtime_error("Corrupted delta checkpoint table: " + filepath);
+    }
+
+    const size_t chunk_size = header.chunk_size;
+    if (image.size() != header.parent_size
+        || Fingerprint(ChunkHashes(image.data(), image.size(), chunk_size), image.size())
+            != header.parent_fingerprint) {
+      throw std::runtime_error("Delta checkpoint does not follow the checkpoint it is applied to: " + filepath);
+    }
+
+    image.resize(header.size);
+
+    for (const auto &chunk : chunks) {
+      const size_t start = chunk.index * chunk_size;
+      if (chunk.size > chunk_size || start >= header.size || chunk.size > header.size - start
+          || chunk.offset > size || chunk.size > size - chunk.offset) {
+        throw std::runtime_error("Invalid chunk " + std::to_string(chunk.index) + " in delta checkpoint: " + filepath);
+      }
+      if (chunk.checksum != Crc32(data + chunk.offset, chunk.size)) {
+        throw std::runtime_error("Corrupted chunk " + std::to_string(chunk.index) + " in delta checkpoint: "
+                                     + filepath);
+      }
+      std::memcpy(image.data() + start, data + chunk.offset, chunk.size);
+    }
+
+    if (Fingerprint(ChunkHashes(image.data(), image.size(), chunk_size), image.size()) != header.fingerprint) {
+      throw std::runtime_error("Delta checkpoint is missing changed chunks: " + filepath);
+    }
+  }
+
+  //applies the chain of deltas to the checkpoint at base_filepath in order and writes the result as a complete
+  //model file to filepath, which can replace the base to start a new chain
+  inline void CompactCheckpoints(const std::string &base_filepath, const std::vector<std::string> &delta_filepaths,
+                                 const std::string &filepath) {
+    AlignedVector<uint8_t> image;
+    {
+      const MappedFile base(base_filepath);
+      image.assign(base.Data(), base.Data() + base.Size());
+    }
+
+    for (const auto &delta_filepath : delta_filepaths) {
+      ApplyDelta(image, delta_filepath);
+    }
+
+    const std::string temporary = filepath + ".tmp";
+    {
+      std::ofstream os(temporary, std::ios::binary);
+      os.write(reinterpret_cast<const char *>(image.data()), std::streamsize(image.size()));
+      os.close();
+      if (!os) {
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+        throw std::runtime_error("Failed to write compacted checkpoint: " + temporary);
+      }
+    }
+    SyncFile(temporary);
+    std::filesystem::rename(temporary, filepath);
+  }
+
+}
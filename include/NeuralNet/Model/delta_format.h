@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include <NeuralNet/misc/checksum.h>
+#include <NeuralNet/Model/model_format.h>
+
+namespace NeuralNet::DeltaFormat {
+
+  //a delta checkpoint patches the file of the checkpoint taken before it, its parent, which is a model file or
+  //the result of applying earlier deltas to one. the file is split into chunks of chunk_size bytes and only the
+  //chunks whose hash changed are stored: Header, then ChunkRecord x chunks, then the chunk data each starting at a
+  //multiple of ModelFormat::kAlignment. fingerprints identify parent and result, so deltas are applied in order.
+
+  constexpr char kMagic[8] = {'N', 'N', 'D', 'E', 'L', 'T', 'A', '\0'};
+  constexpr uint32_t kVersion = 1;
+  constexpr size_t kChunkSize = 64 * 1024;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t chunk_size;
+    uint32_t reserved;
+    uint64_t parent_size;
+    uint64_t parent_fingerprint;
+    uint64_t size;            //of the file the delta produces
+    uint64_t fingerprint;
+    uint64_t chunks;
+    uint32_t table_checksum;  //crc of the chunk records
+    uint32_t header_checksum; //crc of the header up to this field
+  };
+
+  struct ChunkRecord {
+    uint64_t index;           //bytes index * chunk_size .. of the file
+    uint64_t offset;          //of the data in the delta file
+    uint32_t size;
+    uint32_t checksum;
+  };
+
+  static_assert(sizeof(Header) == 72);
+  static_assert(sizeof(ChunkRecord) == 24);
+
+  inline std::vector<uint64_t> ChunkHashes(const uint8_t *data, size_t size, size_t chunk_size) {
+    std::vector<uint64_t> hashes((size + chunk_size - 1) / chunk_size);
+    for (size_t i = 0; i < hashes.size(); ++i) {
+      const size_t start = i * chunk_size;
+      hashes[i] = Hash64(data + start, std::min(chunk_size, size - start));
+    }
+    return hashes;
+  }
+
+  inline uint64_t Fingerprint(const std::vector<uint64_t> &hashes, size_t size) {
+    return Hash64(hashes.data(), hashes.size() * sizeof(uint64_t), size);
+  }
+
+}
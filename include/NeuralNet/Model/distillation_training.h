@@ -0,0 +1,199 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <NeuralNet/Model/training_network.h>
+#include <NeuralNet/Layers/Activations/softmax_activation.h>
+
+namespace NeuralNet::Training {
+
+  //trains network, the student, towards a trained teacher network as well as towards the dataset targets. every
+  //target is soft_weight times the teacher's output for the sample plus 1 - soft_weight times the dataset's target.
+  //a teacher ending in softmax has its logits softened by the temperature first, so the student also learns how
+  //similar the teacher finds the other classes, other teachers' outputs are used as they are. the teacher runs
+  //batched over the whole dataset before every epoch, or only once for a dataset passed as a shared_ptr, whose
+  //outputs are cached until an epoch on another dataset or ClearTeacherOutputs
+  template<std::floating_point dataType = NNFLOAT>
+  class DistillationTraining : public NetworkTraining<dataType> {
+   private:
+    std::shared_ptr<const NeuralNetwork<dataType>> teacher_;
+
+    dataType temperature_ = 2;
+    dataType soft_weight_ = 0.5;
+
+    //Size() x OutputSize() softened teacher outputs of the dataset of the current epoch. they are only reused for
+    //cached_dataset_, which is kept alive so no other dataset can be allocated at its address
+    std::vector<dataType> teacher_outputs_;
+    std::shared_ptr<const BaseDataset<dataType>> cached_dataset_;
+
+    static constexpr size_t kTeacherBatchSize = 256;
+
+   public:
+
+    DistillationTraining(const std::shared_ptr<NeuralNetwork<dataType>> &network,
+                         const std::shared_ptr<const NeuralNetwork<dataType>> &teacher,
+                         const std::shared_ptr<BaseOptimizer<dataType>> &optimizer,
+                         const std::shared_ptr<BaseCost<dataType>> &cost_function,
+                         const std::vector<std::shared_ptr<BaseInitializer<dataType>>> &initializers,
+                         std::mt19937 &gen,
+                         const std::vector<std::shared_ptr<BaseLogger<dataType>>> &loggers = {},
+                         bool initialize_weights = true) :
+        NetworkTraining<dataType>(network, optimizer, cost_function, initializers, gen, loggers, initialize_weights),
+        teacher_(teacher) {
+      if (teacher_->InputSize() != network->InputSize() || teacher_->OutputSize() != network->OutputSize()) {
+        throw std::runtime_error("Teacher network is " + std::to_string(teacher_->InputSize()) + " -> "
+                                     + std::to_string(teacher_->OutputSize()) + " but the student is "
+                                     + std::to_string(network->InputSize()) + " -> "
+                                     + std::to_string(network->OutputSize()));
+      }
+    }
+
+    [[nodiscard]] const std::shared_ptr<const NeuralNetwork<dataType>> &Teacher() const {
+      return teacher_;
+    }
+
+    //temperature dividing the teacher's logits before its softmax, higher values give softer targets
+    void SetTemperature(dataType temperature) {
+      if (!(temperature > 0)) {
+        throw std::runtime_error("Distillation temperature must be positive");
+      }
+      temperature_ = temperature;
+      ClearTeacherOutputs();
+    }
+
+    [[nodiscard]] dataType Temperature() const {
+      return temperature_;
+    }
+
+    //share of the teacher's outputs in the targets, 1 ignores the dataset targets and 0 the teacher
+    void SetSoftWeight(dataType soft_weight) {
+      if (!(soft_weight >= 0 && soft_weight <= 1)) {
+        throw std::runtime_error("Distillation soft target weight must be in [0, 1]");
+      }
+      soft_weight_ = soft_weight;
+    }
+
+    [[nodiscard]] dataType SoftWeight() const {
+      return soft_weight_;
+    }
+
+    //the teacher's outputs are computed again on the next epoch, needed when the samples of the cached dataset
+    //change in place
+    void ClearTeacherOutputs() {
+      teacher_outputs_.clear();
+      cached_dataset_.reset();
+    }
+
+    //runs the teacher over dataset first
+    void TrainEpoch(const BaseDataset<dataType> &dataset, size_t batchSize, bool random) {
+      TrainEpoch(dataset, batchSize, this->EpochSampler(random));
+    }
+
+    void TrainEpoch(const BaseDataset<dataType> &dataset, size_t batchSize, BaseSampler &sampler) {
+      ClearTeacherOutputs();
+      ComputeTeacherOutputs(dataset);
+      RunDistillationEpoch(dataset, batchSize, sampler);
+    }
+
+    //runs the teacher only when dataset is not the one of the cached outputs
+    void TrainEpoch(const std::shared_ptr<const BaseDataset<dataType>> &dataset, size_t batchSize, bool random) {
+      TrainEpoch(dataset, batchSize, this->EpochSampler(random));
+    }
+
+    void TrainEpoch(const std::shared_ptr<const BaseDataset<dataType>> &dataset, size_t batchSize,
+                    BaseSampler &sampler) {
+      if (cached_dataset_ != dataset) {
+        ClearTeacherOutputs();
+        ComputeTeacherOutputs(*dataset);
+        cached_dataset_ = dataset;
+      }
+      RunDistillationEpoch(*dataset, batchSize, sampler);
+    }
+
+    //there are no teacher outputs for these, they would train on the hard targets alone
+    void TrainEpoch(const std::vector<std::vector<dataType>> &, const std::vector<std::vector<dataType>> &, size_t,
+                    bool) = delete;
+    void TrainEpoch(BaseStreamDataset<dataType> &, size_t) = delete;
+
+   private:
+
+    void RunDistillationEpoch(const BaseDataset<dataType> &dataset, size_t batchSize, BaseSampler &sampler) {
+      assert(dataset.Size() != 0);
+      assert(dataset.InputSize() == this->network_->InputSize());
+      assert(dataset.TargetSize() == this->network_->OutputSize());
+
+      this->SampleEpoch(dataset.Size(), sampler);
+
+      const InputFormat<dataType> input_format = this->FeedFormat(dataset);
+      const size_t output_size = this->network_->OutputSize();
+
+      this->RunIndexedEpoch(batchSize, [&](const size_t *indices, size_t count, dataType *batch_inputs,
+                                           dataType *batch_targets, uint32_t *) {
+        if (input_format.Encoded()) {
+          dataset.GatherEncoded(indices, count, batch_inputs, batch_targets);
+        } else {
+          dataset.Gather(indices, count, batch_inputs, batch_targets);
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+          const dataType *soft = teacher_outputs_.data() + indices[i] * output_size;
+          dataType *target = batch_targets + i * output_size;
+          for (size_t j = 0; j < output_size; ++j) {
+            target[j] = soft_weight_ * soft[j] + (1 - soft_weight_) * target[j];
+          }
+        }
+      }, input_format);
+    }
+
+    void ComputeTeacherOutputs(const BaseDataset<dataType> &dataset) {
+      const size_t samples = dataset.Size();
+      const size_t output_size = teacher_->OutputSize();
+
+      //the softmax is redone at the temperature from the logits feeding it
+      const size_t layers_size = teacher_->LayersSize();
+      const bool softmax = layers_size > 1
+          && std::dynamic_pointer_cast<const SoftmaxActivation<dataType>>(teacher_->LayerAt(layers_size - 1));
+
+      const auto plan = Compile(teacher_, std::min(kTeacherBatchSize, samples));
+      AlignedVector<dataType> inputs(plan->MaxBatchSize() * teacher_->InputSize());
+      std::vector<size_t> indices(plan->MaxBatchSize());
+      teacher_outputs_.resize(samples * output_size);
+
+      for (size_t start = 0; start < samples; start += plan->MaxBatchSize()) {
+        const size_t count = std::min(plan->MaxBatchSize(), samples - start);
+        std::iota(indices.begin(), indices.begin() + count, start);
+
+        dataset.Gather(indices.data(), count, inputs.data(), nullptr);
+        plan->Forward(inputs.data(), count);
+
+        dataType *soft = teacher_outputs_.data() + start * output_size;
+        if (!softmax) {
+          std::copy(plan->Outputs(), plan->Outputs() + count * output_size, soft);
+          continue;
+        }
+
+        const dataType *logits = plan->Outputs(layers_size - 2);
+        for (size_t i = 0; i < count; ++i) {
+          const dataType *row = logits + i * output_size;
+          dataType *target = soft + i * output_size;
+          const dataType max = *std::max_element(row, row + output_size);
+
+          dataType sum = 0;
+          for (size_t j = 0; j < output_size; ++j) {
+            target[j] = std::exp((row[j] - max) / temperature_);
+            sum += target[j];
+          }
+          for (size_t j = 0; j < output_size; ++j) {
+            target[j] /= sum;
+          }
+        }
+      }
+    }
+  };
+
+}
@@ -0,0 +1,472 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include <NeuralNet/misc/half.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Kernels/half_kernels.h>
+#include <NeuralNet/Model/plan_step.h>
+#include <NeuralNet/Model/base_network.h>
+
+namespace NeuralNet {
+
+  //the layer list of a network lowered to kernels with every buffer preallocated for up to max_batch_size samples,
+  //shapes are only checked in Compile so Forward/Backward run without any per call validation.
+  //steps whose outputs are stored in bfloat16/fp16 keep them and their deltas in 16 bit buffers, the kernels
+  //still compute in dataType on tiles of rows converted into scratch buffers, the gradients of the tiles are summed.
+  //the parameters are never stored in half precision, only converted for layers with a half_forward kernel
+  template<std::floating_point dataType = NNFLOAT>
+  class ExecutionPlan {
+   private:
+    //rows of a tile are chosen so a tile holds about this many values of the wider side of the step
+    static constexpr size_t kTileValues = 16384;
+
+    const std::vector<PlanStep<dataType>> steps_;
+    const size_t max_batch_size_;
+    const bool training_;
+    const Kernels::ISA isa_;
+    const InputFormat<dataType> input_format_;
+
+    //outputs_ and deltas_ of a step stored in half precision are empty, the half_ vectors of the others are
+    std::vector<AlignedVector<dataType>> outputs_;
+    std::vector<AlignedVector<dataType>> deltas_;
+    std::vector<AlignedVector<uint16_t>> half_outputs_;
+    std::vector<AlignedVector<uint16_t>> half_deltas_;
+    std::vector<std::vector<dataType>> grad_parameters_;
+
+    //bfloat16 weights of steps running their half_forward kernel, converted at every Forward
+    std::vector<AlignedVector<uint16_t>> half_parameters_;
+
+    AlignedVector<dataType> scratch_inputs_;
+    AlignedVector<dataType> scratch_outputs_;
+    AlignedVector<dataType> scratch_deltas_;
+    AlignedVector<dataType> scratch_prev_deltas_;
+    std::vector<dataType> scratch_grad_parameters_;
+
+    const void *last_inputs_ = nullptr;
+    size_t last_batch_size_ = 0;
+
+   public:
+
+    ExecutionPlan(std::vector<PlanStep<dataType>> steps, size_t max_batch_size, bool training, Kernels::ISA isa,
+                  const InputFormat<dataType> &input_format = {}) :
+        steps_(std::move(steps)), max_batch_size_(max_batch_size), training_(training), isa_(isa),
+        input_format_(input_format) {
+      size_t scratch_inputs_size = 0;
+      size_t scratch_outputs_size = 0;
+      size_t scratch_grad_parameters_size = 0;
+
+      for (const auto &step : steps_) {
+        const bool half_outputs = step.output_precision != Precision::Native;
+        const size_t outputs_size = max_batch_size_ * step.output_size;
+
+        outputs_.emplace_back(half_outputs ? 0 : outputs_size);
+        half_outputs_.emplace_back(half_outputs ? outputs_size : 0);
+        half_parameters_.emplace_back(UsesHalfForward(step) ? step.input_size * step.output_size : 0);
+
+        if (training_) {
+          deltas_.emplace_back(half_outputs ? 0 : outputs_size);
+          half_deltas_.emplace_back(half_outputs ? outputs_size : 0);
+          grad_parameters_.emplace_back(step.parameters_size);
+        }
+
+        if (Mixed(step)) {
+          const size_t rows = std::min(max_batch_size_, TileRows(step));
+          scratch_inputs_size = std::max(scratch_inputs_size, rows * step.input_size);
+          scratch_outputs_size = std::max(scratch_outputs_size, rows * step.output_size);
+          if (rows < max_batch_size_) {
+            scratch_grad_parameters_size = std::max(scratch_grad_parameters_size, step.parameters_size);
+          }
+        }
+      }
+
+      scratch_inputs_.resize(scratch_inputs_size);
+      scratch_outputs_.resize(scratch_outputs_size);
+      if (training_) {
+        scratch_deltas_.resize(scratch_outputs_size);
+        scratch_prev_deltas_.resize(scratch_inputs_size);
+        scratch_grad_parameters_.resize(scratch_grad_parameters_size);
+      }
+    }
+
+    [[nodiscard]] size_t MaxBatchSize() const {
+      return max_batch_size_;
+    }
+
+    [[nodiscard]] bool Training() const {
+      return training_;
+    }
+
+    [[nodiscard]] Kernels::ISA ISA() const {
+      return isa_;
+    }
+
+    //how the inputs passed to Forward are stored
+    [[nodiscard]] const InputFormat<dataType> &Format() const {
+      return input_format_;
+    }
+
+    [[nodiscard]] size_t InputSize() const {
+      return steps_.front().input_size;
+    }
+
+    [[nodiscard]] size_t OutputSize() const {
+      return steps_.back().output_size;
+    }
+
+    [[nodiscard]] size_t StepsSize() const {
+      return steps_.size();
+    }
+
+    [[nodiscard]] const PlanStep<dataType> &StepAt(size_t index) const {
+      return steps_[index];
+    }
+
+    //how the activations between the steps are stored, the outputs of the last step are always dataType
+    [[nodiscard]] Precision ActivationPrecision() const {
+      return steps_.front().output_precision;
+    }
+
+    //row-major batch_size x OutputSize() result of the last Forward call
+    [[nodiscard]] const dataType *Outputs() const {
+      return outputs_.back().data();
+    }
+
+    //null when the step stores its outputs in half precision, see HalfOutputs
+    [[nodiscard]] const dataType *Outputs(size_t step_index) const {
+      return outputs_[step_index].empty() ? nullptr : outputs_[step_index].data();
+    }
+
+    [[nodiscard]] const uint16_t *HalfOutputs(size_t step_index) const {
+      return half_outputs_[step_index].empty() ? nullptr : half_outputs_[step_index].data();
+    }
+
+    //bytes held by the activation, delta and scratch buffers
+    [[nodiscard]] size_t BufferBytes() const {
+      size_t bytes = (scratch_inputs_.size() + scratch_outputs_.size() + scratch_deltas_.size()
+          + scratch_prev_deltas_.size() + scratch_grad_parameters_.size()) * sizeof(dataType);
+      for (size_t i = 0; i < steps_.size(); ++i) {
+        bytes += outputs_[i].size() * sizeof(dataType) + half_outputs_[i].size() * sizeof(uint16_t);
+        if (training_) {
+          bytes += deltas_[i].size() * sizeof(dataType) + half_deltas_[i].size() * sizeof(uint16_t);
+        }
+      }
+      return bytes;
+    }
+
+    //gradient of the cost with respect to Outputs(), has to be filled before calling Backward
+    [[nodiscard]] dataType *OutputDeltas() {
+      return deltas_.back().data();
+    }
+
+    [[nodiscard]] std::vector<dataType> &GradParameters(size_t step_index) {
+      return grad_parameters_[step_index];
+    }
+
+    [[nodiscard]] size_t LastBatchSize() const {
+      return last_batch_size_;
+    }
+
+    const dataType *Forward(const dataType *inputs, size_t batch_size) {
+      assert(!input_format_.Encoded());
+      return ForwardEncoded(inputs, batch_size);
+    }
+
+    //batch of uint8/int16 inputs for a plan compiled with the matching InputFormat
+    template<typename Element>
+    requires (!std::floating_point<Element>)
+    const dataType *Forward(const Element *inputs, size_t batch_size) {
+      assert(input_format_.element == InputElementOf<Element>());
+      return ForwardEncoded(inputs, batch_size);
+    }
+
+    //inputs are stored as described by Format()
+    const dataType *ForwardEncoded(const void *inputs, size_t batch_size) {
+      assert(batch_size <= max_batch_size_);
+
+      last_inputs_ = inputs;
+      last_batch_size_ = batch_size;
+
+      const size_t steps_size = steps_.size();
+      const dataType *step_inputs = static_cast<const dataType *>(inputs);
+
+      for (size_t i = 0; i < steps_size; ++i) {
+        const PlanStep<dataType> &step = steps_[i];
+        if (!Mixed(step)) {
+          step.forward(step, step_inputs, outputs_[i].data(), batch_size);
+          step_inputs = outputs_[i].data();
+          continue;
+        }
+
+        if (!half_parameters_[i].empty()) {
+          Kernels::ToHalf(Precision::BFloat16, step.parameters, half_parameters_[i].data(),
+                          half_parameters_[i].size());
+        }
+        ForwardMixed(i, batch_size);
+        step_inputs = outputs_[i].data();
+      }
+
+      return outputs_.back().data();
+    }
+
+    //propagates OutputDeltas() back through the batch of the last Forward call and fills GradParameters()
+    void Backward() {
+      assert(training_);
+
+      size_t i = steps_.size() - 1;
+
+      while (i > 0) {
+        if (Mixed(steps_[i])) {
+          BackwardMixed(i);
+        } else {
+          steps_[i].backward(steps_[i], outputs_[i - 1].data(), outputs_[i].data(), deltas_[i].data(),
+                             deltas_[i - 1].data(), GradData(i), last_batch_size_);
+        }
+        --i;
+      }
+
+      if (Mixed(steps_[0])) {
+        BackwardMixed(0);
+      } else {
+        steps_[0].backward(steps_[0], static_cast<const dataType *>(last_inputs_), outputs_[0].data(),
+                           deltas_[0].data(), nullptr, GradData(0), last_batch_size_);
+      }
+    }
+
+    void Print(std::ostream &os = std::cout) const {
+      os << "ExecutionPlan: batch " << max_batch_size_ << ", isa " << Kernels::ISAName(isa_)
+         << (training_ ? ", training" : ", inference");
+      if (ActivationPrecision() != Precision::Native) {
+        os << ", " << PrecisionName(ActivationPrecision()) << " activations";
+      }
+      os << std::endl;
+      if (input_format_.Encoded()) {
+        os << "  inputs " << InputElementName(input_format_.element) << " * " << input_format_.scale << " + "
+           << input_format_.offset << std::endl;
+      }
+
+      for (const auto &step : steps_) {
+        os << "  " << step.input_size << " -> " << step.output_size << " "
+           << (UsesHalfForward(step) ? step.half_kernel_name : step.kernel_name);
+        if (step.fused_activation) {
+          os << " + " << step.fused_activation->kernel_name;
+        }
+        os << std::endl;
+      }
+    }
+
+   private:
+
+    dataType *GradData(size_t step_index) {
+      return grad_parameters_[step_index].empty() ? nullptr : grad_parameters_[step_index].data();
+    }
+
+    static bool Mixed(const PlanStep<dataType> &step) {
+      return step.input_precision != Precision::Native || step.output_precision != Precision::Native;
+    }
+
+    static bool UsesHalfForward(const PlanStep<dataType> &step) {
+      return step.half_forward && step.input_precision == Precision::BFloat16;
+    }
+
+    static size_t TileRows(const PlanStep<dataType> &step) {
+      return std::max<size_t>(4, kTileValues / std::max(step.input_size, step.output_size));
+    }
+
+    //inputs of the first step are the ones passed to Forward, stored as described by input_format_
+    const dataType *NativeInputs(size_t step_index, size_t row) const {
+      if (step_index != 0) {
+        return outputs_[step_index - 1].data() + row * steps_[step_index].input_size;
+      }
+
+      return reinterpret_cast<const dataType *>(static_cast<const uint8_t *>(last_inputs_)
+          + row * steps_[0].input_size * InputElementSize<dataType>(input_format_.element));
+    }
+
+    void ForwardMixed(size_t i, size_t batch_size) {
+      const PlanStep<dataType> &step = steps_[i];
+      const size_t tile_rows = TileRows(step);
+      const bool half_inputs = step.input_precision != Precision::Native;
+      const bool half_outputs = step.output_precision != Precision::Native;
+
+      for (size_t row = 0; row < batch_size; row += tile_rows) {
+        const size_t rows = std::min(tile_rows, batch_size - row);
+        dataType *outputs = half_outputs ? scratch_outputs_.data() : outputs_[i].data() + row * step.output_size;
+
+        if (UsesHalfForward(step)) {
+          step.half_forward(step, half_outputs_[i - 1].data() + row * step.input_size, half_parameters_[i].data(),
+                            outputs, rows);
+        } else if (half_inputs) {
+          Kernels::FromHalf(step.input_precision, half_outputs_[i - 1].data() + row * step.input_size,
+                            scratch_inputs_.data(), rows * step.input_size);
+          step.forward(step, scratch_inputs_.data(), outputs, rows);
+        } else {
+          step.forward(step, NativeInputs(i, row), outputs, rows);
+        }
+
+        if (half_outputs) {
+          Kernels::ToHalf(step.output_precision, outputs, half_outputs_[i].data() + row * step.output_size,
+                          rows * step.output_size);
+        }
+      }
+    }
+
+    void BackwardMixed(size_t i) {
+      const PlanStep<dataType> &step = steps_[i];
+      const size_t batch_size = last_batch_size_;
+      const size_t tile_rows = TileRows(step);
+      dataType *grad_parameters = GradData(i);
+      const bool half_inputs = step.input_precision != Precision::Native;
+      const bool half_outputs = step.output_precision != Precision::Native;
+      const size_t input_size = step.input_size;
+      const size_t output_size = step.output_size;
+
+      for (size_t row = 0; row < batch_size; row += tile_rows) {
+        const size_t rows = std::min(tile_rows, batch_size - row);
+
+        const dataType *inputs = scratch_inputs_.data();
+        dataType *prev_deltas = scratch_prev_deltas_.data();
+        if (half_inputs) {
+          Kernels::FromHalf(step.input_precision, half_outputs_[i - 1].data() + row * input_size,
+                            scratch_inputs_.data(), rows * input_size);
+        } else {
+          inputs = NativeInputs(i, row);
+          prev_deltas = i == 0 ? nullptr : deltas_[i - 1].data() + row * input_size;
+        }
+
+        const dataType *outputs = scratch_outputs_.data();
+        const dataType *deltas = scratch_deltas_.data();
+        if (half_outputs) {
+          Kernels::FromHalf(step.output_precision, half_outputs_[i].data() + row * output_size,
+                            scratch_outputs_.data(), rows * output_size);
+          Kernels::FromHalf(step.output_precision, half_deltas_[i].data() + row * output_size,
+                            scratch_deltas_.data(), rows * output_size);
+        } else {
+          outputs = outputs_[i].data() + row * output_size;
+          deltas = deltas_[i].data() + row * output_size;
+        }
+
+        //the kernels overwrite the gradients, the first tile writes them and the others are added
+        if (grad_parameters && row != 0) {
+          step.backward(step, inputs, outputs, deltas, prev_deltas, scratch_grad_parameters_.data(), rows);
+          for (size_t k = 0; k < step.parameters_size; ++k) {
+            grad_parameters[k] += scratch_grad_parameters_[k];
+          }
+        } else {
+          step.backward(step, inputs, outputs, deltas, prev_deltas, grad_parameters, rows);
+        }
+
+        if (half_inputs) {
+          Kernels::ToHalf(step.input_precision, prev_deltas, half_deltas_[i - 1].data() + row * input_size,
+                          rows * input_size);
+        }
+      }
+    }
+  };
+
+  template<std::floating_point dataType>
+  void FusedForward(const PlanStep<dataType> &step, const dataType *inputs, dataType *outputs, size_t batch_size) {
+    //rows of a tile are a multiple of the four rows the dense kernels block by
+    constexpr size_t kTileValues = 16384;
+    const size_t tile_rows = std::max<size_t>(4, kTileValues / step.output_size / 4 * 4);
+    const size_t input_bytes = step.input_size * InputElementSize<dataType>(step.input_format.element);
+
+    const PlanStep<dataType> &layer = *step.fused_layer;
+    const PlanStep<dataType> &activation = *step.fused_activation;
+
+    for (size_t row = 0; row < batch_size; row += tile_rows) {
+      const size_t rows = std::min(tile_rows, batch_size - row);
+      const auto *tile_inputs = reinterpret_cast<const dataType *>(reinterpret_cast<const uint8_t *>(inputs)
+          + row * input_bytes);
+      dataType *tile_outputs = outputs + row * step.output_size;
+
+      layer.forward(layer, tile_inputs, tile_outputs, rows);
+      activation.forward(activation, tile_outputs, tile_outputs, rows);
+    }
+  }
+
+  template<std::floating_point dataType>
+  void FusedBackward(const PlanStep<dataType> &step, const dataType *, const dataType *, const dataType *,
+                     dataType *, dataType *, size_t) {
+    throw std::runtime_error("Layer " + std::to_string(step.layer->LayerID()) + " has an activation fused into it "
+                                 + "and cannot be trained");
+  }
+
+  //one step running layer and then activation on its outputs in place, for inference. the activation has to work
+  //in place, which every activation does, and the layer's outputs have to be dataType values
+  template<std::floating_point dataType>
+  PlanStep<dataType> FuseSteps(const PlanStep<dataType> &layer, const PlanStep<dataType> &activation) {
+    PlanStep<dataType> step = layer;
+    step.fused_layer = std::make_shared<const PlanStep<dataType>>(layer);
+    step.fused_activation = std::make_shared<const PlanStep<dataType>>(activation);
+    step.forward = &FusedForward<dataType>;
+    step.backward = &FusedBackward<dataType>;
+    step.half_forward = nullptr;
+    return step;
+  }
+
+  //with an encoded input_format the first layer dequantizes the uint8/int16 inputs inside its own kernels,
+  //with a half precision the activations and deltas between the layers are stored in it
+  template<std::floating_point dataType>
+  std::shared_ptr<ExecutionPlan<dataType>> Compile(const std::shared_ptr<const NeuralNetwork<dataType>> &network,
+                                                   size_t max_batch_size,
+                                                   bool training = false,
+                                                   const InputFormat<dataType> &input_format = {},
+                                                   Kernels::ISA isa = Kernels::DetectISA(),
+                                                   Precision precision = Precision::Native) {
+    if (network->LayersSize() == 0) {
+      throw std::runtime_error("Cannot compile an empty network");
+    }
+    if (max_batch_size == 0) {
+      throw std::runtime_error("Cannot compile a network for batch size 0");
+    }
+
+    std::vector<PlanStep<dataType>> steps;
+    steps.reserve(network->LayersSize());
+
+    size_t expected_input_size = network->InputSize();
+
+    for (const auto &layer : *network) {
+      if (layer->InputSize() != expected_input_size) {
+        throw std::runtime_error("Layer " + std::to_string(layer->LayerID()) + " expects " +
+            std::to_string(layer->InputSize()) + " inputs but receives " + std::to_string(expected_input_size));
+      }
+
+      if (steps.empty() && input_format.Encoded()) {
+        if (!layer->AcceptsEncodedInput()) {
+          throw std::runtime_error("Layer " + std::to_string(layer->LayerID()) + " cannot take "
+              + InputElementName(input_format.element) + " inputs");
+        }
+        steps.push_back(layer->LowerEncodedInput(max_batch_size, isa, input_format));
+      } else {
+        steps.push_back(layer->Lower(max_batch_size, isa));
+      }
+      expected_input_size = layer->OutputSize();
+    }
+
+    for (size_t i = 0; i + 1 < steps.size(); ++i) {
+      if (precision != Precision::Native && !steps[i].native_buffers && !steps[i + 1].native_buffers) {
+        steps[i].output_precision = precision;
+        steps[i + 1].input_precision = precision;
+      }
+    }
+
+    return std::make_shared<ExecutionPlan<dataType>>(std::move(steps), max_batch_size, training, isa, input_format);
+  }
+
+  template<std::floating_point dataType>
+  std::shared_ptr<ExecutionPlan<dataType>> Compile(const std::shared_ptr<NeuralNetwork<dataType>> &network,
+                                                   size_t max_batch_size,
+                                                   bool training = false,
+                                                   const InputFormat<dataType> &input_format = {},
+                                                   Kernels::ISA isa = Kernels::DetectISA(),
+                                                   Precision precision = Precision::Native) {
+    return Compile(std::shared_ptr<const NeuralNetwork<dataType>>(network), max_batch_size, training, input_format,
+                   isa, precision);
+  }
+
+}
@@ -0,0 +1,409 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/normalization_layer.h>
+#include <NeuralNet/Layers/Activations/relu_activation.h>
+#include <NeuralNet/Layers/Activations/leaky_relu_activation.h>
+#include <NeuralNet/Layers/Activations/sigmoid_activation.h>
+#include <NeuralNet/Layers/Activations/softmax_activation.h>
+#include <NeuralNet/Layers/Activations/tanh_activation.h>
+#include <NeuralNet/Model/network_graph.h>
+
+//rewrites of a NetworkGraph for inference, each returns whether it changed the graph. they leave the outputs of the
+//graph unchanged up to rounding, Optimize runs all of them
+namespace NeuralNet::GraphPasses {
+
+  template<std::floating_point dataType>
+  std::shared_ptr<const FullyConnectedLayer<dataType>> Dense(const std::shared_ptr<const BaseLayer<dataType>> &layer) {
+    return std::dynamic_pointer_cast<const FullyConnectedLayer<dataType>>(layer);
+  }
+
+  //activations computing every output from the input at the same position
+  template<std::floating_point dataType>
+  bool IsElementwise(const std::shared_ptr<const BaseLayer<dataType>> &layer) {
+    return std::dynamic_pointer_cast<const ReLuActivation<dataType>>(layer)
+        || std::dynamic_pointer_cast<const LeakyReLuActivation<dataType>>(layer)
+        || std::dynamic_pointer_cast<const SigmoidActivation<dataType>>(layer)
+        || std::dynamic_pointer_cast<const TanhActivation<dataType>>(layer);
+  }
+
+  template<std::floating_point dataType>
+  bool IsActivation(const std::shared_ptr<const BaseLayer<dataType>> &layer) {
+    return IsElementwise(layer) || std::dynamic_pointer_cast<const SoftmaxActivation<dataType>>(layer);
+  }
+
+  //whether the last thing node computes never outputs negative values
+  template<std::floating_point dataType>
+  bool NonNegative(const GraphNode<dataType> &node) {
+    const auto &last = node.activation ? node.activation : node.layer;
+    return std::dynamic_pointer_cast<const ReLuActivation<dataType>>(last)
+        || std::dynamic_pointer_cast<const SigmoidActivation<dataType>>(last)
+        || std::dynamic_pointer_cast<const SoftmaxActivation<dataType>>(last);
+  }
+
+  //the elementwise activation layer for size values instead of its own
+  template<std::floating_point dataType>
+  std::shared_ptr<const BaseLayer<dataType>> ResizeActivation(const std::shared_ptr<const BaseLayer<dataType>> &layer,
+                                                              size_t size) {
+    if (std::dynamic_pointer_cast<const ReLuActivation<dataType>>(layer)) {
+      return std::make_shared<ReLuActivation<dataType>>(size, size);
+    }
+    if (const auto leaky = std::dynamic_pointer_cast<const LeakyReLuActivation<dataType>>(layer)) {
+      return std::make_shared<LeakyReLuActivation<dataType>>(size, size, leaky->Alpha());
+    }
+    if (std::dynamic_pointer_cast<const SigmoidActivation<dataType>>(layer)) {
+      return std::make_shared<SigmoidActivation<dataType>>(size, size);
+    }
+    return std::make_shared<TanhActivation<dataType>>(size, size);
+  }
+
+  //applies the activation layer to one sample of values in place
+  template<std::floating_point dataType>
+  void Activate(const BaseLayer<dataType> &layer, std::vector<dataType> &values) {
+    const PlanStep<dataType> step = layer.Lower(1, Kernels::ISA::Scalar);
+    step.forward(step, values.data(), values.data(), 1);
+  }
+
+  template<std::floating_point dataType>
+  std::shared_ptr<FullyConnectedLayer<dataType>> MakeDense(size_t input_size, size_t output_size,
+                                                           const std::vector<dataType> &weights_biases) {
+    auto layer = std::make_shared<FullyConnectedLayer<dataType>>(input_size, output_size);
+    std::copy(weights_biases.begin(), weights_biases.end(), layer->Parameters().begin());
+    return layer;
+  }
+
+  //drops ReLU and leaky ReLU nodes whose inputs are never negative, e.g. a ReLU after a sigmoid or another ReLU
+  template<std::floating_point dataType>
+  bool EliminateIdentityActivations(NetworkGraph<dataType> &graph) {
+    bool changed = false;
+
+    for (size_t i : graph.Schedule()) {
+      const GraphNode<dataType> &node = graph.NodeAt(i);
+      const bool rectifier = std::dynamic_pointer_cast<const ReLuActivation<dataType>>(node.layer)
+          || std::dynamic_pointer_cast<const LeakyReLuActivation<dataType>>(node.layer);
+
+      if (rectifier && !node.activation && node.input != GraphNode<dataType>::kGraphInputs
+          && NonNegative(graph.NodeAt(node.input))) {
+        graph.Replace(i, node.input);
+        changed = true;
+      }
+    }
+
+    return changed;
+  }
+
+  //folds the scale and offset of encoded graph inputs into the fully connected layer reading them, so the plan only
+  //converts the inputs: W' = W * scale, b' = b + offset * (sum of every row of W)
+  template<std::floating_point dataType>
+  bool FoldInputScale(NetworkGraph<dataType> &graph) {
+    const InputFormat<dataType> format = graph.Format();
+    if (!format.Encoded() || (format.scale == 1 && format.offset == 0)) {
+      return false;
+    }
+
+    const size_t first = graph.Schedule().front();
+    const GraphNode<dataType> node = graph.NodeAt(first);
+    const auto dense = Dense(node.layer);
+    if (!dense) {
+      return false;
+    }
+
+    const size_t input_size = dense->InputSize();
+    const size_t output_size = dense->OutputSize();
+    const dataType *weights = dense->WeightsBiases();
+
+    std::vector<dataType> folded(weights, weights + input_size * output_size + output_size);
+    for (size_t j = 0; j < output_size; ++j) {
+      double row_sum = 0;
+      for (size_t k = 0; k < input_size; ++k) {
+        row_sum += weights[j * input_size + k];
+        folded[j * input_size + k] = weights[j * input_size + k] * format.scale;
+      }
+      folded[input_size * output_size + j] += static_cast<dataType>(format.offset * row_sum);
+    }
+
+    graph.Replace(first, graph.AddNode({MakeDense(input_size, output_size, folded), node.activation, node.input}));
+    graph.SetFormat({format.element, 1, 0});
+    return true;
+  }
+
+  //folds a normalization node into the fully connected node reading it, W' = W diag(scale) and
+  //b' = b + W offset, so the plan no longer makes a pass over the inputs and their normalized copy
+  template<std::floating_point dataType>
+  bool FoldNormalization(NetworkGraph<dataType> &graph) {
+    for (size_t i : graph.Schedule()) {
+      const GraphNode<dataType> normalization = graph.NodeAt(i);
+      const auto layer = std::dynamic_pointer_cast<const NormalizationLayer<dataType>>(normalization.layer);
+      if (!layer || normalization.activation) {
+        continue;
+      }
+
+      const std::vector<size_t> readers = graph.Readers(i);
+      if (readers.size() != 1) {
+        continue;
+      }
+      const GraphNode<dataType> reader = graph.NodeAt(readers.front());
+      const auto dense = Dense(reader.layer);
+      if (!dense) {
+        continue;
+      }
+
+      const size_t input_size = dense->InputSize();
+      const size_t output_size = dense->OutputSize();
+      const dataType *weights = dense->WeightsBiases();
+      const std::vector<dataType> &scale = layer->Scale();
+      const std::vector<dataType> &offset = layer->Offset();
+
+      std::vector<dataType> folded(weights, weights + input_size * output_size + output_size);
+      for (size_t j = 0; j < output_size; ++j) {
+        double shift = 0;
+        for (size_t k = 0; k < input_size; ++k) {
+          shift += static_cast<double>(weights[j * input_size + k]) * offset[k];
+          folded[j * input_size + k] = weights[j * input_size + k] * scale[k];
+        }
+        folded[input_size * output_size + j] += static_cast<dataType>(shift);
+      }
+
+      graph.Replace(readers.front(), graph.AddNode({MakeDense(input_size, output_size, folded), reader.activation,
+                                                    normalization.input}));
+      return true;
+    }
+
+    return false;
+  }
+
+  //replaces a fully connected node feeding another one directly by their product, W = W2 W1 and b = W2 b1 + b2,
+  //when that needs no more multiply adds than the two layers. a low rank factorization is never undone this way
+  template<std::floating_point dataType>
+  bool MergeLinearLayers(NetworkGraph<dataType> &graph) {
+    for (size_t i : graph.Schedule()) {
+      const GraphNode<dataType> second = graph.NodeAt(i);
+      const auto outer = Dense(second.layer);
+      if (!outer || second.input == GraphNode<dataType>::kGraphInputs) {
+        continue;
+      }
+
+      const GraphNode<dataType> first = graph.NodeAt(second.input);
+      const auto inner = Dense(first.layer);
+      if (!inner || first.activation || graph.Readers(second.input).size() != 1) {
+        continue;
+      }
+
+      const size_t input_size = inner->InputSize();
+      const size_t hidden_size = inner->OutputSize();
+      const size_t output_size = outer->OutputSize();
+      if (input_size * output_size > hidden_size * (input_size + output_size)) {
+        continue;
+      }
+
+      const dataType *w1 = inner->WeightsBiases();
+      const dataType *b1 = w1 + input_size * hidden_size;
+      const dataType *w2 = outer->WeightsBiases();
+      const dataType *b2 = w2 + hidden_size * output_size;
+
+      std::vector<dataType> merged(input_size * output_size + output_size);
+      std::vector<double> row(input_size);
+      for (size_t j = 0; j < output_size; ++j) {
+        std::fill(row.begin(), row.end(), 0.0);
+        double bias = b2[j];
+        for (size_t h = 0; h < hidden_size; ++h) {
+          const double weight = w2[j * hidden_size + h];
+          bias += weight * b1[h];
+          for (size_t k = 0; k < input_size; ++k) {
+            row[k] += weight * w1[h * input_size + k];
+          }
+        }
+        std::copy(row.begin(), row.end(), merged.begin() + j * input_size);
+        merged[input_size * output_size + j] = static_cast<dataType>(bias);
+      }
+
+      graph.Replace(i, graph.AddNode({MakeDense(input_size, output_size, merged), second.activation, first.input}));
+      return true;
+    }
+
+    return false;
+  }
+
+  //removes the hidden units between two fully connected layers, optionally with elementwise activations in between,
+  //that do not affect the outputs. a unit whose weights are all zero outputs a constant, which is folded into the
+  //biases of the second layer, and a unit whose weights in the second layer are all zero is never read
+  template<std::floating_point dataType>
+  bool EliminateDeadUnits(NetworkGraph<dataType> &graph) {
+    for (size_t i : graph.Schedule()) {
+      const GraphNode<dataType> last = graph.NodeAt(i);
+      const auto outer = Dense(last.layer);
+      if (!outer || last.input == GraphNode<dataType>::kGraphInputs) {
+        continue;
+      }
+
+      //an elementwise activation node may sit between the two layers
+      size_t first_index = last.input;
+      std::shared_ptr<const BaseLayer<dataType>> between;
+      if (IsElementwise(graph.NodeAt(first_index).layer) && !graph.NodeAt(first_index).activation) {
+        if (graph.Readers(first_index).size() != 1) {
+          continue;
+        }
+        between = graph.NodeAt(first_index).layer;
+        first_index = graph.NodeAt(first_index).input;
+      }
+      if (first_index == GraphNode<dataType>::kGraphInputs || graph.Readers(first_index).size() != 1) {
+        continue;
+      }
+
+      const GraphNode<dataType> first = graph.NodeAt(first_index);
+      const auto inner = Dense(first.layer);
+      if (!inner || (first.activation && !IsElementwise(first.activation))) {
+        continue;
+      }
+
+      const size_t input_size = inner->InputSize();
+      const size_t hidden_size = inner->OutputSize();
+      const size_t output_size = outer->OutputSize();
+      const dataType *w1 = inner->WeightsBiases();
+      const dataType *b1 = w1 + input_size * hidden_size;
+      const dataType *outer_begin = outer->WeightsBiases();
+      std::vector<dataType> w2(outer_begin, outer_begin + hidden_size * output_size + output_size);
+
+      //what every unit outputs when its weights are zero
+      std::vector<dataType> constants(b1, b1 + hidden_size);
+      if (first.activation) {
+        Activate(*first.activation, constants);
+      }
+      if (between) {
+        Activate(*between, constants);
+      }
+
+      std::vector<size_t> kept;
+      bool folded = false;
+      for (size_t h = 0; h < hidden_size; ++h) {
+        const dataType *row = w1 + h * input_size;
+        if (std::all_of(row, row + input_size, [](dataType w) { return w == 0; })) {
+          for (size_t j = 0; j < output_size; ++j) {
+            if (w2[j * hidden_size + h] != 0) {
+              w2[hidden_size * output_size + j] += w2[j * hidden_size + h] * constants[h];
+              w2[j * hidden_size + h] = 0;
+              folded = true;
+            }
+          }
+        }
+
+        bool read = false;
+        for (size_t j = 0; j < output_size && !read; ++j) {
+          read = w2[j * hidden_size + h] != 0;
+        }
+        if (read) {
+          kept.push_back(h);
+        }
+      }
+
+      //a layer needs at least one unit, with all of them unread any one will do
+      if (kept.empty()) {
+        kept.push_back(0);
+      }
+      if (kept.size() == hidden_size && !folded) {
+        continue;
+      }
+
+      const size_t kept_size = kept.size();
+      std::vector<dataType> inner_parameters(input_size * kept_size + kept_size);
+      std::vector<dataType> outer_parameters(kept_size * output_size + output_size);
+      for (size_t u = 0; u < kept_size; ++u) {
+        std::copy(w1 + kept[u] * input_size, w1 + (kept[u] + 1) * input_size,
+                  inner_parameters.begin() + u * input_size);
+        inner_parameters[input_size * kept_size + u] = b1[kept[u]];
+        for (size_t j = 0; j < output_size; ++j) {
+          outer_parameters[j * kept_size + u] = w2[j * hidden_size + kept[u]];
+        }
+      }
+      std::copy(w2.begin() + hidden_size * output_size, w2.end(), outer_parameters.begin() + kept_size * output_size);
+
+      size_t node = graph.AddNode({MakeDense(input_size, kept_size, inner_parameters),
+                                   first.activation ? ResizeActivation(first.activation, kept_size) : nullptr,
+                                   first.input});
+      if (between) {
+        node = graph.AddNode({ResizeActivation(between, kept_size), nullptr, node});
+      }
+      graph.Replace(i, graph.AddNode({MakeDense(kept_size, output_size, outer_parameters), last.activation, node}));
+      return true;
+    }
+
+    return false;
+  }
+
+  //fuses every activation node into the node it reads, so the activation runs on the layer's outputs while they
+  //are still in cache and the buffer between them disappears
+  template<std::floating_point dataType>
+  bool FuseActivations(NetworkGraph<dataType> &graph) {
+    bool changed = false;
+
+    for (size_t i : graph.Schedule()) {
+      const GraphNode<dataType> activation = graph.NodeAt(i);
+      if (!IsActivation(activation.layer) || activation.activation
+          || activation.input == GraphNode<dataType>::kGraphInputs) {
+        continue;
+      }
+
+      const GraphNode<dataType> layer = graph.NodeAt(activation.input);
+      if (layer.activation || IsActivation(layer.layer) || graph.Readers(activation.input).size() != 1
+          || layer.layer->Lower(1, Kernels::ISA::Scalar).native_buffers) {
+        continue;
+      }
+
+      graph.Replace(i, graph.AddNode({layer.layer, activation.layer, layer.input}));
+      changed = true;
+    }
+
+    return changed;
+  }
+
+  //drops the activation computing the graph outputs when it keeps the order of the values of every sample, so the
+  //outputs are the logits before it. unlike the other passes this changes the outputs, it is meant for callers that
+  //only look at the largest ones, see NetworkClassifier
+  template<std::floating_point dataType>
+  bool DropMonotonicOutput(NetworkGraph<dataType> &graph) {
+    auto monotonic = [](const std::shared_ptr<const BaseLayer<dataType>> &layer) {
+      return std::dynamic_pointer_cast<const SoftmaxActivation<dataType>>(layer)
+          || std::dynamic_pointer_cast<const SigmoidActivation<dataType>>(layer)
+          || std::dynamic_pointer_cast<const TanhActivation<dataType>>(layer);
+    };
+
+    const size_t output = graph.Output();
+    const GraphNode<dataType> node = graph.NodeAt(output);
+
+    if (node.activation) {
+      if (!monotonic(node.activation)) {
+        return false;
+      }
+      graph.Replace(output, graph.AddNode({node.layer, nullptr, node.input}));
+      return true;
+    }
+
+    //the graph needs a node, an activation reading the graph inputs stays
+    if (!monotonic(node.layer) || node.input == GraphNode<dataType>::kGraphInputs) {
+      return false;
+    }
+    graph.Replace(output, node.input);
+    return true;
+  }
+
+  //runs the simplifying passes until none applies, then fuses the activations and drops the dead nodes
+  template<std::floating_point dataType>
+  void Optimize(NetworkGraph<dataType> &graph) {
+    bool changed = true;
+    while (changed) {
+      changed = EliminateIdentityActivations(graph);
+      changed |= FoldNormalization(graph);
+      changed |= FoldInputScale(graph);
+      changed |= EliminateDeadUnits(graph);
+      changed |= MergeLinearLayers(graph);
+    }
+
+    FuseActivations(graph);
+    graph.RemoveDeadNodes();
+  }
+
+}
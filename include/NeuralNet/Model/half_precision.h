@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+#include <NeuralNet/misc/half.h>
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/half_fully_connected_layer.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/base_network.h>
+
+namespace NeuralNet {
+
+  //inference network from a trained one with every FullyConnectedLayer replaced by a HalfFullyConnectedLayer
+  //storing its weights in precision, no calibration is needed
+  template<std::floating_point dataType>
+  std::shared_ptr<NeuralNetwork<dataType>> HalfPrecisionWeights(const std::shared_ptr<NeuralNetwork<dataType>> &network,
+                                                                Precision precision) {
+    ModelWriter writer;
+    std::vector<std::unique_ptr<HalfFullyConnectedLayer<dataType>>> converted;
+
+    for (size_t i = 0; i < network->LayersSize(); ++i) {
+      const auto layer = network->LayerAt(i);
+      const auto dense = std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(layer);
+      if (!dense) {
+        layer->Save(writer);
+        continue;
+      }
+
+      converted.push_back(std::make_unique<HalfFullyConnectedLayer<dataType>>(
+          dense->InputSize(), dense->OutputSize(), dense->WeightsBiases(), precision));
+      converted.back()->Save(writer);
+    }
+
+    return Load<dataType>(writer, "half precision network");
+  }
+
+}
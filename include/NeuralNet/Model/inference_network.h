@@ -3,8 +3,10 @@
 #include <memory>
 #include <vector>
 #include <cassert>
+#include <algorithm>
 
 #include <NeuralNet/Model/base_network.h>
+#include <NeuralNet/Model/execution_plan.h>
 
 namespace NeuralNet {
 
@@ -12,47 +14,42 @@ namespace NeuralNet {
   class NetworkInference {
    protected:
     std::shared_ptr<NeuralNetwork<dataType>> network_;
+    std::shared_ptr<ExecutionPlan<dataType>> plan_;
 
    protected:
-    std::vector<std::vector<std::vector<dataType>>> compute_outputs_storage_;
-    std::vector<std::vector<std::vector<dataType> *>> compute_outputs_;
-    std::vector<std::vector<dataType> *> compute_inputs_;
+    std::vector<dataType> output_;
 
    public:
-    explicit NetworkInference(const std::shared_ptr<NeuralNetwork<dataType>> &network) : network_(network) {
-      compute_inputs_.resize(1);
-
-      for (const auto &layer : *network_) {
-        compute_outputs_storage_.push_back(
-            std::vector<std::vector<dataType>>({std::vector<dataType>(layer->OutputSize())}));
-        compute_outputs_.push_back(std::vector<std::vector<dataType> *>({&(compute_outputs_storage_.back()[0])}));
-      }
-
+    //with an encoded input_format the batched operator() takes uint8/int16 inputs
+    explicit NetworkInference(const std::shared_ptr<NeuralNetwork<dataType>> &network, size_t max_batch_size = 1,
+                              const InputFormat<dataType> &input_format = {})
+        : network_(network), plan_(Compile(network, max_batch_size, false, input_format)),
+          output_(network->OutputSize()) {}
+
+    [[nodiscard]] const std::shared_ptr<ExecutionPlan<dataType>> &Plan() const {
+      return plan_;
     }
 
     std::vector<dataType> &operator()(const std::vector<dataType> &input) {
-      compute_inputs_[0] = const_cast<std::vector<dataType> *>( &input );
+      assert(input.size() == network_->InputSize());
 
-      Forward(compute_inputs_, compute_outputs_);
+      const dataType *output = plan_->Forward(input.data(), 1);
+      std::copy(output, output + output_.size(), output_.begin());
 
-      return compute_outputs_storage_.back()[0];
+      return output_;
     }
 
-   protected:
-
-    void Forward(const std::vector<std::vector<dataType> *> &inputs,
-                 std::vector<std::vector<std::vector<dataType> *>> &outputs) {
-      assert(this->network_->LayersSize() != 0);
-
-      size_t layers_size = network_->LayersSize();
-
-      network_->LayerAt(0)->Forward(inputs, outputs[0]);
+    //inputs and the returned outputs are row-major, batch_size must not exceed the batch size the plan was compiled for
+    const dataType *operator()(const dataType *inputs, size_t batch_size) {
+      return plan_->Forward(inputs, batch_size);
+    }
 
-      for (size_t i = 1; i < layers_size; ++i) {
-        network_->LayerAt(i)->Forward(outputs[i - 1], outputs[i]);
-      }
+    template<typename Element>
+    requires (!std::floating_point<Element>)
+    const dataType *operator()(const Element *inputs, size_t batch_size) {
+      return plan_->Forward(inputs, batch_size);
     }
 
   };
 
-}
\ No newline at end of file
+}
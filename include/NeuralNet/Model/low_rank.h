@@ -0,0 +1,133 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <NeuralNet/misc/math_util.h>
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/base_network.h>
+
+namespace NeuralNet {
+
+  //network where every FullyConnectedLayer W is replaced by two thinner ones, input_size -> rank and
+  //rank -> output_size, whose product is the best rank approximation of W. rank is the smallest number of singular
+  //values holding energy of the sum of squared singular values of W, layers that would not get fewer weights that way
+  //are kept. weights and multiply adds shrink to rank * (input_size + output_size), the result is made of plain
+  //fully connected layers, so it runs with the usual kernels and can be fine-tuned with NetworkTraining constructed
+  //with initialize_weights false, a few epochs at a tenth of the training learning rate recover most of the accuracy.
+  //the decomposition is cubic in the smaller side of every layer, minutes for 4096 x 4096
+  template<std::floating_point dataType>
+  std::shared_ptr<NeuralNetwork<dataType>> FactorizeLowRank(const std::shared_ptr<NeuralNetwork<dataType>> &network,
+                                                            double energy = 0.99) {
+    if (!(energy > 0 && energy <= 1)) {
+      throw std::runtime_error("Low rank energy must be in (0, 1]");
+    }
+
+    ModelWriter writer;
+    std::vector<std::unique_ptr<FullyConnectedLayer<dataType>>> factors;
+
+    for (size_t i = 0; i < network->LayersSize(); ++i) {
+      const auto layer = network->LayerAt(i);
+      const auto dense = std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(layer);
+      if (!dense) {
+        layer->Save(writer);
+        continue;
+      }
+
+      const size_t input_size = dense->InputSize();
+      const size_t output_size = dense->OutputSize();
+      const dataType *weights = dense->WeightsBiases();
+      const dataType *biases = weights + input_size * output_size;
+
+      //a factorization pays off below this rank
+      const size_t max_rank = (input_size * output_size - 1) / (input_size + output_size);
+      if (max_rank == 0) {
+        layer->Save(writer);
+        continue;
+      }
+
+      //x is W or its transpose, whichever has fewer rows, the eigenvectors of x x^T are its left singular vectors
+      const bool wide = output_size <= input_size;
+      const size_t rows = wide ? output_size : input_size;
+      const size_t columns = wide ? input_size : output_size;
+
+      std::vector<double> x(rows * columns);
+      for (size_t o = 0; o < output_size; ++o) {
+        for (size_t k = 0; k < input_size; ++k) {
+          x[wide ? o * columns + k : k * columns + o] = weights[o * input_size + k];
+        }
+      }
+
+      std::vector<double> gram(rows * rows);
+      for (size_t a = 0; a < rows; ++a) {
+        for (size_t b = a; b < rows; ++b) {
+          const double dot = MathUtil::Dot(x.data() + a * columns, x.data() + b * columns, columns);
+          gram[a * rows + b] = dot;
+          gram[b * rows + a] = dot;
+        }
+      }
+
+      std::vector<double> squared_values;
+      MathUtil::SymmetricEigen(gram, rows, squared_values);
+
+      double total = 0;
+      for (double &value : squared_values) {
+        value = std::max(value, 0.0);
+        total += value;
+      }
+
+      size_t rank = 1;
+      for (double kept = squared_values[0]; rank < rows && kept < energy * total; ++rank) {
+        kept += squared_values[rank];
+      }
+      if (rank > max_rank) {
+        layer->Save(writer);
+        continue;
+      }
+
+      //W ~= second * first with the rank singular vectors q in rows of gram: first = q^T W and second = q when W is
+      //wide, first = q^T and second = W q otherwise
+      auto first = std::make_unique<FullyConnectedLayer<dataType>>(input_size, rank);
+      auto second = std::make_unique<FullyConnectedLayer<dataType>>(rank, output_size);
+      std::vector<dataType> &first_parameters = first->Parameters();
+      std::vector<dataType> &second_parameters = second->Parameters();
+
+      std::vector<double> row(input_size);
+      for (size_t r = 0; r < rank; ++r) {
+        const double *q = gram.data() + r * rows;
+        if (wide) {
+          std::fill(row.begin(), row.end(), 0.0);
+          for (size_t o = 0; o < output_size; ++o) {
+            MathUtil::Axpy(q[o], weights + o * input_size, row.data(), input_size);
+          }
+          std::copy(row.begin(), row.end(), first_parameters.begin() + r * input_size);
+          for (size_t o = 0; o < output_size; ++o) {
+            second_parameters[o * rank + r] = static_cast<dataType>(q[o]);
+          }
+        } else {
+          std::copy(q, q + input_size, first_parameters.begin() + r * input_size);
+          for (size_t o = 0; o < output_size; ++o) {
+            const dataType *weights_row = weights + o * input_size;
+            double sum = 0;
+            for (size_t k = 0; k < input_size; ++k) {
+              sum += q[k] * weights_row[k];
+            }
+            second_parameters[o * rank + r] = static_cast<dataType>(sum);
+          }
+        }
+      }
+      std::copy(biases, biases + output_size, second_parameters.begin() + rank * output_size);
+
+      first->Save(writer);
+      second->Save(writer);
+      factors.push_back(std::move(first));
+      factors.push_back(std::move(second));
+    }
+
+    return Load<dataType>(writer, "low rank network");
+  }
+
+}
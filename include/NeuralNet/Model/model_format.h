@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+namespace NeuralNet::ModelFormat {
+
+  //Header, then LayerRecord x layers, then BlockRecord x blocks, then the blocks each starting at a multiple of
+  //kAlignment, so a mapped file can be used in place. all values are stored in the byte order of the writer,
+  //which is recorded by kByteOrderMark.
+
+  constexpr char kMagic[8] = {'N', 'N', 'M', 'O', 'D', 'E', 'L', '\0'};
+  constexpr uint32_t kVersion = 1;
+  constexpr uint32_t kByteOrderMark = 0x01020304;
+  constexpr size_t kAlignment = 64;
+  constexpr size_t kAttributes = 4;
+
+  //record types with this bit set hold training state saved by NetworkTraining::SaveState instead of a layer,
+  //Load skips them so a training checkpoint is also a loadable model
+  constexpr uint32_t kStateRecord = 0x40000000;
+
+  enum StateRecord : uint32_t {
+    OptimizerState = kStateRecord | 1,
+    TrainingState = kStateRecord | 2,
+    PrunerState = kStateRecord | 3,
+  };
+
+  enum class Element : uint32_t {
+    Float32 = 1,
+    Float64 = 2,
+    Int8 = 3,
+    UInt8 = 4,
+    Int16 = 5,
+    UInt16 = 6,
+    Int32 = 7,
+    UInt32 = 8,
+    Int64 = 9,
+    UInt64 = 10,
+  };
+
+  template<typename T>
+  constexpr Element ElementOf() {
+    if constexpr (std::is_same_v<T, float>) return Element::Float32;
+    else if constexpr (std::is_same_v<T, double>) return Element::Float64;
+    else if constexpr (std::is_same_v<T, int8_t>) return Element::Int8;
+    else if constexpr (std::is_same_v<T, uint8_t>) return Element::UInt8;
+    else if constexpr (std::is_same_v<T, int16_t>) return Element::Int16;
+    else if constexpr (std::is_same_v<T, uint16_t>) return Element::UInt16;
+    else if constexpr (std::is_same_v<T, int32_t>) return Element::Int32;
+    else if constexpr (std::is_same_v<T, uint32_t>) return Element::UInt32;
+    else if constexpr (std::is_same_v<T, int64_t>) return Element::Int64;
+    else {
+      static_assert(std::is_same_v<T, uint64_t>, "Unsupported model block element type");
+      return Element::UInt64;
+    }
+  }
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t dtype;           //Element of the network's dataType
+    uint32_t reserved;
+    uint64_t layers;
+    uint64_t blocks;
+    uint64_t data_offset;     //first parameter block
+    uint64_t file_size;
+    uint32_t table_checksum;  //crc of the layer and block records
+    uint32_t header_checksum; //crc of the header up to this field
+  };
+
+  //attributes hold scalar layer settings such as the slope of a leaky ReLU
+  struct LayerRecord {
+    uint32_t type;
+    uint32_t blocks;
+    uint64_t input_size;
+    uint64_t output_size;
+    uint64_t first_block;
+    double attributes[kAttributes];
+  };
+
+  struct BlockRecord {
+    uint64_t offset;
+    uint64_t count;
+    uint32_t element;
+    uint32_t checksum;
+  };
+
+  static_assert(sizeof(Header) == 64);
+  static_assert(sizeof(LayerRecord) == 64);
+  static_assert(sizeof(BlockRecord) == 24);
+
+  inline size_t ElementSize(Element element) {
+    switch (element) {
+      case Element::Int8:
+      case Element::UInt8: return 1;
+      case Element::Int16:
+      case Element::UInt16: return 2;
+      case Element::Float32:
+      case Element::Int32:
+      case Element::UInt32: return 4;
+      case Element::Float64:
+      case Element::Int64:
+      case Element::UInt64: return 8;
+      default: return 0;
+    }
+  }
+
+  inline size_t AlignUp(size_t offset) {
+    return (offset + kAlignment - 1) / kAlignment * kAlignment;
+  }
+
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+#include <NeuralNet/misc/checksum.h>
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/Model/model_format.h>
+
+namespace NeuralNet {
+
+  //a model file mapped into memory with its header and tables validated, parameter blocks are used in place
+  class ModelReader {
+   public:
+    class LayerView;
+
+   private:
+    std::string filepath_;
+    std::shared_ptr<const MappedFile> file_;
+
+    const ModelFormat::Header *header_ = nullptr;
+    const ModelFormat::LayerRecord *layers_ = nullptr;
+    const ModelFormat::BlockRecord *blocks_ = nullptr;
+
+   public:
+
+    //verify_blocks checksums every parameter block, which reads the whole file instead of only the tables
+    explicit ModelReader(const std::string &filepath, bool verify_blocks = false)
+        : ModelReader(std::make_shared<const MappedFile>(filepath), filepath, verify_blocks) {}
+
+    //a model that is already in memory, filepath only names it in errors
+    ModelReader(std::shared_ptr<const MappedFile> file, const std::string &filepath, bool verify_blocks = false)
+        : filepath_(filepath), file_(std::move(file)) {
+      using namespace ModelFormat;
+
+      const uint8_t *data = file_->Data();
+      const size_t size = file_->Size();
+
+      if (size < sizeof(Header) || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a model file: " + filepath);
+      }
+
+      header_ = reinterpret_cast<const Header *>(data);
+      if (header_->version != kVersion) {
+        throw std::runtime_error("Unsupported model file version " + std::to_string(header_->version) + ": " + filepath);
+      }
+      if (header_->byte_order != kByteOrderMark) {
+        throw std::runtime_error("Model file was written with a different byte order: " + filepath);
+      }
+      if (header_->header_checksum != Crc32(header_, offsetof(Header, header_checksum))) {
+        throw std::runtime_error("Corrupted model file header: " + filepath);
+      }
+      if (header_->file_size != size) {
+        throw std::runtime_error("Truncated model file: " + filepath);
+      }
+
+      const size_t layers_bytes = header_->layers * sizeof(LayerRecord);
+      const size_t blocks_bytes = header_->blocks * sizeof(BlockRecord);
+      if (sizeof(Header) + layers_bytes + blocks_bytes > size) {
+        throw std::runtime_error("Truncated model file tables: " + filepath);
+      }
+
+      layers_ = reinterpret_cast<const LayerRecord *>(data + sizeof(Header));
+      blocks_ = reinterpret_cast<const BlockRecord *>(data + sizeof(Header) + layers_bytes);
+
+      if (header_->table_checksum != Crc32(blocks_, blocks_bytes, Crc32(layers_, layers_bytes))) {
+        throw std::runtime_error("Corrupted model file tables: " + filepath);
+      }
+
+      for (size_t i = 0; i < header_->blocks; ++i) {
+        const BlockRecord &block = blocks_[i];
+        const size_t element_size = ElementSize(static_cast<Element>(block.element));
+
+        if (element_size == 0 || block.offset % kAlignment != 0 || block.offset > size
+            || block.count > (size - block.offset) / element_size) {
+          throw std::runtime_error("Invalid parameter block " + std::to_string(i) + " in model file: " + filepath);
+        }
+        if (verify_blocks && block.checksum != Crc32(data + block.offset, block.count * element_size)) {
+          throw std::runtime_error("Corrupted parameter block " + std::to_string(i) + " in model file: " + filepath);
+        }
+      }
+
+      for (size_t i = 0; i < header_->layers; ++i) {
+        if (layers_[i].first_block + layers_[i].blocks > header_->blocks) {
+          throw std::runtime_error("Invalid layer record " + std::to_string(i) + " in model file: " + filepath);
+        }
+      }
+    }
+
+    [[nodiscard]] const std::string &Filepath() const {
+      return filepath_;
+    }
+
+    [[nodiscard]] ModelFormat::Element DType() const {
+      return static_cast<ModelFormat::Element>(header_->dtype);
+    }
+
+    [[nodiscard]] size_t LayersSize() const {
+      return header_->layers;
+    }
+
+    [[nodiscard]] LayerView Layer(size_t index) const;
+  };
+
+  class ModelReader::LayerView {
+   private:
+    const ModelReader *reader_;
+    const ModelFormat::LayerRecord *record_;
+    size_t index_;
+
+   public:
+
+    LayerView(const ModelReader *reader, const ModelFormat::LayerRecord *record, size_t index)
+        : reader_(reader), record_(record), index_(index) {}
+
+    [[nodiscard]] int Type() const {
+      return static_cast<int>(record_->type);
+    }
+
+    [[nodiscard]] size_t Index() const {
+      return index_;
+    }
+
+    [[nodiscard]] size_t InputSize() const {
+      return record_->input_size;
+    }
+
+    [[nodiscard]] size_t OutputSize() const {
+      return record_->output_size;
+    }
+
+    [[nodiscard]] double Attribute(size_t index) const {
+      return record_->attributes[index];
+    }
+
+    [[nodiscard]] size_t BlocksSize() const {
+      return record_->blocks;
+    }
+
+    [[nodiscard]] size_t BlockCount(size_t block) const {
+      return Record(block).count;
+    }
+
+    template<typename T>
+    [[nodiscard]] bool BlockIs(size_t block) const {
+      return Record(block).element == static_cast<uint32_t>(ModelFormat::ElementOf<T>());
+    }
+
+    //the block in place inside the mapping, it has to hold exactly count values of type T
+    template<typename T>
+    [[nodiscard]] const T *Block(size_t block, size_t count) const {
+      const ModelFormat::BlockRecord &record = Record(block);
+      if (!BlockIs<T>(block) || record.count != count) {
+        throw Error("unexpected parameter block " + std::to_string(block));
+      }
+      return reinterpret_cast<const T *>(reader_->file_->Data() + record.offset);
+    }
+
+    //a copy of a floating point block converted to T, for files written with a different dataType
+    template<typename T>
+    [[nodiscard]] std::vector<T> ConvertBlock(size_t block, size_t count) const {
+      if (BlockIs<float>(block)) {
+        const float *values = Block<float>(block, count);
+        return std::vector<T>(values, values + count);
+      }
+      const double *values = Block<double>(block, count);
+      return std::vector<T>(values, values + count);
+    }
+
+    //keeps the blocks returned by Block valid while a layer uses them in place
+    [[nodiscard]] const std::shared_ptr<const MappedFile> &Mapping() const {
+      return reader_->file_;
+    }
+
+    [[nodiscard]] std::runtime_error Error(const std::string &message) const {
+      return std::runtime_error("Layer " + std::to_string(index_) + " in model file " + reader_->filepath_ + ": "
+                                    + message);
+    }
+
+   private:
+
+    const ModelFormat::BlockRecord &Record(size_t block) const {
+      if (block >= record_->blocks) {
+        throw Error("missing parameter block " + std::to_string(block));
+      }
+      return reader_->blocks_[record_->first_block + block];
+    }
+  };
+
+  inline ModelReader::LayerView ModelReader::Layer(size_t index) const {
+    return {this, layers_ + index, index};
+  }
+
+}
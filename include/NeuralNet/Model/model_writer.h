@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <NeuralNet/misc/checksum.h>
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Model/model_format.h>
+
+namespace NeuralNet {
+
+  //collects the layer records of a network during Save and writes them with their parameter blocks,
+  //blocks are only referenced until Write so the layers must stay unchanged in between unless CopyBlocks is called
+  class ModelWriter {
+   private:
+    struct PendingBlock {
+      const void *data;
+      size_t bytes;
+    };
+
+    std::vector<ModelFormat::LayerRecord> layers_;
+    std::vector<ModelFormat::BlockRecord> blocks_;
+    std::vector<PendingBlock> pending_;
+
+    AlignedVector<uint8_t> storage_;
+    std::vector<std::vector<uint8_t>> copies_;
+
+   public:
+
+    //forgets all records, the block storage is kept for the next snapshot
+    void Clear() {
+      layers_.clear();
+      blocks_.clear();
+      pending_.clear();
+      copies_.clear();
+    }
+
+    //snapshots the referenced blocks, after which the layers can change while Write runs
+    void CopyBlocks() {
+      size_t size = 0;
+      for (const auto &block : pending_) {
+        size = ModelFormat::AlignUp(size + block.bytes);
+      }
+      storage_.resize(size);
+
+      size_t offset = 0;
+      for (auto &block : pending_) {
+        std::memcpy(storage_.data() + offset, block.data, block.bytes);
+        block.data = storage_.data() + offset;
+        offset = ModelFormat::AlignUp(offset + block.bytes);
+      }
+    }
+
+    //starts the record of the next layer, attributes and blocks that follow belong to it
+    ModelWriter &Layer(int type, size_t input_size, size_t output_size) {
+      ModelFormat::LayerRecord record{};
+      record.type = static_cast<uint32_t>(type);
+      record.input_size = input_size;
+      record.output_size = output_size;
+      record.first_block = blocks_.size();
+      layers_.push_back(record);
+      return *this;
+    }
+
+    ModelWriter &Attribute(size_t index, double value) {
+      if (index >= ModelFormat::kAttributes) {
+        throw std::runtime_error("Layer attribute index out of range: " + std::to_string(index));
+      }
+      layers_.back().attributes[index] = value;
+      return *this;
+    }
+
+    template<typename T>
+    ModelWriter &Block(const T *data, size_t count) {
+      ModelFormat::BlockRecord record{};
+      record.count = count;
+      record.element = static_cast<uint32_t>(ModelFormat::ElementOf<T>());
+
+      blocks_.push_back(record);
+      pending_.push_back({data, count * sizeof(T)});
+      ++layers_.back().blocks;
+      return *this;
+    }
+
+    //like Block, but copies the values right away, for data that does not outlive the call
+    template<typename T>
+    ModelWriter &BlockCopy(const T *data, size_t count) {
+      const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+      copies_.emplace_back(bytes, bytes + count * sizeof(T));
+      return Block(reinterpret_cast<const T *>(copies_.back().data()), count);
+    }
+
+    void Write(const std::string &filepath, ModelFormat::Element dtype) {
+      std::ofstream os(filepath, std::ios::binary);
+      if (!os.is_open()) {
+        throw std::runtime_error("Failed to open file for writing: " + filepath);
+      }
+
+      Serialize(dtype, [&os](const void *data, size_t bytes) {
+        os.write(static_cast<const char *>(data), std::streamsize(bytes));
+      });
+
+      //the last buffered bytes are only written by the close
+      os.close();
+      if (!os) {
+        throw std::runtime_error("Failed to write model file: " + filepath);
+      }
+    }
+
+    //the bytes Write would write to a file
+    void Write(AlignedVector<uint8_t> &image, ModelFormat::Element dtype) {
+      image.clear();
+      Serialize(dtype, [&image](const void *data, size_t bytes) {
+        image.insert(image.end(), static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + bytes);
+      });
+    }
+
+   private:
+
+    template<typename Output>
+    void Serialize(ModelFormat::Element dtype, Output output) {
+      using namespace ModelFormat;
+
+      const size_t tables_end = sizeof(Header) + layers_.size() * sizeof(LayerRecord)
+          + blocks_.size() * sizeof(BlockRecord);
+
+      size_t offset = AlignUp(tables_end);
+      for (size_t i = 0; i < blocks_.size(); ++i) {
+        blocks_[i].offset = offset;
+        blocks_[i].checksum = Crc32(pending_[i].data, pending_[i].bytes);
+        offset = AlignUp(offset + pending_[i].bytes);
+      }
+
+      Header header{};
+      std::memcpy(header.magic, kMagic, sizeof(kMagic));
+      header.version = kVersion;
+      header.byte_order = kByteOrderMark;
+      header.dtype = static_cast<uint32_t>(dtype);
+      header.layers = layers_.size();
+      header.blocks = blocks_.size();
+      header.data_offset = AlignUp(tables_end);
+      header.file_size = offset;
+      header.table_checksum = Crc32(blocks_.data(), blocks_.size() * sizeof(BlockRecord),
+                                    Crc32(layers_.data(), layers_.size() * sizeof(LayerRecord)));
+      header.header_checksum = Crc32(&header, offsetof(Header, header_checksum));
+
+      output(&header, sizeof(header));
+      output(layers_.data(), layers_.size() * sizeof(LayerRecord));
+      output(blocks_.data(), blocks_.size() * sizeof(BlockRecord));
+
+      size_t position = tables_end;
+      const char padding[kAlignment] = {};
+      for (size_t i = 0; i < blocks_.size(); ++i) {
+        output(padding, blocks_[i].offset - position);
+        output(pending_[i].data, pending_[i].bytes);
+        position = blocks_[i].offset + pending_[i].bytes;
+      }
+      output(padding, header.file_size - position);
+    }
+  };
+
+}
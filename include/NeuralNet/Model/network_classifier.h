@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cassert>
+#include <string>
+#include <stdexcept>
+
+#include <NeuralNet/Kernels/select_kernels.h>
+#include <NeuralNet/Model/base_network.h>
+#include <NeuralNet/Model/network_graph.h>
+#include <NeuralNet/Model/graph_passes.h>
+
+namespace NeuralNet {
+
+  //inference for callers that only need the most likely classes. a final softmax, sigmoid or tanh does not change
+  //which outputs are the largest, so it is dropped from the plan together with its exp and normalization, and the
+  //classes are selected straight from the logits in the plan's output buffer without copying them out
+  template<std::floating_point dataType = NNFLOAT>
+  class NetworkClassifier {
+   private:
+    std::shared_ptr<NeuralNetwork<dataType>> network_;
+    NetworkGraph<dataType> graph_;
+    std::shared_ptr<ExecutionPlan<dataType>> plan_;
+
+    std::vector<size_t> classes_;
+
+   public:
+    //with an encoded input_format the batched calls take uint8/int16 inputs
+    explicit NetworkClassifier(const std::shared_ptr<NeuralNetwork<dataType>> &network, size_t max_batch_size = 1,
+                               const InputFormat<dataType> &input_format = {})
+        : network_(network), graph_(*network, input_format) {
+      GraphPasses::DropMonotonicOutput(graph_);
+      GraphPasses::Optimize(graph_);
+      plan_ = Compile(graph_, max_batch_size);
+    }
+
+    [[nodiscard]] const std::shared_ptr<ExecutionPlan<dataType>> &Plan() const {
+      return plan_;
+    }
+
+    [[nodiscard]] size_t ClassesSize() const {
+      return network_->OutputSize();
+    }
+
+    //most likely class of a single sample
+    size_t operator()(const std::vector<dataType> &input) {
+      assert(input.size() == network_->InputSize());
+      return TopK(input.data(), 1, 1)[0];
+    }
+
+    //batch_size x k classes, the most likely first in every row, valid until the next call
+    const size_t *TopK(const dataType *inputs, size_t batch_size, size_t k) {
+      return Select(plan_->Forward(inputs, batch_size), batch_size, k);
+    }
+
+    template<typename Element>
+    requires (!std::floating_point<Element>)
+    const size_t *TopK(const Element *inputs, size_t batch_size, size_t k) {
+      return Select(plan_->Forward(inputs, batch_size), batch_size, k);
+    }
+
+    //the largest class of every sample
+    template<typename Element>
+    const size_t *Argmax(const Element *inputs, size_t batch_size) {
+      return TopK(inputs, batch_size, 1);
+    }
+
+    //values the classes of the last call were selected from, the logits when the final activation was dropped
+    [[nodiscard]] const dataType *Scores() const {
+      return plan_->Outputs();
+    }
+
+   private:
+    const size_t *Select(const dataType *scores, size_t batch_size, size_t k) {
+      if (k == 0 || k > ClassesSize()) {
+        throw std::runtime_error("Cannot select the top " + std::to_string(k) + " of " + std::to_string(ClassesSize())
+                                     + " classes");
+      }
+
+      classes_.resize(batch_size * k);
+      Kernels::TopKRows(scores, batch_size, ClassesSize(), k, classes_.data());
+      return classes_.data();
+    }
+  };
+
+}
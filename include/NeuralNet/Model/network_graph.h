@@ -0,0 +1,230 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <NeuralNet/misc/input_format.h>
+#include <NeuralNet/Layers/base_layer.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/base_network.h>
+#include <NeuralNet/Model/execution_plan.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType>
+  struct GraphNode {
+    //reads the graph inputs instead of the outputs of another node
+    static constexpr size_t kGraphInputs = SIZE_MAX;
+
+    std::shared_ptr<const BaseLayer<dataType>> layer;
+
+    //applied to the outputs of layer within the same step, see GraphPasses::FuseActivations
+    std::shared_ptr<const BaseLayer<dataType>> activation;
+
+    size_t input = kGraphInputs;
+  };
+
+  //data flow graph of a network for inference. every node is a layer reading the outputs of another node or the
+  //graph inputs, the passes in GraphPasses rewrite it by adding nodes and pointing the readers of old ones at them.
+  //nodes whose outputs no longer reach the output are dead, they are skipped and dropped by RemoveDeadNodes.
+  //the layers are shared with the network the graph was built from and never modified, passes changing weights
+  //create new layers. like a network, the graph has to outlive the plans compiled from it
+  template<std::floating_point dataType = NNFLOAT>
+  class NetworkGraph {
+   private:
+    std::vector<GraphNode<dataType>> nodes_;
+    size_t output_ = GraphNode<dataType>::kGraphInputs;
+    size_t input_size_;
+    InputFormat<dataType> input_format_;
+
+   public:
+
+    //input_format describes how the inputs passed to the compiled plans are stored, passes may fold its scale and
+    //offset into the first layer
+    explicit NetworkGraph(const NeuralNetwork<dataType> &network, const InputFormat<dataType> &input_format = {})
+        : input_size_(network.InputSize()), input_format_(input_format) {
+      if (network.LayersSize() == 0) {
+        throw std::runtime_error("Cannot build a graph of an empty network");
+      }
+
+      for (size_t i = 0; i < network.LayersSize(); ++i) {
+        output_ = AddNode({network.LayerAt(i), nullptr, output_});
+      }
+    }
+
+    [[nodiscard]] size_t InputSize() const {
+      return input_size_;
+    }
+
+    [[nodiscard]] size_t OutputSize() const {
+      return nodes_[output_].layer->OutputSize();
+    }
+
+    [[nodiscard]] const InputFormat<dataType> &Format() const {
+      return input_format_;
+    }
+
+    void SetFormat(const InputFormat<dataType> &input_format) {
+      input_format_ = input_format;
+    }
+
+    [[nodiscard]] size_t NodesSize() const {
+      return nodes_.size();
+    }
+
+    [[nodiscard]] const GraphNode<dataType> &NodeAt(size_t index) const {
+      return nodes_[index];
+    }
+
+    [[nodiscard]] GraphNode<dataType> &NodeAt(size_t index) {
+      return nodes_[index];
+    }
+
+    //node whose outputs are the graph outputs
+    [[nodiscard]] size_t Output() const {
+      return output_;
+    }
+
+    //the node reading input, layer has to take as many inputs as input provides
+    size_t AddNode(const GraphNode<dataType> &node) {
+      const size_t provided = node.input == GraphNode<dataType>::kGraphInputs ? input_size_
+                                                                              : nodes_[node.input].layer->OutputSize();
+      if (node.layer->InputSize() != provided) {
+        throw std::runtime_error("Layer " + std::to_string(node.layer->LayerID()) + " expects "
+                                     + std::to_string(node.layer->InputSize()) + " inputs but receives "
+                                     + std::to_string(provided));
+      }
+      if (node.activation && node.activation->InputSize() != node.layer->OutputSize()) {
+        throw std::runtime_error("Fused activation does not match the outputs of layer "
+                                     + std::to_string(node.layer->LayerID()));
+      }
+
+      nodes_.push_back(node);
+      return nodes_.size() - 1;
+    }
+
+    //points every live reader of node, and the output, at replacement, which has to produce as many values
+    void Replace(size_t node, size_t replacement) {
+      for (size_t i : Schedule()) {
+        if (nodes_[i].input == node) {
+          nodes_[i].input = replacement;
+        }
+      }
+      if (output_ == node) {
+        output_ = replacement;
+      }
+    }
+
+    //live nodes reading the outputs of node
+    [[nodiscard]] std::vector<size_t> Readers(size_t node) const {
+      std::vector<size_t> readers;
+      for (size_t i : Schedule()) {
+        if (nodes_[i].input == node) {
+          readers.push_back(i);
+        }
+      }
+      return readers;
+    }
+
+    //the live nodes in the order they run, from the one reading the graph inputs to the output
+    [[nodiscard]] std::vector<size_t> Schedule() const {
+      std::vector<size_t> order;
+      for (size_t i = output_; i != GraphNode<dataType>::kGraphInputs; i = nodes_[i].input) {
+        order.push_back(i);
+      }
+      std::reverse(order.begin(), order.end());
+      return order;
+    }
+
+    //drops the dead nodes and renumbers the live ones in the order they run, returns how many were dropped
+    size_t RemoveDeadNodes() {
+      const std::vector<size_t> order = Schedule();
+      const size_t dead = nodes_.size() - order.size();
+
+      std::vector<GraphNode<dataType>> live;
+      live.reserve(order.size());
+      for (size_t i = 0; i < order.size(); ++i) {
+        live.push_back(nodes_[order[i]]);
+        live.back().input = i == 0 ? GraphNode<dataType>::kGraphInputs : i - 1;
+      }
+
+      nodes_ = std::move(live);
+      output_ = nodes_.size() - 1;
+      return dead;
+    }
+
+    //network of the live layers, fused activations become layers of their own again. the graph input format is
+    //not part of it
+    [[nodiscard]] std::shared_ptr<NeuralNetwork<dataType>> ToNetwork() const {
+      ModelWriter writer;
+      for (size_t i : Schedule()) {
+        nodes_[i].layer->Save(writer);
+        if (nodes_[i].activation) {
+          nodes_[i].activation->Save(writer);
+        }
+      }
+
+      return Load<dataType>(writer, "graph network");
+    }
+
+    void Print(std::ostream &os = std::cout) const {
+      os << "NetworkGraph: " << input_size_ << " inputs";
+      if (input_format_.Encoded()) {
+        os << ", " << InputElementName(input_format_.element) << " * " << input_format_.scale << " + "
+           << input_format_.offset;
+      }
+      os << std::endl;
+
+      for (size_t i : Schedule()) {
+        os << "  %" << i << " = ";
+        nodes_[i].layer->Print(os, false);
+        if (nodes_[i].activation) {
+          os << "    fused ";
+          nodes_[i].activation->Print(os, false);
+        }
+      }
+    }
+  };
+
+  //inference plan running the live nodes of graph, a node with a fused activation is a single step
+  template<std::floating_point dataType>
+  std::shared_ptr<ExecutionPlan<dataType>> Compile(const NetworkGraph<dataType> &graph, size_t max_batch_size,
+                                                   Kernels::ISA isa = Kernels::DetectISA()) {
+    if (max_batch_size == 0) {
+      throw std::runtime_error("Cannot compile a network for batch size 0");
+    }
+
+    const InputFormat<dataType> &input_format = graph.Format();
+    std::vector<PlanStep<dataType>> steps;
+
+    for (size_t i : graph.Schedule()) {
+      const GraphNode<dataType> &node = graph.NodeAt(i);
+
+      if (steps.empty() && input_format.Encoded()) {
+        if (!node.layer->AcceptsEncodedInput()) {
+          throw std::runtime_error("Layer " + std::to_string(node.layer->LayerID()) + " cannot take "
+                                       + InputElementName(input_format.element) + " inputs");
+        }
+        steps.push_back(node.layer->LowerEncodedInput(max_batch_size, isa, input_format));
+      } else {
+        steps.push_back(node.layer->Lower(max_batch_size, isa));
+      }
+
+      if (node.activation) {
+        if (steps.back().native_buffers) {
+          throw std::runtime_error("Layer " + std::to_string(node.layer->LayerID())
+                                       + " does not output values an activation can be fused into");
+        }
+        steps.back() = FuseSteps(steps.back(), node.activation->Lower(max_batch_size, isa));
+      }
+    }
+
+    return std::make_shared<ExecutionPlan<dataType>>(std::move(steps), max_batch_size, false, isa, input_format);
+  }
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+
+#include <NeuralNet/misc/half.h>
+#include <NeuralNet/misc/types.h>
+#include <NeuralNet/misc/mapped_file.h>
+#include <NeuralNet/misc/input_format.h>
+
+namespace NeuralNet {
+
+  template<std::floating_point dataType>
+  class BaseLayer;
+
+  //one layer lowered to plain kernel function pointers, produced by BaseLayer::Lower when a plan is compiled
+  template<std::floating_point dataType>
+  struct PlanStep {
+    //for the first step of a plan compiled for an encoded InputFormat, inputs points to the encoded values
+    typedef void (*ForwardKernel)(const PlanStep &step, const dataType *inputs, dataType *outputs, size_t batch_size);
+
+    //prev_deltas is null for the first layer, grad_parameters is null for layers without parameters
+    typedef void (*BackwardKernel)(const PlanStep &step, const dataType *inputs, const dataType *outputs,
+                                   const dataType *deltas, dataType *prev_deltas, dataType *grad_parameters,
+                                   size_t batch_size);
+
+    //forward from 16 bit inputs with the weights converted to the same precision by the plan, accumulates in float
+    typedef void (*HalfForwardKernel)(const PlanStep &step, const uint16_t *inputs, const uint16_t *weights,
+                                      dataType *outputs, size_t batch_size);
+
+    const BaseLayer<dataType> *layer = nullptr;
+
+    ForwardKernel forward = nullptr;
+    BackwardKernel backward = nullptr;
+    const char *kernel_name = "";
+
+    size_t input_size = 0;
+    size_t output_size = 0;
+
+    const dataType *parameters = nullptr;
+    size_t parameters_size = 0;
+
+    //the model file the parameters of the step are used in place from, so they stay mapped after the layer copies
+    //them out of it, see FullyConnectedLayer::Parameters
+    std::shared_ptr<const MappedFile> mapping;
+
+    InputFormat<dataType> input_format;
+
+    //set by layers that can multiply bfloat16 inputs and weights directly, see ExecutionPlan
+    HalfForwardKernel half_forward = nullptr;
+    const char *half_kernel_name = "";
+
+    //the kernels pass something other than dataType values through the buffers around the step, e.g. int8 codes,
+    //so they are never stored in half precision
+    bool native_buffers = false;
+
+    //how the inputs and outputs of the step are stored between layers, filled in by Compile
+    Precision input_precision = Precision::Native;
+    Precision output_precision = Precision::Native;
+
+    //set on a step with an activation fused into it, forward runs fused_layer and then fused_activation in place
+    //on tiles of rows that are still in cache, see FuseSteps
+    std::shared_ptr<const PlanStep> fused_layer;
+    std::shared_ptr<const PlanStep> fused_activation;
+  };
+
+}
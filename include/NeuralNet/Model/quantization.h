@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Data/base_dataset.h>
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/quantized_fully_connected_layer.h>
+#include <NeuralNet/Layers/Activations/relu_activation.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/base_network.h>
+#include <NeuralNet/Model/execution_plan.h>
+
+namespace NeuralNet {
+
+  //int8 inference network from a trained one. every FullyConnectedLayer becomes a QuantizedFullyConnectedLayer
+  //that a following ReLU is fused into, the scale of its inputs is calibrated as the largest absolute input seen
+  //over the first calibration_samples samples of calibration. consecutive quantized layers pass int8 codes, the
+  //other layers keep computing in dataType
+  template<std::floating_point dataType>
+  std::shared_ptr<NeuralNetwork<dataType>> Quantize(const std::shared_ptr<NeuralNetwork<dataType>> &network,
+                                                    const BaseDataset<dataType> &calibration,
+                                                    size_t calibration_samples = 1024) {
+    constexpr size_t kCalibrationBatchSize = 256;
+
+    const size_t layers_size = network->LayersSize();
+    const size_t input_size = network->InputSize();
+    const size_t samples = std::min(calibration.Size(), calibration_samples);
+
+    if (samples == 0) {
+      throw std::runtime_error("Quantization needs calibration samples");
+    }
+    if (calibration.InputSize() != input_size) {
+      throw std::runtime_error("Calibration samples have " + std::to_string(calibration.InputSize())
+                                   + " inputs but the network expects " + std::to_string(input_size));
+    }
+
+    const auto plan = Compile(std::shared_ptr<const NeuralNetwork<dataType>>(network),
+                              std::min(kCalibrationBatchSize, samples));
+    AlignedVector<dataType> inputs(plan->MaxBatchSize() * input_size);
+    std::vector<size_t> indices(plan->MaxBatchSize());
+
+    //largest absolute input of every fully connected layer
+    std::vector<dataType> ranges(layers_size, 0);
+
+    for (size_t start = 0; start < samples; start += plan->MaxBatchSize()) {
+      const size_t count = std::min(plan->MaxBatchSize(), samples - start);
+      std::iota(indices.begin(), indices.begin() + count, start);
+
+      calibration.Gather(indices.data(), count, inputs.data(), nullptr);
+      plan->Forward(inputs.data(), count);
+
+      for (size_t i = 0; i < layers_size; ++i) {
+        if (std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(network->LayerAt(i))) {
+          const dataType *layer_inputs = i == 0 ? inputs.data() : plan->Outputs(i - 1);
+          for (size_t k = 0; k < count * network->LayerAt(i)->InputSize(); ++k) {
+            ranges[i] = std::max(ranges[i], std::abs(layer_inputs[k]));
+          }
+        }
+      }
+    }
+
+    const auto scale = [&ranges](size_t layer) { return ranges[layer] > 0 ? ranges[layer] / 127 : dataType(1); };
+
+    ModelWriter writer;
+    std::vector<std::unique_ptr<QuantizedFullyConnectedLayer<dataType>>> quantized;
+    bool int8_inputs = false;
+
+    for (size_t i = 0; i < layers_size; ++i) {
+      const auto layer = network->LayerAt(i);
+      const auto dense = std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(layer);
+      if (!dense) {
+        layer->Save(writer);
+        int8_inputs = false;
+        continue;
+      }
+
+      const bool relu = i + 1 < layers_size
+          && std::dynamic_pointer_cast<ReLuActivation<dataType>>(network->LayerAt(i + 1));
+      const size_t next = i + (relu ? 2 : 1);
+      const bool int8_outputs = next < layers_size
+          && std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(network->LayerAt(next));
+
+      quantized.push_back(std::make_unique<QuantizedFullyConnectedLayer<dataType>>(
+          dense->InputSize(), dense->OutputSize(), dense->WeightsBiases(), scale(i),
+          int8_outputs ? scale(next) : dataType(0), relu, int8_inputs));
+      quantized.back()->Save(writer);
+
+      int8_inputs = int8_outputs;
+      if (relu) {
+        ++i;
+      }
+    }
+
+    return Load<dataType>(writer, "quantized network");
+  }
+
+}
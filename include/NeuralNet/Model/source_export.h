@@ -0,0 +1,249 @@
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cctype>
+#include <ostream>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <iomanip>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <NeuralNet/misc/half.h>
+#include <NeuralNet/Kernels/half_kernels.h>
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/half_fully_connected_layer.h>
+#include <NeuralNet/Layers/codebook_fully_connected_layer.h>
+#include <NeuralNet/Layers/Activations/relu_activation.h>
+#include <NeuralNet/Layers/Activations/leaky_relu_activation.h>
+#include <NeuralNet/Layers/Activations/sigmoid_activation.h>
+#include <NeuralNet/Layers/Activations/softmax_activation.h>
+#include <NeuralNet/Layers/Activations/tanh_activation.h>
+#include <NeuralNet/Model/base_network.h>
+
+namespace NeuralNet {
+
+  namespace SourceExport {
+
+    //layers with at most this many weights are written as one statement per output, larger ones as loops with
+    //constant bounds
+    constexpr size_t kUnrollLimit = 4096;
+
+    inline bool IsIdentifier(const std::string &name) {
+      if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+        return false;
+      }
+      return std::all_of(name.begin(), name.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+      });
+    }
+
+    //dense output_size x input_size weights followed by the biases of the fully connected layer kinds whose
+    //weights can be expanded, nothing for other layers
+    template<std::floating_point dataType>
+    std::optional<std::vector<dataType>> DenseWeightsBiases(const BaseLayer<dataType> &layer) {
+      const size_t size = layer.InputSize() * layer.OutputSize();
+
+      if (const auto dense = dynamic_cast<const FullyConnectedLayer<dataType> *>(&layer)) {
+        return std::vector<dataType>(dense->WeightsBiases(), dense->WeightsBiases() + size + layer.OutputSize());
+      }
+      if (const auto codebook = dynamic_cast<const CodebookFullyConnectedLayer<dataType> *>(&layer)) {
+        return codebook->DecodedWeightsBiases();
+      }
+      if (const auto half = dynamic_cast<const HalfFullyConnectedLayer<dataType> *>(&layer)) {
+        std::vector<dataType> weights_biases(size + layer.OutputSize());
+        Kernels::FromHalf(half->WeightPrecision(), half->Weights(), weights_biases.data(), size);
+        std::copy(half->Biases(), half->Biases() + layer.OutputSize(), weights_biases.begin() + size);
+        return weights_biases;
+      }
+      return std::nullopt;
+    }
+
+    //writes statement(index) for every index below size, unrolled or as a loop
+    inline void Elementwise(std::ostream &os, size_t size, bool unrolled,
+                            const std::function<std::string(const std::string &)> &statement) {
+      if (unrolled) {
+        for (size_t i = 0; i < size; ++i) {
+          os << "    " << statement(std::to_string(i)) << "\n";
+        }
+      } else {
+        os << "    for (std::size_t i = 0; i < " << size << "; ++i) {\n"
+           << "      " << statement("i") << "\n"
+           << "    }\n";
+      }
+    }
+
+  }
+
+  //writes network as a self-contained C++ header that needs nothing but the standard <cmath>: the weights are
+  //alignas(64) constexpr arrays and namespace_name::Forward(input, output) computes one sample with every layer
+  //size fixed at compile time, no virtual calls and no allocations. layers up to unroll_limit weights are fully
+  //unrolled. fully connected layers stored as fp16/bf16 or as a codebook are expanded to dataType weights, other
+  //layer kinds cannot be exported
+  template<std::floating_point dataType>
+  void ExportSource(const NeuralNetwork<dataType> &network, std::ostream &os, const std::string &namespace_name,
+                    size_t unroll_limit = SourceExport::kUnrollLimit) {
+    using namespace SourceExport;
+
+    if (!IsIdentifier(namespace_name)) {
+      throw std::runtime_error("Exported namespace '" + namespace_name + "' is not a C++ identifier");
+    }
+    if (network.LayersSize() == 0) {
+      throw std::runtime_error("Cannot export an empty network");
+    }
+
+    const std::string type = std::is_same_v<dataType, float> ? "float" : "double";
+    const std::string suffix = std::is_same_v<dataType, float> ? "f" : "";
+
+    auto literal = [&](dataType value) {
+      if (!std::isfinite(value)) {
+        throw std::runtime_error("Cannot export a network with non finite parameters");
+      }
+      std::ostringstream s;
+      s << std::setprecision(std::numeric_limits<dataType>::max_digits10) << value;
+      std::string text = s.str();
+      if (text.find_first_of(".e") == std::string::npos) {
+        text += ".0";
+      }
+      return text + suffix;
+    };
+
+    std::ostringstream arrays;
+    std::ostringstream body;
+    bool uses_math = false;
+
+    //buffer the layer i reads from and the one it writes to, the last layer writes the output
+    auto source = [](size_t i) {
+      return i == 0 ? std::string("input") : "x" + std::to_string(i);
+    };
+    auto target = [&](size_t i) {
+      return i + 1 == network.LayersSize() ? std::string("output") : "x" + std::to_string(i + 1);
+    };
+
+    for (size_t i = 0; i < network.LayersSize(); ++i) {
+      const auto &layer = *network.LayerAt(i);
+      const size_t input_size = layer.InputSize();
+      const size_t output_size = layer.OutputSize();
+      const std::string in = source(i);
+      const std::string out = target(i);
+
+      if (i + 1 < network.LayersSize()) {
+        body << "    alignas(64) " << type << " " << out << "[" << output_size << "];\n";
+      }
+
+      if (const auto weights_biases = DenseWeightsBiases(layer)) {
+        const std::string weights = "kWeights" + std::to_string(i);
+        const std::string biases = "kBiases" + std::to_string(i);
+
+        arrays << "  alignas(64) inline constexpr " << type << " " << weights << "[" << input_size * output_size
+               << "] = {";
+        for (size_t k = 0; k < input_size * output_size; ++k) {
+          arrays << (k % 8 == 0 ? "\n      " : " ") << literal((*weights_biases)[k]) << ",";
+        }
+        arrays << "\n  };\n";
+        arrays << "  alignas(64) inline constexpr " << type << " " << biases << "[" << output_size << "] = {";
+        for (size_t k = 0; k < output_size; ++k) {
+          arrays << (k % 8 == 0 ? "\n      " : " ") << literal((*weights_biases)[input_size * output_size + k]) << ",";
+        }
+        arrays << "\n  };\n\n";
+
+        if (input_size * output_size <= unroll_limit) {
+          for (size_t j = 0; j < output_size; ++j) {
+            body << "    " << out << "[" << j << "] = " << biases << "[" << j << "]";
+            for (size_t k = 0; k < input_size; ++k) {
+              body << "\n        + " << weights << "[" << j * input_size + k << "] * " << in << "[" << k << "]";
+            }
+            body << ";\n";
+          }
+        } else {
+          body << "    for (std::size_t j = 0; j < " << output_size << "; ++j) {\n"
+               << "      " << type << " sum = " << biases << "[j];\n"
+               << "      for (std::size_t k = 0; k < " << input_size << "; ++k) {\n"
+               << "        sum += " << weights << "[j * " << input_size << " + k] * " << in << "[k];\n"
+               << "      }\n"
+               << "      " << out << "[j] = sum;\n"
+               << "    }\n";
+        }
+        continue;
+      }
+
+      const bool unrolled = output_size <= unroll_limit;
+      if (dynamic_cast<const ReLuActivation<dataType> *>(&layer)) {
+        Elementwise(body, output_size, unrolled, [&](const std::string &k) {
+          return out + "[" + k + "] = " + in + "[" + k + "] > 0 ? " + in + "[" + k + "] : " + literal(0) + ";";
+        });
+      } else if (const auto leaky = dynamic_cast<const LeakyReLuActivation<dataType> *>(&layer)) {
+        const std::string alpha = literal(leaky->Alpha());
+        Elementwise(body, output_size, unrolled, [&](const std::string &k) {
+          return out + "[" + k + "] = " + in + "[" + k + "] > 0 ? " + in + "[" + k + "] : " + alpha + " * " + in + "["
+              + k + "];";
+        });
+      } else if (dynamic_cast<const SigmoidActivation<dataType> *>(&layer)) {
+        uses_math = true;
+        Elementwise(body, output_size, unrolled, [&](const std::string &k) {
+          return out + "[" + k + "] = " + literal(1) + " / (" + literal(1) + " + std::exp(-" + in + "[" + k + "]));";
+        });
+      } else if (dynamic_cast<const TanhActivation<dataType> *>(&layer)) {
+        uses_math = true;
+        Elementwise(body, output_size, unrolled, [&](const std::string &k) {
+          return out + "[" + k + "] = std::tanh(" + in + "[" + k + "]);";
+        });
+      } else if (dynamic_cast<const SoftmaxActivation<dataType> *>(&layer)) {
+        uses_math = true;
+        const std::string sum = "sum" + std::to_string(i);
+        body << "    " << type << " " << sum << " = 0;\n";
+        Elementwise(body, output_size, unrolled, [&](const std::string &k) {
+          return out + "[" + k + "] = std::exp(" + in + "[" + k + "]); " + sum + " += " + out + "[" + k + "];";
+        });
+        Elementwise(body, output_size, unrolled, [&](const std::string &k) {
+          return out + "[" + k + "] /= " + sum + ";";
+        });
+      } else {
+        throw std::runtime_error("Layer " + std::to_string(layer.LayerID()) + " cannot be exported as source");
+      }
+    }
+
+    os << "#pragma once\n\n"
+       << "//generated by NeuralNet ExportSource, " << network.InputSize() << " inputs -> " << network.OutputSize()
+       << " outputs in " << network.LayersSize() << " layers\n\n";
+    if (uses_math) {
+      os << "#include <cmath>\n";
+    }
+    os << "#include <cstddef>\n\n"
+       << "namespace " << namespace_name << " {\n\n"
+       << "  inline constexpr std::size_t kInputSize = " << network.InputSize() << ";\n"
+       << "  inline constexpr std::size_t kOutputSize = " << network.OutputSize() << ";\n\n"
+       << arrays.str()
+       << "  //input holds kInputSize values, output receives kOutputSize\n"
+       << "  inline void Forward(const " << type << " *input, " << type << " *output) {\n"
+       << body.str()
+       << "  }\n\n"
+       << "}\n";
+  }
+
+  template<std::floating_point dataType>
+  void ExportSource(const NeuralNetwork<dataType> &network, const std::string &filepath,
+                    const std::string &namespace_name, size_t unroll_limit = SourceExport::kUnrollLimit) {
+    std::ostringstream source;
+    ExportSource(network, source, namespace_name, unroll_limit);
+
+    std::ofstream os(filepath);
+    os << source.str();
+    //the last buffered characters are only written by the close. a short header is removed, so a build rule does
+    //not compile it
+    os.close();
+    if (!os) {
+      std::error_code ignored;
+      std::filesystem::remove(filepath, ignored);
+      throw std::runtime_error("Failed to write exported source: " + filepath);
+    }
+  }
+
+}
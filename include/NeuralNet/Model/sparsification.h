@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <algorithm>
+
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/sparse_fully_connected_layer.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/base_network.h>
+
+namespace NeuralNet {
+
+  //inference network from a pruned one, see MagnitudePruner. every FullyConnectedLayer with at least min_sparsity of
+  //its weights zero becomes a SparseFullyConnectedLayer, denser ones run faster with the dense kernels and are kept
+  template<std::floating_point dataType>
+  std::shared_ptr<NeuralNetwork<dataType>> Sparsify(const std::shared_ptr<NeuralNetwork<dataType>> &network,
+                                                    double min_sparsity = 0.5) {
+    ModelWriter writer;
+    std::vector<std::unique_ptr<SparseFullyConnectedLayer<dataType>>> sparse;
+
+    for (size_t i = 0; i < network->LayersSize(); ++i) {
+      const auto layer = network->LayerAt(i);
+      const auto dense = std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(layer);
+      if (!dense) {
+        layer->Save(writer);
+        continue;
+      }
+
+      const size_t weights_size = dense->InputSize() * dense->OutputSize();
+      const dataType *weights = dense->WeightsBiases();
+      const size_t zeros = std::count(weights, weights + weights_size, dataType(0));
+
+      if (static_cast<double>(zeros) < min_sparsity * static_cast<double>(weights_size)) {
+        layer->Save(writer);
+        continue;
+      }
+
+      sparse.push_back(std::make_unique<SparseFullyConnectedLayer<dataType>>(dense->InputSize(), dense->OutputSize(),
+                                                                             weights));
+      sparse.back()->Save(writer);
+    }
+
+    return Load<dataType>(writer, "sparse network");
+  }
+
+}
@@ -3,12 +3,24 @@
 #include <memory>
 #include <vector>
 #include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <cmath>
+#include <cstdint>
 #include <functional>
 
 #include <NeuralNet/Model/inference_network.h>
+#include <NeuralNet/Model/checkpoint_writer.h>
 #include <NeuralNet/Optimizers/base_optimizer.h>
+#include <NeuralNet/Pruning/magnitude_pruner.h>
 #include <NeuralNet/CostFunctions/base_cost.h>
 #include <NeuralNet/Initializers/base_initializer.h>
+#include <NeuralNet/Data/dataset.h>
+#include <NeuralNet/Data/base_stream_dataset.h>
+#include <NeuralNet/Data/batch_prefetcher.h>
+#include <NeuralNet/Data/Augmentations/base_augmentation.h>
+#include <NeuralNet/Data/Samplers/shuffle_sampler.h>
+#include <NeuralNet/Data/Samplers/sequential_sampler.h>
 
 namespace NeuralNet::Training {
 
@@ -21,20 +33,49 @@ namespace NeuralNet::Training {
     std::vector<std::shared_ptr<BaseLogger<dataType>>> loggers_;
 
    private:
-    std::vector<std::vector<std::vector<dataType>>> train_outputs_storage_;
-    std::vector<std::vector<std::vector<dataType> *>> train_outputs_;
+    std::shared_ptr<ExecutionPlan<dataType>> train_plan_;
 
-    std::vector<std::vector<std::vector<dataType>>> deltas_;
+    AlignedVector<dataType> batch_inputs_;
+    AlignedVector<dataType> batch_targets_;
+    std::vector<uint32_t> batch_labels_;
+    size_t batch_size_ = 0;
 
-    std::vector<std::vector<dataType>> input_deltas_;
+    //rows of the batch currently training, either the batch_ buffers or a prefetched batch,
+    //current_labels_ is set instead of current_targets_ when the dataset has class labels
+    const void *current_inputs_ = nullptr;
+    const dataType *current_targets_ = nullptr;
+    const uint32_t *current_labels_ = nullptr;
 
-    std::vector<std::vector<dataType> *> train_inputs_;
-    std::vector<std::vector<dataType> *> target_outputs_;
+    std::unique_ptr<BatchPrefetcher<dataType>> prefetcher_;
+    size_t loader_threads_ = 1;
 
-    std::vector<std::vector<dataType>> grad_weights_;
+    std::vector<std::shared_ptr<BaseAugmentation<dataType>>> augmentations_;
+    std::mt19937 augmentation_gen_;
 
-    std::vector<std::vector<NNFLOAT>> test_inputs_;
-    std::vector<std::vector<NNFLOAT>> test_target_outputs;
+    std::unique_ptr<CheckpointWriter> checkpoint_writer_;
+
+    std::shared_ptr<MagnitudePruner<dataType>> pruner_;
+
+    Precision precision_ = Precision::Native;
+
+    //dynamic loss scaling of fp16 training, the scale is halved and the update skipped when a gradient
+    //overflows and doubled after kLossScaleInterval updates in a row that did not
+    static constexpr dataType kInitialLossScale = 65536;
+    static constexpr long long kLossScaleInterval = 2000;
+    dataType loss_scale_ = 1;
+    long long loss_scale_good_steps_ = 0;
+
+    std::vector<size_t> epoch_indices_;
+    std::shared_ptr<ShuffleSampler> shuffle_sampler_ = std::make_shared<ShuffleSampler>();
+    std::shared_ptr<SequentialSampler> sequential_sampler_ = std::make_shared<SequentialSampler>();
+
+    std::shared_ptr<const BaseDataset<dataType>> test_dataset_;
+    std::shared_ptr<ExecutionPlan<dataType>> test_plan_;
+    AlignedVector<dataType> test_inputs_;
+    AlignedVector<dataType> test_targets_;
+    std::vector<uint32_t> test_labels_;
+
+    static constexpr size_t kTestBatchSize = 256;
 
     long long training_iterations_ = 0;
 
@@ -54,7 +95,7 @@ namespace NeuralNet::Training {
                     std::mt19937 &gen,
                     const std::vector<std::shared_ptr<BaseLogger<dataType>>> &loggers = {},
                     bool initialize_weights = true) :
-        NetworkInference<dataType>(network),
+        NetworkInference<dataType>(OwnedParameters(network)),
         optimizer_(optimizer),
         cost_function_(cost_function),
         initializers_(initializers),
@@ -88,23 +129,279 @@ namespace NeuralNet::Training {
       return loggers_;
     }
 
+    //number of batches assembled on a background thread ahead of the training one during TrainEpoch, 0 disables
+    void SetPrefetchDepth(size_t depth) {
+      if (depth == 0) {
+        prefetcher_.reset();
+      } else if (!prefetcher_ || prefetcher_->Depth() != depth) {
+        prefetcher_ = std::make_unique<BatchPrefetcher<dataType>>(depth);
+      }
+    }
+
+    [[nodiscard]] size_t PrefetchDepth() const {
+      return prefetcher_ ? prefetcher_->Depth() : 0;
+    }
+
+    //number of threads gathering and augmenting prefetched batches, limited by the prefetch depth,
+    //stream datasets are always read by a single thread
+    void SetLoaderThreads(size_t threads) {
+      assert(threads != 0);
+      loader_threads_ = threads;
+    }
+
+    [[nodiscard]] size_t LoaderThreads() const {
+      return loader_threads_;
+    }
+
+    //applied in order to every training batch after it is gathered, on the loader threads when prefetching,
+    //datasets with encoded inputs are gathered as dataType rows while augmentations are set
+    void SetAugmentations(const std::vector<std::shared_ptr<BaseAugmentation<dataType>>> &augmentations) {
+      augmentations_ = augmentations;
+    }
+
+    [[nodiscard]] const std::vector<std::shared_ptr<BaseAugmentation<dataType>>> &Augmentations() const {
+      return augmentations_;
+    }
+
+    //prunes the fully connected layers on the pruner's schedule after every parameter update, null disables
+    void SetPruner(const std::shared_ptr<MagnitudePruner<dataType>> &pruner) {
+      pruner_ = pruner;
+    }
+
+    [[nodiscard]] const std::shared_ptr<MagnitudePruner<dataType>> &Pruner() const {
+      return pruner_;
+    }
+
+    //stores the activations and deltas between the layers of the train plan in bfloat16 or fp16, halving their
+    //memory and bandwidth. the parameters, gradients and optimizer state stay dataType and the kernels compute in
+    //dataType, fp16 training scales the loss dynamically to keep small deltas from flushing to zero
+    void SetActivationPrecision(Precision precision) {
+      precision_ = precision;
+      loss_scale_ = precision == Precision::Float16 ? kInitialLossScale : 1;
+      loss_scale_good_steps_ = 0;
+      train_plan_.reset();
+    }
+
+    [[nodiscard]] Precision ActivationPrecision() const {
+      return precision_;
+    }
+
+    //1 unless training with fp16 activations
+    [[nodiscard]] dataType LossScale() const {
+      return loss_scale_;
+    }
+
+    //copies the parameters and saves them to filepath on a background thread while training continues,
+    //with training_state the file is written as by SaveState, with delta only the chunks changed since the
+    //previous checkpoint are written, see CheckpointWriter::Write
+    void Checkpoint(const std::string &filepath, bool training_state = false, bool delta = false) {
+      if (!checkpoint_writer_) {
+        checkpoint_writer_ = std::make_unique<CheckpointWriter>();
+      }
+      if (training_state) {
+        checkpoint_writer_->Write(filepath, ModelFormat::ElementOf<dataType>(),
+                                  [this](ModelWriter &model) { SaveState(model); }, delta);
+      } else {
+        checkpoint_writer_->Write(*this->network_, filepath, delta);
+      }
+    }
+
+    //blocks until every checkpoint taken so far is on disk
+    void WaitForCheckpoints() {
+      if (checkpoint_writer_) {
+        checkpoint_writer_->Wait();
+      }
+    }
+
+    //saves the network followed by the optimizer state, the iteration counters and last costs, the random
+    //generator, the order of the last epoch and the step and masks of the pruner, so a run resumed with LoadState
+    //between epochs or batches continues exactly as if it had not stopped. the file is a model file, Load reads the
+    //network alone
+    void SaveState(const std::string &filepath) {
+      ModelWriter writer;
+      SaveState(writer);
+      writer.Write(filepath, ModelFormat::ElementOf<dataType>());
+    }
+
+    void SaveState(ModelWriter &writer) {
+      this->network_->Save(writer);
+
+      writer.Layer(ModelFormat::OptimizerState, 0, 0);
+      for (const std::vector<dataType> *buffer : optimizer_->State()) {
+        writer.Block(buffer->data(), buffer->size());
+      }
+
+      const int64_t counters[] = {training_iterations_, last_train_cost_computed_at, last_test_cost_computed_at};
+      const dataType costs[] = {last_train_cost_, last_test_cost_};
+      const dataType loss_scale[] = {loss_scale_};
+      const int64_t loss_scale_good_steps[] = {loss_scale_good_steps_};
+      const std::vector<uint64_t> indices(epoch_indices_.begin(), epoch_indices_.end());
+
+      std::ostringstream gen;
+      gen << gen_;
+      const std::string gen_state = gen.str();
+
+      writer.Layer(ModelFormat::TrainingState, this->network_->InputSize(), this->network_->OutputSize())
+          .BlockCopy(counters, 3)
+          .BlockCopy(costs, 2)
+          .BlockCopy(reinterpret_cast<const uint8_t *>(gen_state.data()), gen_state.size())
+          .BlockCopy(indices.data(), indices.size())
+          .BlockCopy(loss_scale, 1)
+          .BlockCopy(loss_scale_good_steps, 1);
+
+      if (pruner_) {
+        writer.Layer(ModelFormat::PrunerState, 0, 0)
+            .Attribute(0, static_cast<double>(pruner_->Step()))
+            .Attribute(1, pruner_->Sparsity());
+        for (const std::vector<uint8_t> &mask : pruner_->Masks()) {
+          writer.BlockCopy(mask.data(), mask.size());
+        }
+      }
+    }
+
+    //restores a state saved by SaveState for the same network architecture and optimizer, including the
+    //generator passed to the constructor. the whole file is validated before anything is changed
+    void LoadState(const std::string &filepath) {
+      const ModelReader reader(filepath, true);
+      const auto network = Load<dataType>(reader);
+
+      const size_t layers_size = this->network_->LayersSize();
+      if (network->LayersSize() != layers_size) {
+        throw std::runtime_error("Training state does not match the network: " + filepath);
+      }
+
+      for (size_t i = 0; i < layers_size; ++i) {
+        const auto layer = this->network_->LayerAt(i);
+        const auto saved = network->LayerAt(i);
+        if (layer->InputSize() != saved->InputSize() || layer->OutputSize() != saved->OutputSize()
+            || layer->ParametersSize() != saved->ParametersSize() || layer->Trainable() != saved->Trainable()) {
+          throw std::runtime_error("Layer " + std::to_string(i) + " of the training state does not match the network: "
+                                       + filepath);
+        }
+      }
+
+      const std::vector<std::vector<dataType> *> optimizer_state = optimizer_->State();
+      std::vector<std::vector<dataType>> saved_optimizer_state;
+      bool optimizer_found = false;
+
+      int64_t counters[3];
+      dataType costs[2];
+      std::mt19937 gen;
+      std::vector<size_t> indices;
+      dataType loss_scale = loss_scale_;
+      int64_t loss_scale_good_steps = loss_scale_good_steps_;
+      bool training_found = false;
+      size_t pruner_step = 0;
+      double pruner_sparsity = 0;
+      std::vector<std::vector<uint8_t>> pruner_masks;
+      bool pruner_found = false;
+
+      for (size_t i = 0; i < reader.LayersSize(); ++i) {
+        const ModelReader::LayerView record = reader.Layer(i);
+
+        if (record.Type() == ModelFormat::OptimizerState) {
+          if (record.BlocksSize() != optimizer_state.size()) {
+            throw record.Error("optimizer state does not match the optimizer");
+          }
+          for (size_t j = 0; j < optimizer_state.size(); ++j) {
+            saved_optimizer_state.push_back(record.ConvertBlock<dataType>(j, optimizer_state[j]->size()));
+          }
+          optimizer_found = true;
+        } else if (record.Type() == ModelFormat::TrainingState) {
+          std::copy_n(record.Block<int64_t>(0, 3), 3, counters);
+
+          const std::vector<dataType> saved_costs = record.ConvertBlock<dataType>(1, 2);
+          std::copy_n(saved_costs.begin(), 2, costs);
+
+          const char *gen_state = reinterpret_cast<const char *>(record.Block<uint8_t>(2, record.BlockCount(2)));
+          std::istringstream is(std::string(gen_state, record.BlockCount(2)));
+          if (!(is >> gen)) {
+            throw record.Error("invalid random generator state");
+          }
+
+          const uint64_t *saved_indices = record.Block<uint64_t>(3, record.BlockCount(3));
+          indices.assign(saved_indices, saved_indices + record.BlockCount(3));
+          loss_scale = record.ConvertBlock<dataType>(4, 1)[0];
+          loss_scale_good_steps = *record.Block<int64_t>(5, 1);
+          training_found = true;
+        } else if (record.Type() == ModelFormat::PrunerState) {
+          if (record.BlocksSize() != 0 && record.BlocksSize() != layers_size) {
+            throw record.Error("pruning masks do not match the network");
+          }
+          pruner_step = static_cast<size_t>(record.Attribute(0));
+          pruner_sparsity = record.Attribute(1);
+          for (size_t j = 0; j < record.BlocksSize(); ++j) {
+            const size_t count = record.BlockCount(j);
+            const auto layer = std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(this->network_->LayerAt(j));
+            if (count != 0 && (!layer || count != layer->InputSize() * layer->OutputSize())) {
+              throw record.Error("pruning mask " + std::to_string(j) + " does not match its layer");
+            }
+            const uint8_t *mask = record.Block<uint8_t>(j, count);
+            pruner_masks.emplace_back(mask, mask + count);
+          }
+          pruner_found = true;
+        }
+      }
+
+      if (!optimizer_found || !training_found) {
+        throw std::runtime_error("Not a training state file: " + filepath);
+      }
+
+      for (size_t i = 0; i < layers_size; ++i) {
+        const auto layer = this->network_->LayerAt(i);
+        if (layer->Trainable()) {
+          const std::vector<dataType> &parameters =
+              std::static_pointer_cast<BaseTrainableLayer<dataType>>(network->LayerAt(i))->Parameters();
+          std::copy(parameters.begin(), parameters.end(),
+                    std::static_pointer_cast<BaseTrainableLayer<dataType>>(layer)->Parameters().begin());
+        }
+      }
+
+      for (size_t j = 0; j < optimizer_state.size(); ++j) {
+        *optimizer_state[j] = std::move(saved_optimizer_state[j]);
+      }
+
+      training_iterations_ = counters[0];
+      last_train_cost_computed_at = counters[1];
+      last_test_cost_computed_at = counters[2];
+      last_train_cost_ = costs[0];
+      last_test_cost_ = costs[1];
+      gen_ = gen;
+      epoch_indices_ = std::move(indices);
+      loss_scale_ = loss_scale;
+      loss_scale_good_steps_ = loss_scale_good_steps;
+
+      if (pruner_ && pruner_found) {
+        pruner_->Restore(pruner_step, pruner_sparsity, std::move(pruner_masks));
+      }
+    }
+
+    //training modifies the parameters, so they must not be used in place from a loaded model file
+    static const std::shared_ptr<NeuralNetwork<dataType>> &OwnedParameters(
+        const std::shared_ptr<NeuralNetwork<dataType>> &network) {
+      network->OwnParameters();
+      return network;
+    }
+
     void ConstructorHelper(bool initialize_weights) {
       if (initialize_weights) {
         InitializeParameters();
       }
 
       optimizer_->Allocate(this->network_);
+    }
 
-      for (const auto &layer : *this->network_) {
-        grad_weights_.emplace_back(layer->ParametersSize());
-      }
+    void SetTest(const std::vector<std::vector<dataType>> &inputs,
+                 const std::vector<std::vector<dataType>> &outputs) {
+      SetTest(std::make_shared<Dataset<dataType>>(inputs, outputs));
     }
 
-    void SetTest(const std::vector<std::vector<NNFLOAT>> &inputs,
-                 const std::vector<std::vector<NNFLOAT>> &outputs) {
-      assert(inputs.size() == outputs.size());
-      test_inputs_ = inputs;
-      test_target_outputs = outputs;
+    void SetTest(const std::shared_ptr<const BaseDataset<dataType>> &test_dataset) {
+      assert(test_dataset->InputSize() == this->network_->InputSize());
+      assert(test_dataset->TargetSize() == this->network_->OutputSize());
+
+      test_dataset_ = test_dataset;
+      test_plan_.reset();
     }
 
     void InitializeParameters() {
@@ -118,114 +415,127 @@ namespace NeuralNet::Training {
     }
 
     void TrainSample(const std::vector<dataType> &input, const std::vector<dataType> &target_output) {
-      assert(this->network_->LayersSize() != 0);
       assert(input.size() == this->network_->InputSize());
       assert(target_output.size() == this->network_->OutputSize());
 
       AllocateTrainVectors(1);
 
-      train_inputs_[0] = const_cast<std::vector<dataType> *>( &input );
-      target_outputs_[0] = const_cast<std::vector<dataType> *>( &target_output );
+      GatherSample(0, input, target_output);
 
       RunTraining();
 
+      ++training_iterations_;
       for (const auto &logger_ : loggers_) {
-        logger_->Log(this, training_iterations_);
-      }
-      if (!loggers_.empty()) {
-        loggers_[0]->IncreaseIteration();
+        logger_->Log(this);
       }
-      ++training_iterations_;
     }
 
     void TrainBatch(const std::vector<std::vector<dataType>> &inputs,
                     const std::vector<std::vector<dataType>> &target_outputs) {
-      assert(this->network_->LayersSize() != 0);
       assert(!inputs.empty());
       assert(inputs.size() == target_outputs.size());
-      for (const auto &input : inputs) {
-        assert(input.size() == this->network_->InputSize());
-      }
-      for (const auto &output : target_outputs) {
-        assert(output.size() == this->network_->OutputSize());
-      }
 
       const size_t inputs_size = inputs.size();
 
       AllocateTrainVectors(inputs_size);
 
       for (size_t i = 0; i < inputs_size; ++i) {
-        train_inputs_[i] = const_cast<std::vector<dataType> *>( &(inputs[i]));
-        target_outputs_[i] = const_cast<std::vector<dataType> *>( &(target_outputs[i]));
+        GatherSample(i, inputs[i], target_outputs[i]);
       }
 
       RunTraining();
 
+      training_iterations_ += inputs_size;
       for (const auto &logger_ : loggers_) {
         logger_->Log(this);
       }
-      training_iterations_ += inputs_size;
     }
 
     void TrainEpoch(const std::vector<std::vector<dataType>> &inputs,
                     const std::vector<std::vector<dataType>> &target_outputs,
                     size_t batchSize, bool random) {
-      assert(this->network_->LayersSize() != 0);
       assert(!inputs.empty());
       assert(inputs.size() == target_outputs.size());
-      for (const auto &input : inputs) {
-        assert(input.size() == this->network_->InputSize());
-      }
-      for (const auto &output : target_outputs) {
-        assert(output.size() == this->network_->OutputSize());
-      }
 
-      dataType average_cost = 0;
-      const size_t inputs_size = inputs.size();
+      SampleEpoch(inputs.size(), EpochSampler(random));
 
-      AllocateTrainVectors(batchSize);
+      const size_t input_size = this->network_->InputSize();
+      const size_t output_size = this->network_->OutputSize();
 
-      if (inputs_size == batchSize) {
-        TrainBatch(inputs, target_outputs);
-      } else {
-        const size_t iterations = (inputs_size - 1) / batchSize + 1;
-
-        for (size_t i = 0; i < iterations; ++i) {
-          for (size_t j = 0; j < batchSize; ++j) {
-            size_t index;
-            if (random) {
-              index = gen_() % inputs_size;
-            } else {
-              index = (i * batchSize + j) % inputs_size;
-            }
+      RunIndexedEpoch(batchSize, [&](const size_t *indices, size_t count, dataType *batch_inputs, dataType *batch_targets,
+                                     uint32_t *) {
+        for (size_t i = 0; i < count; ++i) {
+          const std::vector<dataType> &input = inputs[indices[i]];
+          const std::vector<dataType> &target_output = target_outputs[indices[i]];
 
-            train_inputs_[j] = const_cast<std::vector<dataType> *>( &(inputs[index]));
-            target_outputs_[j] = const_cast<std::vector<dataType> *>( &(target_outputs[index]));
-          }
+          assert(input.size() == input_size);
+          assert(target_output.size() == output_size);
 
-          RunTraining();
+          std::copy(input.begin(), input.end(), batch_inputs + i * input_size);
+          std::copy(target_output.begin(), target_output.end(), batch_targets + i * output_size);
         }
+      });
+    }
+
+    void TrainEpoch(const BaseDataset<dataType> &dataset, size_t batchSize, bool random) {
+      TrainEpoch(dataset, batchSize, EpochSampler(random));
+    }
+
+    void TrainEpoch(const BaseDataset<dataType> &dataset, size_t batchSize, BaseSampler &sampler) {
+      assert(dataset.Size() != 0);
+      assert(dataset.InputSize() == this->network_->InputSize());
+      assert(dataset.TargetSize() == this->network_->OutputSize());
 
-        for (const auto &logger_ : loggers_) {
-          logger_->Log(this);
+      SampleEpoch(dataset.Size(), sampler);
+
+      const InputFormat<dataType> input_format = FeedFormat(dataset);
+      const bool labels = dataset.HasLabels();
+
+      RunIndexedEpoch(batchSize, [&](const size_t *indices, size_t count, dataType *batch_inputs, dataType *batch_targets,
+                                     uint32_t *batch_labels) {
+        if (input_format.Encoded()) {
+          dataset.GatherEncoded(indices, count, batch_inputs, batch_targets);
+        } else {
+          dataset.Gather(indices, count, batch_inputs, batch_targets);
         }
-        training_iterations_ += batchSize * iterations;
-      }
+
+        if (labels) {
+          dataset.GatherLabels(indices, count, batch_labels);
+        }
+      }, input_format, labels);
     }
 
-    dataType CalculateTrainCost() {
-      const std::vector<std::vector<dataType>> &last_outputs = train_outputs_storage_.back();
-      dataType total_cost = 0;
-      const size_t train_inputs_size = train_inputs_.size();
+    //one pass over a stream, the stream is read on the prefetch thread when prefetching is enabled
+    void TrainEpoch(BaseStreamDataset<dataType> &dataset, size_t batchSize) {
+      assert(dataset.Size() != 0);
+      assert(dataset.InputSize() == this->network_->InputSize());
+      assert(dataset.TargetSize() == this->network_->OutputSize());
 
-      for (size_t i = 0; i < train_inputs_size; ++i) {
-        const std::vector<dataType> &last_output = last_outputs[i];
-        const std::vector<dataType> &target_output = *target_outputs_[i];
+      dataset.Restart(gen_());
 
-        total_cost += cost_function_->Cost(last_output, target_output);
+      RunEpoch(dataset.Size(), batchSize, [&](size_t, size_t count, dataType *batch_inputs, dataType *batch_targets,
+                                              uint32_t *) {
+        if (dataset.Read(count, batch_inputs, batch_targets) != count) {
+          throw std::runtime_error("Stream ended before the number of samples it reported");
+        }
+      }, {}, false, true);
+    }
+
+    dataType CalculateTrainCost() {
+      if (batch_size_ == 0) {
+        last_train_cost_computed_at = training_iterations_;
+        last_train_cost_ = 0;
+        return 0;
       }
 
-      total_cost /= static_cast<dataType>(train_inputs_size);
+      const size_t output_size = this->network_->OutputSize();
+      dataType total_cost = current_labels_
+                            ? cost_function_->BatchCostLabels(train_plan_->Outputs(), current_labels_, batch_size_,
+                                                              output_size)
+                            : cost_function_->BatchCost(train_plan_->Outputs(), current_targets_, batch_size_,
+                                                        output_size);
+
+      total_cost /= static_cast<dataType>(batch_size_);
 
       last_train_cost_computed_at = training_iterations_;
       last_train_cost_ = total_cost;
@@ -233,135 +543,270 @@ namespace NeuralNet::Training {
     }
 
     dataType CalculateTestCost() {
-      if (test_inputs_.empty()) {
+      if (!test_dataset_ || test_dataset_->Size() == 0) {
         last_test_cost_computed_at = training_iterations_;
         last_test_cost_ = 0;
         return 0;
       }
 
-      std::vector<dataType> test_output(this->network_->OutputSize());
+      const size_t test_size = test_dataset_->Size();
+      const size_t input_size = this->network_->InputSize();
+      const size_t output_size = this->network_->OutputSize();
+
+      const InputFormat<dataType> input_format = FeedFormat(*test_dataset_, false);
+      const bool labels = test_dataset_->HasLabels();
+
+      if (!test_plan_) {
+        test_plan_ = Compile(this->network_, std::min(kTestBatchSize, test_size), false, input_format);
+        test_inputs_.resize(test_plan_->MaxBatchSize() * input_size);
+        test_targets_.resize(labels ? 0 : test_plan_->MaxBatchSize() * output_size);
+        test_labels_.resize(labels ? test_plan_->MaxBatchSize() : 0);
+      }
+
+      const size_t test_batch_size = test_plan_->MaxBatchSize();
+      std::vector<size_t> indices(test_batch_size);
       dataType total_cost = 0;
-      const size_t test_inputs_size = test_inputs_.size();
 
-      for (size_t i = 0; i < test_inputs_size; i++) {
-        test_output = (*this)(test_inputs_[i]);
+      for (size_t start = 0; start < test_size; start += test_batch_size) {
+        const size_t count = std::min(test_batch_size, test_size - start);
+        std::iota(indices.begin(), indices.begin() + count, start);
 
-        total_cost += cost_function_->Cost(test_output, test_target_outputs[i]);
+        dataType *targets = labels ? nullptr : test_targets_.data();
+        if (input_format.Encoded()) {
+          test_dataset_->GatherEncoded(indices.data(), count, test_inputs_.data(), targets);
+        } else {
+          test_dataset_->Gather(indices.data(), count, test_inputs_.data(), targets);
+        }
+        const dataType *outputs = test_plan_->ForwardEncoded(test_inputs_.data(), count);
+
+        if (labels) {
+          test_dataset_->GatherLabels(indices.data(), count, test_labels_.data());
+          total_cost += cost_function_->BatchCostLabels(outputs, test_labels_.data(), count, output_size);
+        } else {
+          total_cost += cost_function_->BatchCost(outputs, targets, count, output_size);
+        }
       }
 
-      total_cost /= static_cast<dataType>(test_inputs_size);
+      total_cost /= static_cast<dataType>(test_size);
 
       last_test_cost_computed_at = training_iterations_;
       last_test_cost_ = total_cost;
       return total_cost;
     }
 
-   private:
-
-    void RunTraining() {
-      this->Forward(train_inputs_, train_outputs_);
-
-      Backward();
+   protected:
 
-      //average gradients
-      const size_t layers_size = this->network_->LayersSize();
-      for (size_t i = 0; i < layers_size; ++i) {
-        for (auto &param : grad_weights_[i]) {
-          param = param / train_inputs_.size();
-        }
-      }
-
-      UpdateParams();
+    [[nodiscard]] BaseSampler &EpochSampler(bool random) {
+      return random ? static_cast<BaseSampler &>(*shuffle_sampler_) : *sequential_sampler_;
     }
 
-    void Backward() {
-      assert(this->network_->LayersSize() != 0);
+    void RunTraining() {
+      RunTraining(batch_inputs_.data(), batch_targets_.data());
+    }
 
-      size_t train_inputs_size = train_inputs_.size();
+    //inputs are stored as described by the format the train plan was compiled for,
+    //either targets or labels is set
+    void RunTraining(const void *inputs, const dataType *targets, const uint32_t *labels = nullptr) {
+      current_inputs_ = inputs;
+      current_targets_ = targets;
+      current_labels_ = labels;
 
-      std::vector<std::vector<dataType>> &last_outputs = train_outputs_storage_.back();
-      std::vector<std::vector<dataType>> &last_deltas = deltas_.back();
+      train_plan_->ForwardEncoded(inputs, batch_size_);
 
-      for (size_t i = 0; i < train_inputs_size; ++i) {
-        std::vector<dataType> &last_delta = last_deltas[i];
-        std::vector<dataType> &last_output = last_outputs[i];
-        std::vector<dataType> &target_output = *target_outputs_[i];
+      if (labels) {
+        cost_function_->BatchGradientLabels(train_plan_->Outputs(), labels, train_plan_->OutputDeltas(),
+                                            batch_size_, this->network_->OutputSize());
+      } else {
+        cost_function_->BatchGradient(train_plan_->Outputs(), targets, train_plan_->OutputDeltas(),
+                                      batch_size_, this->network_->OutputSize());
+      }
 
-        last_delta = cost_function_->Gradient(last_output, target_output);
+      if (loss_scale_ != 1) {
+        dataType *deltas = train_plan_->OutputDeltas();
+        for (size_t i = 0; i < batch_size_ * this->network_->OutputSize(); ++i) {
+          deltas[i] *= loss_scale_;
+        }
       }
 
-      size_t layer_index = this->network_->LayersSize() - 1;
+      train_plan_->Backward();
 
-      while (layer_index > 0) {
-        this->network_->LayerAt(layer_index)->
-            Backward(train_outputs_[layer_index - 1],
-                     train_outputs_[layer_index],
-                     deltas_[layer_index],
-                     deltas_[layer_index - 1],
-                     grad_weights_[layer_index]);
-        --layer_index;
-      }
+      UpdateParams();
 
-      this->network_->LayerAt(0)->
-          Backward(train_inputs_,
-                   train_outputs_[0],
-                   deltas_[0],
-                   input_deltas_,
-                   grad_weights_[0]);
+      if (pruner_) {
+        pruner_->Apply(*this->network_);
+      }
     }
 
     void UpdateParams() {
       const size_t layers_size = this->network_->LayersSize();
 
+      if (precision_ == Precision::Float16 && !UpdateLossScale()) {
+        return;
+      }
+
+      const dataType gradient_scale = static_cast<dataType>(batch_size_) * loss_scale_;
+
       for (size_t i = 0; i < layers_size; ++i) {
         auto layer = this->network_->LayerAt(i);
         if (layer->Trainable()) {
-          optimizer_->CalculateUpdatesFromGradients(grad_weights_[i], i); //i == layer_ID
-
-          std::static_pointer_cast<BaseTrainableLayer<dataType>>(layer)->UpdateParameters(grad_weights_[i]);
+          std::vector<dataType> &grad_weights = train_plan_->GradParameters(i);
 
-          for (auto &param : grad_weights_[i]) {
-            param = 0;
+          //average gradients
+          for (auto &param : grad_weights) {
+            param = param / gradient_scale;
           }
+
+          optimizer_->CalculateUpdatesFromGradients(grad_weights, i); //i == layer_ID
+
+          std::static_pointer_cast<BaseTrainableLayer<dataType>>(layer)->UpdateParameters(grad_weights);
         }
       }
     }
 
-    void AllocateTrainVectors(size_t samples_count) {
-      const size_t layers_size = this->network_->LayersSize();
+    //false when a gradient of the last batch overflowed, the loss scale is lowered and the batch has to be skipped
+    bool UpdateLossScale() {
+      for (size_t i = 0; i < this->network_->LayersSize(); ++i) {
+        for (const dataType gradient : train_plan_->GradParameters(i)) {
+          if (!std::isfinite(gradient)) {
+            loss_scale_ = std::max(loss_scale_ / 2, dataType(1));
+            loss_scale_good_steps_ = 0;
+            return false;
+          }
+        }
+      }
 
-      if (train_inputs_.size() != samples_count) {
-        train_inputs_.resize(samples_count);
-        target_outputs_.resize(samples_count);
+      if (++loss_scale_good_steps_ == kLossScaleInterval) {
+        loss_scale_ *= 2;
+        loss_scale_good_steps_ = 0;
+      }
+      return true;
+    }
 
-        train_outputs_storage_.resize(layers_size);
-        train_outputs_.resize(layers_size);
+    //the dataset's encoded format when the first layer can dequantize it, the native one otherwise
+    [[nodiscard]] InputFormat<dataType> FeedFormat(const BaseDataset<dataType> &dataset, bool training = true) const {
+      const InputFormat<dataType> input_format = dataset.EncodedInputFormat();
+      if (training && !augmentations_.empty()) {
+        return {};
+      }
+      if (input_format.Encoded() && this->network_->LayerAt(0)->AcceptsEncodedInput()) {
+        return input_format;
+      }
+      return {};
+    }
 
-        deltas_.resize(layers_size);
+    void SampleEpoch(size_t dataset_size, BaseSampler &sampler) {
+      sampler.Sample(dataset_size, epoch_indices_, gen_);
+    }
 
-        for (size_t layer_index = 0; layer_index < layers_size; ++layer_index) {
-          size_t layer_output_count = this->network_->LayerAt(layer_index)->OutputSize();
+    //gather_batch(indices, count, inputs, targets, labels) writes the rows at indices into the given buffers
+    template<typename GatherBatch>
+    void RunIndexedEpoch(size_t batchSize, GatherBatch gather_batch, const InputFormat<dataType> &input_format = {},
+                         bool labels = false) {
+      RunEpoch(epoch_indices_.size(), batchSize,
+               [this, &gather_batch](size_t start, size_t count, dataType *batch_inputs, dataType *batch_targets,
+                                     uint32_t *batch_labels) {
+                 gather_batch(epoch_indices_.data() + start, count, batch_inputs, batch_targets, batch_labels);
+               }, input_format, labels);
+    }
 
-          train_outputs_storage_[layer_index].resize(samples_count);
-          train_outputs_[layer_index].resize(samples_count);
+    //trains on samples samples in batches of batchSize, the last batch holds the remaining samples,
+    //fill_batch(start, count, inputs, targets, labels) writes samples start .. start + count - 1 into the given
+    //buffers, encoded inputs are written into the same buffers as they never take more space than dataType rows,
+    //with labels the targets buffer is null and one class index per sample is written instead,
+    //fill_batch is called from several loader threads at once unless in_order is set
+    template<typename FillBatch>
+    void RunEpoch(size_t samples, size_t batchSize, FillBatch fill_batch, const InputFormat<dataType> &input_format = {},
+                  bool labels = false, bool in_order = false) {
+      const size_t batches = (samples + batchSize - 1) / batchSize;
+
+      AllocateTrainVectors(std::min(batchSize, samples), input_format, labels);
+
+      //every batch reseeds the generator of the thread augmenting it, so results do not depend on the thread count
+      const uint32_t augmentation_seed = augmentations_.empty() ? 0 : static_cast<uint32_t>(gen_());
+
+      if (prefetcher_) {
+        prefetcher_->Start(batches, batchSize, this->network_->InputSize(), labels ? 0 : this->network_->OutputSize(),
+                           [this, batchSize, samples, labels, augmentation_seed, &fill_batch](Batch<dataType> &batch,
+                                                                                              std::mt19937 &gen) {
+                             const size_t start = batch.index * batchSize;
+                             batch.size = std::min(batchSize, samples - start);
+                             fill_batch(start, batch.size, batch.inputs.data(),
+                                        labels ? nullptr : batch.targets.data(), batch.labels.data());
+                             Augment(batch.inputs.data(), batch.size, augmentation_seed, batch.index, gen);
+                           }, in_order ? 1 : loader_threads_);
+
+        try {
+          for (size_t i = 0; i < batches; ++i) {
+            const Batch<dataType> &batch = prefetcher_->Next();
+            batch_size_ = batch.size;
+
+            RunTraining(batch.inputs.data(), labels ? nullptr : batch.targets.data(),
+                        labels ? batch.labels.data() : nullptr);
+          }
+        } catch (...) {
+          prefetcher_->Stop();
+          throw;
+        }
 
-          deltas_[layer_index].resize(samples_count);
+        prefetcher_->Stop();
+      } else {
+        for (size_t start = 0; start < samples; start += batchSize) {
+          const size_t count = std::min(batchSize, samples - start);
+          batch_size_ = count;
 
-          for (size_t i = 0; i < samples_count; ++i) {
-            train_outputs_storage_[layer_index][i] = std::vector<dataType>(layer_output_count);
-            train_outputs_[layer_index][i] = &(train_outputs_storage_[layer_index][i]);
+          fill_batch(start, count, batch_inputs_.data(), labels ? nullptr : batch_targets_.data(),
+                     batch_labels_.data());
+          Augment(batch_inputs_.data(), count, augmentation_seed, start / batchSize, augmentation_gen_);
 
-            deltas_[layer_index][i] = std::vector<dataType>(layer_output_count);
-          }
+          RunTraining(batch_inputs_.data(), labels ? nullptr : batch_targets_.data(),
+                      labels ? batch_labels_.data() : nullptr);
         }
+      }
 
-        input_deltas_.resize(samples_count);
+      training_iterations_ += samples;
+      for (const auto &logger_ : loggers_) {
+        logger_->Log(this);
+      }
+    }
 
-        for (size_t i = 0; i < samples_count; ++i) {
-          input_deltas_[i] = std::vector<dataType>(this->network_->InputSize());
-        }
+    void Augment(dataType *inputs, size_t count, uint32_t seed, size_t batch_index, std::mt19937 &gen) const {
+      if (augmentations_.empty()) {
+        return;
+      }
+
+      std::seed_seq batch_seed{seed, static_cast<uint32_t>(batch_index), static_cast<uint32_t>(uint64_t(batch_index) >> 32)};
+      gen.seed(batch_seed);
+
+      for (const auto &augmentation : augmentations_) {
+        augmentation->Apply(inputs, count, this->network_->InputSize(), gen);
       }
     }
+
+    void GatherSample(size_t index, const std::vector<dataType> &input, const std::vector<dataType> &target_output) {
+      const size_t input_size = this->network_->InputSize();
+      const size_t output_size = this->network_->OutputSize();
+
+      assert(input.size() == input_size);
+      assert(target_output.size() == output_size);
+
+      std::copy(input.begin(), input.end(), batch_inputs_.begin() + index * input_size);
+      std::copy(target_output.begin(), target_output.end(), batch_targets_.begin() + index * output_size);
+    }
+
+    void AllocateTrainVectors(size_t samples_count, const InputFormat<dataType> &input_format = {},
+                              bool labels = false) {
+      batch_size_ = samples_count;
+
+      if (!train_plan_ || train_plan_->MaxBatchSize() < samples_count || train_plan_->Format() != input_format) {
+        samples_count = std::max(samples_count, train_plan_ ? train_plan_->MaxBatchSize() : 0);
+        train_plan_ = Compile(this->network_, samples_count, true, input_format, Kernels::DetectISA(), precision_);
+      }
+
+      const size_t max_batch_size = train_plan_->MaxBatchSize();
+      batch_inputs_.resize(max_batch_size * this->network_->InputSize());
+      batch_targets_.resize(labels ? 0 : max_batch_size * this->network_->OutputSize());
+      batch_labels_.resize(labels ? max_batch_size : 0);
+    }
   };
 
 }
\ No newline at end of file
@@ -8,6 +8,13 @@
 /* Classes used for artificial neural networks inference */
 
 #include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/quantized_fully_connected_layer.h>
+#include <NeuralNet/Layers/half_fully_connected_layer.h>
+#include <NeuralNet/Layers/sparse_fully_connected_layer.h>
+#include <NeuralNet/Layers/binary_fully_connected_layer.h>
+#include <NeuralNet/Layers/ternary_fully_connected_layer.h>
+#include <NeuralNet/Layers/codebook_fully_connected_layer.h>
+#include <NeuralNet/Layers/normalization_layer.h>
 
 #include <NeuralNet/Layers/Activations/tanh_activation.h>
 #include <NeuralNet/Layers/Activations/relu_activation.h>
@@ -16,7 +23,19 @@
 #include <NeuralNet/Layers/Activations/sigmoid_activation.h>
 
 #include <NeuralNet/Model/base_network.h>
+#include <NeuralNet/Model/execution_plan.h>
+#include <NeuralNet/Model/network_graph.h>
+#include <NeuralNet/Model/graph_passes.h>
 #include <NeuralNet/Model/inference_network.h>
+#include <NeuralNet/Model/network_classifier.h>
+#include <NeuralNet/Model/quantization.h>
+#include <NeuralNet/Model/half_precision.h>
+#include <NeuralNet/Model/sparsification.h>
+#include <NeuralNet/Model/low_rank.h>
+#include <NeuralNet/Model/bit_packing.h>
+#include <NeuralNet/Model/codebook.h>
+#include <NeuralNet/Model/source_export.h>
+#include <NeuralNet/Pruning/neuron_pruning.h>
 
 /* Classes used for artificial neural networks training */
 
@@ -26,6 +45,7 @@
 
 #include <NeuralNet/Loggers/cout_logger.h>
 #include <NeuralNet/Loggers/csv_logger.h>
+#include <NeuralNet/Loggers/checkpoint_logger.h>
 
 #include <NeuralNet/Optimizers/grad_optimizer.h>
 #include <NeuralNet/Optimizers/adam_optimizer.h>
@@ -33,7 +53,21 @@
 #include <NeuralNet/Optimizers/rmsprop_optimizer.h>
 #include <NeuralNet/Optimizers/nesterov_optimizer.h>
 
+#include <NeuralNet/Data/dataset.h>
+#include <NeuralNet/Data/idx_dataset.h>
+#include <NeuralNet/Data/shard_writer.h>
+#include <NeuralNet/Data/sharded_dataset.h>
+
+#include <NeuralNet/Data/Samplers/sequential_sampler.h>
+#include <NeuralNet/Data/Samplers/shuffle_sampler.h>
+#include <NeuralNet/Data/Samplers/weighted_sampler.h>
+
+#include <NeuralNet/Data/Augmentations/gaussian_noise_augmentation.h>
+#include <NeuralNet/Data/Augmentations/shift_augmentation.h>
+#include <NeuralNet/Data/Augmentations/scale_augmentation.h>
+
 #include <NeuralNet/Model/training_network.h>
+#include <NeuralNet/Model/distillation_training.h>
 
 #include <NeuralNet/Initializers/xavier_initializer.h>
 #include <NeuralNet/Initializers/he_initializer.h>
\ No newline at end of file
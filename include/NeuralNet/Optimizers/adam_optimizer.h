@@ -35,6 +35,14 @@ namespace NeuralNet::Training {
       }
     }
 
+    [[nodiscard]] std::vector<std::vector<dataType> *> State() override {
+      std::vector<std::vector<dataType> *> state;
+      for (size_t i = 0; i < m_.size(); ++i) {
+        state.insert(state.end(), {&m_[i], &v_[i], &b_t_[i]});
+      }
+      return state;
+    }
+
     void CalculateUpdatesFromGradients(std::vector<dataType> &updates, size_t layer_id) override {
       size_t updates_size = updates.size();
 
@@ -8,9 +8,17 @@ namespace NeuralNet::Training {
   class BaseOptimizer {
    public:
 
+    virtual ~BaseOptimizer() = default;
+
     virtual void Allocate(std::shared_ptr<const NeuralNetwork<dataType>> net) = 0;
 
     virtual void CalculateUpdatesFromGradients(std::vector<dataType> &updates, size_t layer_id) = 0;
+
+    //the buffers making up the optimizer's state after Allocate, in a fixed order,
+    //saved and restored with the training state
+    [[nodiscard]] virtual std::vector<std::vector<dataType> *> State() {
+      return {};
+    }
   };
 
 }
\ No newline at end of file
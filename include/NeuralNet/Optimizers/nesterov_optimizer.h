@@ -22,6 +22,14 @@ namespace NeuralNet::Training {
       }
     }
 
+    [[nodiscard]] std::vector<std::vector<dataType> *> State() override {
+      std::vector<std::vector<dataType> *> state;
+      for (size_t i = 0; i < cache_.size(); ++i) {
+        state.insert(state.end(), {&cache_[i], &old_cache_[i]});
+      }
+      return state;
+    }
+
     void CalculateUpdatesFromGradients(std::vector<dataType> &updates, size_t layer_id) override {
       size_t update_size = updates.size();
 
@@ -25,6 +25,14 @@ namespace NeuralNet::Training {
       }
     }
 
+    [[nodiscard]] std::vector<std::vector<dataType> *> State() override {
+      std::vector<std::vector<dataType> *> state;
+      for (auto &cache : cache_) {
+        state.push_back(&cache);
+      }
+      return state;
+    }
+
     void CalculateUpdatesFromGradients(std::vector<dataType> &updates, size_t layer_id) override {
       size_t update_size = updates.size();
 
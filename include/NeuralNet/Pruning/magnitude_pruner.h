@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Model/base_network.h>
+
+namespace NeuralNet::Training {
+
+  //zeroes the smallest magnitude weights of every FullyConnectedLayer while the network trains, see
+  //NetworkTraining::SetPruner. the sparsity of each layer grows from 0 at begin_step to final_sparsity at end_step
+  //as final_sparsity * (1 - (1 - progress)^3), so most weights go early while the network can still recover.
+  //the masks are recomputed every frequency steps in between, and masked weights are zeroed again after every
+  //update so they stay pruned while training continues. biases are never pruned
+  template<std::floating_point dataType>
+  class MagnitudePruner {
+   private:
+    double final_sparsity_;
+    size_t begin_step_;
+    size_t end_step_;
+    size_t frequency_;
+
+    size_t step_ = 0;
+    double sparsity_ = 0;
+
+    //one byte per weight of each fully connected layer, 0 when pruned, empty for the other layers
+    std::vector<std::vector<uint8_t>> masks_;
+
+   public:
+
+    //steps count parameter updates, one per trained batch
+    explicit MagnitudePruner(double final_sparsity, size_t begin_step = 0, size_t end_step = 1000,
+                             size_t frequency = 100)
+        : final_sparsity_(final_sparsity), begin_step_(begin_step), end_step_(std::max(end_step, begin_step)),
+          frequency_(std::max<size_t>(frequency, 1)) {
+      if (!(final_sparsity >= 0 && final_sparsity < 1)) {
+        throw std::runtime_error("Pruning sparsity must be in [0, 1)");
+      }
+    }
+
+    [[nodiscard]] size_t Step() const {
+      return step_;
+    }
+
+    //sparsity of the current masks
+    [[nodiscard]] double Sparsity() const {
+      return sparsity_;
+    }
+
+    [[nodiscard]] double TargetSparsity(size_t step) const {
+      if (step < begin_step_) {
+        return 0;
+      }
+      if (step >= end_step_) {
+        return final_sparsity_;
+      }
+      const double progress = static_cast<double>(step - begin_step_) / static_cast<double>(end_step_ - begin_step_);
+      return final_sparsity_ * (1 - std::pow(1 - progress, 3));
+    }
+
+    //empty for layers that are not pruned
+    [[nodiscard]] const std::vector<uint8_t> &Mask(size_t layer) const {
+      return masks_.at(layer);
+    }
+
+    //one mask per layer of the network, empty before the first Prune
+    [[nodiscard]] const std::vector<std::vector<uint8_t>> &Masks() const {
+      return masks_;
+    }
+
+    //continues the schedule at step with the masks of a saved run, see NetworkTraining::LoadState
+    void Restore(size_t step, double sparsity, std::vector<std::vector<uint8_t>> masks) {
+      step_ = step;
+      sparsity_ = sparsity;
+      masks_ = std::move(masks);
+    }
+
+    //called after every parameter update
+    void Apply(NeuralNetwork<dataType> &network) {
+      const bool scheduled = step_ >= begin_step_ && step_ <= end_step_
+          && ((step_ - begin_step_) % frequency_ == 0 || step_ == end_step_);
+      if (scheduled) {
+        Prune(network, TargetSparsity(step_));
+      }
+      ++step_;
+
+      ApplyMasks(network);
+    }
+
+    //recomputes the masks so that the sparsity fraction of every fully connected layer's weights is pruned
+    void Prune(NeuralNetwork<dataType> &network, double sparsity) {
+      masks_.resize(network.LayersSize());
+
+      for (size_t i = 0; i < network.LayersSize(); ++i) {
+        const auto dense = std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(network.LayerAt(i));
+        if (!dense) {
+          continue;
+        }
+
+        const size_t weights_size = dense->InputSize() * dense->OutputSize();
+        const dataType *weights = dense->Parameters().data();
+        const size_t pruned = static_cast<size_t>(sparsity * static_cast<double>(weights_size));
+
+        //indices ordered by magnitude up to the pruned-th, ties are broken by index so the count is exact
+        std::vector<uint32_t> order(weights_size);
+        for (size_t k = 0; k < weights_size; ++k) {
+          order[k] = static_cast<uint32_t>(k);
+        }
+        std::nth_element(order.begin(), order.begin() + pruned, order.end(), [weights](uint32_t a, uint32_t b) {
+          const dataType abs_a = std::abs(weights[a]);
+          const dataType abs_b = std::abs(weights[b]);
+          return abs_a < abs_b || (abs_a == abs_b && a < b);
+        });
+
+        std::vector<uint8_t> &mask = masks_[i];
+        mask.assign(weights_size, 1);
+        for (size_t k = 0; k < pruned; ++k) {
+          mask[order[k]] = 0;
+        }
+      }
+
+      sparsity_ = sparsity;
+      ApplyMasks(network);
+    }
+
+   private:
+
+    void ApplyMasks(NeuralNetwork<dataType> &network) const {
+      for (size_t i = 0; i < masks_.size(); ++i) {
+        if (masks_[i].empty()) {
+          continue;
+        }
+
+        std::vector<dataType> &parameters =
+            std::static_pointer_cast<FullyConnectedLayer<dataType>>(network.LayerAt(i))->Parameters();
+        const std::vector<uint8_t> &mask = masks_[i];
+        for (size_t k = 0; k < mask.size(); ++k) {
+          if (!mask[k]) {
+            parameters[k] = 0;
+          }
+        }
+      }
+    }
+  };
+
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include <NeuralNet/misc/aligned_allocator.h>
+#include <NeuralNet/Data/base_dataset.h>
+#include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/Activations/relu_activation.h>
+#include <NeuralNet/Layers/Activations/leaky_relu_activation.h>
+#include <NeuralNet/Layers/Activations/sigmoid_activation.h>
+#include <NeuralNet/Layers/Activations/tanh_activation.h>
+#include <NeuralNet/Model/model_writer.h>
+#include <NeuralNet/Model/base_network.h>
+#include <NeuralNet/Model/inference_network.h>
+
+namespace NeuralNet {
+
+  //activation applied to every unit on its own, resized to size, null for any other layer
+  template<std::floating_point dataType>
+  std::unique_ptr<BaseLayer<dataType>> ResizedElementwiseActivation(const std::shared_ptr<BaseLayer<dataType>> &layer,
+                                                                    size_t size) {
+    if (std::dynamic_pointer_cast<ReLuActivation<dataType>>(layer)) {
+      return std::make_unique<ReLuActivation<dataType>>(size, size);
+    }
+    if (const auto leaky = std::dynamic_pointer_cast<LeakyReLuActivation<dataType>>(layer)) {
+      return std::make_unique<LeakyReLuActivation<dataType>>(size, size, leaky->Alpha());
+    }
+    if (std::dynamic_pointer_cast<SigmoidActivation<dataType>>(layer)) {
+      return std::make_unique<SigmoidActivation<dataType>>(size, size);
+    }
+    if (std::dynamic_pointer_cast<TanhActivation<dataType>>(layer)) {
+      return std::make_unique<TanhActivation<dataType>>(size, size);
+    }
+    return nullptr;
+  }
+
+  //narrower dense network without the hidden units that never change over the first calibration_samples samples of
+  //calibration. a unit is the output of a FullyConnectedLayer after the element-wise activations following it, it
+  //can be removed when the next layer is fully connected as well: its row goes from the first layer, its column from
+  //the next one, and its mean value times that column is folded into the next layer's biases. units whose range is
+  //at most tolerance times the largest range in their layer count as constant, dead ReLU units have range 0
+  template<std::floating_point dataType>
+  std::shared_ptr<NeuralNetwork<dataType>> PruneNeurons(const std::shared_ptr<NeuralNetwork<dataType>> &network,
+                                                        const BaseDataset<dataType> &calibration,
+                                                        dataType tolerance = 1e-3,
+                                                        size_t calibration_samples = 1024) {
+    constexpr size_t kCalibrationBatchSize = 256;
+
+    const size_t layers_size = network->LayersSize();
+    const size_t input_size = network->InputSize();
+    const size_t samples = std::min(calibration.Size(), calibration_samples);
+
+    if (samples == 0) {
+      throw std::runtime_error("Neuron pruning needs calibration samples");
+    }
+    if (calibration.InputSize() != input_size) {
+      throw std::runtime_error("Calibration samples have " + std::to_string(calibration.InputSize())
+                                   + " inputs but the network expects " + std::to_string(input_size));
+    }
+
+    //for every fully connected layer whose units feed another one, the index of the layer holding the units after
+    //its activations, and of the fully connected layer consuming them
+    std::vector<size_t> units_at(layers_size, 0);
+    std::vector<size_t> consumer(layers_size, 0);
+
+    for (size_t i = 0; i < layers_size; ++i) {
+      if (!std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(network->LayerAt(i))) {
+        continue;
+      }
+
+      size_t next = i + 1;
+      while (next < layers_size && ResizedElementwiseActivation(network->LayerAt(next), 1)) {
+        ++next;
+      }
+      if (next < layers_size && std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(network->LayerAt(next))) {
+        units_at[i] = next - 1;
+        consumer[i] = next;
+      }
+    }
+
+    NetworkInference<dataType> inference(network, std::min(kCalibrationBatchSize, samples));
+    const auto &plan = inference.Plan();
+    AlignedVector<dataType> inputs(plan->MaxBatchSize() * input_size);
+    std::vector<size_t> indices(plan->MaxBatchSize());
+
+    std::vector<std::vector<dataType>> minimums(layers_size);
+    std::vector<std::vector<dataType>> maximums(layers_size);
+    std::vector<std::vector<dataType>> sums(layers_size);
+    for (size_t i = 0; i < layers_size; ++i) {
+      if (consumer[i]) {
+        const size_t units = network->LayerAt(i)->OutputSize();
+        minimums[i].assign(units, std::numeric_limits<dataType>::max());
+        maximums[i].assign(units, std::numeric_limits<dataType>::lowest());
+        sums[i].assign(units, 0);
+      }
+    }
+
+    for (size_t start = 0; start < samples; start += plan->MaxBatchSize()) {
+      const size_t count = std::min(plan->MaxBatchSize(), samples - start);
+      std::iota(indices.begin(), indices.begin() + count, start);
+
+      calibration.Gather(indices.data(), count, inputs.data(), nullptr);
+      inference(inputs.data(), count);
+
+      for (size_t i = 0; i < layers_size; ++i) {
+        if (!consumer[i]) {
+          continue;
+        }
+        const size_t units = network->LayerAt(i)->OutputSize();
+        const dataType *values = plan->Outputs(units_at[i]);
+        for (size_t r = 0; r < count; ++r) {
+          for (size_t u = 0; u < units; ++u) {
+            const dataType value = values[r * units + u];
+            minimums[i][u] = std::min(minimums[i][u], value);
+            maximums[i][u] = std::max(maximums[i][u], value);
+            sums[i][u] += value;
+          }
+        }
+      }
+    }
+
+    //units kept by every fully connected layer, all of them for the last one
+    std::vector<std::vector<size_t>> kept(layers_size);
+    for (size_t i = 0; i < layers_size; ++i) {
+      const size_t units = network->LayerAt(i)->OutputSize();
+      if (!consumer[i]) {
+        kept[i].resize(units);
+        std::iota(kept[i].begin(), kept[i].end(), 0);
+        continue;
+      }
+
+      dataType max_range = 0;
+      size_t widest = 0;
+      for (size_t u = 0; u < units; ++u) {
+        if (maximums[i][u] - minimums[i][u] > max_range) {
+          max_range = maximums[i][u] - minimums[i][u];
+          widest = u;
+        }
+      }
+      for (size_t u = 0; u < units; ++u) {
+        if (maximums[i][u] - minimums[i][u] > tolerance * max_range) {
+          kept[i].push_back(u);
+        }
+      }
+      //a layer needs at least one unit even when all of them are constant
+      if (kept[i].empty()) {
+        kept[i].push_back(widest);
+      }
+    }
+
+    ModelWriter writer;
+    std::vector<std::unique_ptr<BaseLayer<dataType>>> rebuilt;
+    const std::vector<size_t> *kept_inputs = nullptr;
+    const std::vector<dataType> *input_means = nullptr;
+    std::vector<dataType> means;
+    size_t producer = 0;
+
+    for (size_t i = 0; i < layers_size; ++i) {
+      const auto layer = network->LayerAt(i);
+      const auto dense = std::dynamic_pointer_cast<FullyConnectedLayer<dataType>>(layer);
+
+      if (!dense) {
+        if (kept_inputs && i <= units_at[producer]) {
+          rebuilt.push_back(ResizedElementwiseActivation(layer, kept_inputs->size()));
+          rebuilt.back()->Save(writer);
+        } else {
+          layer->Save(writer);
+        }
+        continue;
+      }
+
+      const size_t old_inputs = dense->InputSize();
+      const size_t old_outputs = dense->OutputSize();
+      const dataType *weights = dense->WeightsBiases();
+      const dataType *biases = weights + old_inputs * old_outputs;
+
+      const bool narrow_inputs = kept_inputs && consumer[producer] == i;
+      const size_t new_inputs = narrow_inputs ? kept_inputs->size() : old_inputs;
+      const std::vector<size_t> &kept_outputs = kept[i];
+
+      auto pruned = std::make_unique<FullyConnectedLayer<dataType>>(new_inputs, kept_outputs.size());
+      std::vector<dataType> &parameters = pruned->Parameters();
+      dataType *new_biases = parameters.data() + new_inputs * kept_outputs.size();
+
+      std::vector<bool> input_kept(old_inputs, !narrow_inputs);
+      if (narrow_inputs) {
+        for (const size_t u : *kept_inputs) {
+          input_kept[u] = true;
+        }
+      }
+
+      for (size_t o = 0; o < kept_outputs.size(); ++o) {
+        const dataType *row = weights + kept_outputs[o] * old_inputs;
+        dataType bias = biases[kept_outputs[o]];
+
+        for (size_t k = 0, column = 0; k < old_inputs; ++k) {
+          if (input_kept[k]) {
+            parameters[o * new_inputs + column++] = row[k];
+          } else {
+            bias += row[k] * (*input_means)[k];
+          }
+        }
+        new_biases[o] = bias;
+      }
+
+      pruned->Save(writer);
+      rebuilt.push_back(std::move(pruned));
+
+      kept_inputs = nullptr;
+      if (consumer[i]) {
+        kept_inputs = &kept[i];
+        means.resize(old_outputs);
+        for (size_t u = 0; u < old_outputs; ++u) {
+          means[u] = sums[i][u] / static_cast<dataType>(samples);
+        }
+        input_means = &means;
+        producer = i;
+      }
+    }
+
+    return Load<dataType>(writer, "pruned network");
+  }
+
+}
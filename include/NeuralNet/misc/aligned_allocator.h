@@ -0,0 +1,43 @@
+#pragma once
+
+#include <new>
+#include <vector>
+#include <cstddef>
+
+namespace NeuralNet {
+
+  constexpr size_t kCacheLineSize = 64;
+
+  template<typename T, size_t Alignment = kCacheLineSize>
+  class AlignedAllocator {
+   public:
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+      typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n) {
+      return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T *p, size_t) {
+      ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const {
+      return true;
+    }
+  };
+
+  template<typename T>
+  using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+}
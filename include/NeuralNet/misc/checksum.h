@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace NeuralNet {
+
+  namespace Detail {
+    constexpr std::array<uint32_t, 256> MakeCrc32Table() {
+      std::array<uint32_t, 256> table{};
+      for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+          crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        table[i] = crc;
+      }
+      return table;
+    }
+
+    inline constexpr std::array<uint32_t, 256> kCrc32Table = MakeCrc32Table();
+  }
+
+  //CRC-32 (IEEE), crc is the checksum of the preceding bytes when a buffer is checksummed in parts
+  inline uint32_t Crc32(const void *data, size_t size, uint32_t crc = 0) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+      crc = Detail::kCrc32Table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+  }
+
+  //MurmurHash64A, used where data is compared by its hash alone and 32 bits could collide
+  inline uint64_t Hash64(const void *data, size_t size, uint64_t seed = 0) {
+    constexpr uint64_t m = 0xc6a4a7935bd1e995ull;
+    constexpr int r = 47;
+
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    uint64_t h = seed ^ (size * m);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+      uint64_t k;
+      std::memcpy(&k, bytes + i, 8);
+      k *= m;
+      k ^= k >> r;
+      k *= m;
+      h ^= k;
+      h *= m;
+    }
+
+    if (i < size) {
+      uint64_t k = 0;
+      std::memcpy(&k, bytes + i, size - i);
+      h ^= k;
+      h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+  }
+
+}
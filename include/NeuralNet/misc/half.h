@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace NeuralNet {
+
+  //how a plan stores the activations and deltas between layers, the kernels still compute in dataType
+  enum class Precision {
+    Native = 0,
+    BFloat16 = 1,
+    Float16 = 2,
+  };
+
+  inline const char *PrecisionName(Precision precision) {
+    switch (precision) {
+      case Precision::BFloat16: return "bf16";
+      case Precision::Float16: return "fp16";
+      default: return "native";
+    }
+  }
+
+  //bfloat16 is the upper half of a float, rounded to nearest even, NaNs stay NaNs
+  inline uint16_t FloatToBFloat16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+      return static_cast<uint16_t>((bits >> 16) | 0x40);
+    }
+    bits += 0x7FFFu + ((bits >> 16) & 1);
+    return static_cast<uint16_t>(bits >> 16);
+  }
+
+  inline float BFloat16ToFloat(uint16_t value) {
+    const uint32_t bits = uint32_t(value) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+
+  //IEEE half precision rounded to nearest even, values beyond its range become infinity
+  inline uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t abs = bits & 0x7FFFFFFFu;
+
+    if (abs >= 0x7F800000u) {
+      return static_cast<uint16_t>(sign | 0x7C00u | (abs > 0x7F800000u ? 0x200u : 0));
+    }
+    if (abs >= 0x477FF000u) {
+      return static_cast<uint16_t>(sign | 0x7C00u);
+    }
+    if (abs < 0x38800000u) {
+      //subnormal half, the float is scaled so that adding it to 0.5 rounds the mantissa in hardware
+      float magnitude;
+      std::memcpy(&magnitude, &abs, sizeof(magnitude));
+      magnitude += 0.5f;
+      uint32_t rounded;
+      std::memcpy(&rounded, &magnitude, sizeof(rounded));
+      return static_cast<uint16_t>(sign | (rounded - 0x3F000000u));
+    }
+
+    const uint32_t mantissa_odd = (abs >> 13) & 1;
+    return static_cast<uint16_t>(sign | ((abs - 0x38000000u + 0xFFFu + mantissa_odd) >> 13));
+  }
+
+  inline float HalfToFloat(uint16_t value) {
+    const uint32_t sign = uint32_t(value & 0x8000u) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1Fu;
+    const uint32_t mantissa = value & 0x3FFu;
+
+    uint32_t bits;
+    if (exponent == 0x1F) {
+      bits = sign | 0x7F800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+      bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else {
+      //subnormal or zero, exactly mantissa * 2^-24
+      float magnitude = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+      std::memcpy(&bits, &magnitude, sizeof(bits));
+      bits |= sign;
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+
+}
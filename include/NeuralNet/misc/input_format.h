@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include <NeuralNet/misc/types.h>
+
+namespace NeuralNet {
+
+  enum class InputElement {
+    Native = 0,
+    UInt8 = 1,
+    Int16 = 2,
+  };
+
+  inline const char *InputElementName(InputElement element) {
+    switch (element) {
+      case InputElement::UInt8: return "uint8";
+      case InputElement::Int16: return "int16";
+      default: return "native";
+    }
+  }
+
+  template<typename T>
+  constexpr InputElement InputElementOf() {
+    if constexpr (std::is_same_v<T, uint8_t>) {
+      return InputElement::UInt8;
+    } else if constexpr (std::is_same_v<T, int16_t>) {
+      return InputElement::Int16;
+    } else {
+      return InputElement::Native;
+    }
+  }
+
+  //bytes of one input stored as element
+  template<std::floating_point dataType>
+  constexpr size_t InputElementSize(InputElement element) {
+    switch (element) {
+      case InputElement::UInt8: return sizeof(uint8_t);
+      case InputElement::Int16: return sizeof(int16_t);
+      default: return sizeof(dataType);
+    }
+  }
+
+  //how network inputs are stored, encoded values x are fed to the first layer as x * scale + offset
+  template<std::floating_point dataType>
+  struct InputFormat {
+    InputElement element = InputElement::Native;
+    dataType scale = 1;
+    dataType offset = 0;
+
+    [[nodiscard]] bool Encoded() const {
+      return element != InputElement::Native;
+    }
+
+    bool operator==(const InputFormat &) const = default;
+  };
+
+}
@@ -4,6 +4,13 @@ namespace NeuralNet {
 
   enum LayerType {
     FullyConnected = 0,
+    QuantizedFullyConnected = 1,
+    HalfFullyConnected = 2,
+    SparseFullyConnected = 3,
+    BinaryFullyConnected = 4,
+    TernaryFullyConnected = 5,
+    CodebookFullyConnected = 6,
+    Normalization = 7,
     ReLU = 1000,
     LeakyReLU = 1001,
     Sigmoid = 1002,
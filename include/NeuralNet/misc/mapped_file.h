@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <utility>
+#include <stdexcept>
+
+#include <NeuralNet/misc/aligned_allocator.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NEURALNET_HAS_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define NEURALNET_HAS_MMAP 0
+#endif
+
+namespace NeuralNet {
+
+  //read-only view of a whole file, memory mapped where the platform supports it and read into memory otherwise,
+  //Data() is aligned to at least a cache line either way
+  class MappedFile {
+   private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    AlignedVector<uint8_t> fallback_;
+
+   public:
+
+    explicit MappedFile(const std::string &filepath) {
+#if NEURALNET_HAS_MMAP
+      int fd = ::open(filepath.c_str(), O_RDONLY);
+      if (fd < 0) {
+        throw std::runtime_error("Failed to open file for reading: " + filepath);
+      }
+
+      struct stat st{};
+      if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file: " + filepath);
+      }
+      size_ = static_cast<size_t>(st.st_size);
+
+      if (size_ != 0) {
+        void *address = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+          ::close(fd);
+          throw std::runtime_error("Failed to map file: " + filepath);
+        }
+        data_ = static_cast<const uint8_t *>(address);
+        mapped_ = true;
+      }
+      ::close(fd);
+#else
+      std::ifstream is(filepath, std::ios::binary);
+      if (!is.is_open()) {
+        throw std::runtime_error("Failed to open file for reading: " + filepath);
+      }
+      fallback_.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+      data_ = fallback_.data();
+      size_ = fallback_.size();
+#endif
+    }
+
+    //contents that are already in memory, such as a model serialized by ModelWriter
+    explicit MappedFile(AlignedVector<uint8_t> contents)
+        : data_(contents.data()), size_(contents.size()), fallback_(std::move(contents)) {}
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)),
+          mapped_(std::exchange(other.mapped_, false)), fallback_(std::move(other.fallback_)) {}
+
+    ~MappedFile() {
+#if NEURALNET_HAS_MMAP
+      if (mapped_) {
+        ::munmap(const_cast<uint8_t *>(data_), size_);
+      }
+#endif
+    }
+
+    [[nodiscard]] const uint8_t *Data() const {
+      return data_;
+    }
+
+    [[nodiscard]] size_t Size() const {
+      return size_;
+    }
+  };
+
+  //flushes a written file to disk, so it can be renamed over a previous version safely
+  inline void SyncFile(const std::string &filepath) {
+#if NEURALNET_HAS_MMAP
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0 || ::fsync(fd) != 0) {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+      throw std::runtime_error("Failed to sync file: " + filepath);
+    }
+    ::close(fd);
+#endif
+  }
+
+}
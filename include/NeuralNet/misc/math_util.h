@@ -1,6 +1,9 @@
 #pragma once
 
 #include <cmath>
+#include <vector>
+#include <numeric>
+#include <algorithm>
 
 namespace NeuralNet::MathUtil {
 
@@ -15,4 +18,202 @@ namespace NeuralNet::MathUtil {
     return dotProduct;
   }
 
-}
\ No newline at end of file
+  template<typename T, typename X>
+  void Axpy(T alpha, const X *x, T *y, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      y[i] += alpha * static_cast<T>(x[i]);
+    }
+  }
+
+  //eigen decomposition of the symmetric n x n matrix a, row-major. on return values holds the eigenvalues from the
+  //largest down and row i of a the unit eigenvector of values[i]. householder tridiagonalization followed by the
+  //implicit QL method, as in EISPACK tred2 and tql2, working on the transposed matrix so every inner loop is contiguous
+  inline void SymmetricEigen(std::vector<double> &a, size_t n, std::vector<double> &values) {
+    std::vector<double> &d = values;
+    std::vector<double> e(n, 0);
+    d.assign(n, 0);
+    if (n == 0) {
+      return;
+    }
+
+    const auto at = [&a, n](size_t column, size_t row) -> double & {
+      return a[column * n + row];
+    };
+
+    for (size_t j = 0; j < n; ++j) {
+      d[j] = at(j, n - 1);
+    }
+
+    for (size_t i = n - 1; i > 0; --i) {
+      double scale = 0;
+      double h = 0;
+      for (size_t k = 0; k < i; ++k) {
+        scale += std::abs(d[k]);
+      }
+
+      if (scale == 0) {
+        e[i] = d[i - 1];
+        for (size_t j = 0; j < i; ++j) {
+          d[j] = at(j, i - 1);
+          at(j, i) = 0;
+          at(i, j) = 0;
+        }
+      } else {
+        for (size_t k = 0; k < i; ++k) {
+          d[k] /= scale;
+          h += d[k] * d[k];
+        }
+        double f = d[i - 1];
+        double g = f > 0 ? -std::sqrt(h) : std::sqrt(h);
+        e[i] = scale * g;
+        h -= f * g;
+        d[i - 1] = f - g;
+        std::fill(e.begin(), e.begin() + i, 0.0);
+
+        for (size_t j = 0; j < i; ++j) {
+          f = d[j];
+          at(i, j) = f;
+          const double *column = &at(j, 0);
+          g = e[j] + column[j] * f;
+          for (size_t k = j + 1; k < i; ++k) {
+            g += column[k] * d[k];
+            e[k] += column[k] * f;
+          }
+          e[j] = g;
+        }
+
+        f = 0;
+        for (size_t j = 0; j < i; ++j) {
+          e[j] /= h;
+          f += e[j] * d[j];
+        }
+        const double hh = f / (h + h);
+        for (size_t j = 0; j < i; ++j) {
+          e[j] -= hh * d[j];
+        }
+        for (size_t j = 0; j < i; ++j) {
+          f = d[j];
+          g = e[j];
+          double *column = &at(j, 0);
+          for (size_t k = j; k < i; ++k) {
+            column[k] -= f * e[k] + g * d[k];
+          }
+          d[j] = column[i - 1];
+          column[i] = 0;
+        }
+      }
+      d[i] = h;
+    }
+
+    //accumulate the transformations
+    for (size_t i = 0; i + 1 < n; ++i) {
+      at(i, n - 1) = at(i, i);
+      at(i, i) = 1;
+      const double h = d[i + 1];
+      double *next = &at(i + 1, 0);
+      if (h != 0) {
+        for (size_t k = 0; k <= i; ++k) {
+          d[k] = next[k] / h;
+        }
+        for (size_t j = 0; j <= i; ++j) {
+          double *column = &at(j, 0);
+          double g = 0;
+          for (size_t k = 0; k <= i; ++k) {
+            g += next[k] * column[k];
+          }
+          for (size_t k = 0; k <= i; ++k) {
+            column[k] -= g * d[k];
+          }
+        }
+      }
+      std::fill(next, next + i + 1, 0.0);
+    }
+    for (size_t j = 0; j < n; ++j) {
+      d[j] = at(j, n - 1);
+      at(j, n - 1) = 0;
+    }
+    at(n - 1, n - 1) = 1;
+
+    //diagonalize the tridiagonal matrix
+    for (size_t i = 1; i < n; ++i) {
+      e[i - 1] = e[i];
+    }
+    e[n - 1] = 0;
+
+    double f = 0;
+    double tst1 = 0;
+    const double eps = std::ldexp(1.0, -52);
+    for (size_t l = 0; l < n; ++l) {
+      tst1 = std::max(tst1, std::abs(d[l]) + std::abs(e[l]));
+      size_t m = l;
+      while (m < n - 1 && std::abs(e[m]) > eps * tst1) {
+        ++m;
+      }
+
+      if (m > l) {
+        do {
+          double g = d[l];
+          double p = (d[l + 1] - g) / (2 * e[l]);
+          double r = std::hypot(p, 1.0);
+          if (p < 0) {
+            r = -r;
+          }
+          d[l] = e[l] / (p + r);
+          d[l + 1] = e[l] * (p + r);
+          const double dl1 = d[l + 1];
+          double h = g - d[l];
+          for (size_t i = l + 2; i < n; ++i) {
+            d[i] -= h;
+          }
+          f += h;
+
+          p = d[m];
+          double c = 1, c2 = 1, c3 = 1;
+          const double el1 = e[l + 1];
+          double s = 0, s2 = 0;
+          for (size_t i = m; i-- > l;) {
+            c3 = c2;
+            c2 = c;
+            s2 = s;
+            g = c * e[i];
+            h = c * p;
+            r = std::hypot(p, e[i]);
+            e[i + 1] = s * r;
+            s = e[i] / r;
+            c = p / r;
+            p = c * d[i] - s * g;
+            d[i + 1] = h + s * (c * g + s * d[i]);
+
+            double *column0 = &at(i, 0);
+            double *column1 = &at(i + 1, 0);
+            for (size_t k = 0; k < n; ++k) {
+              const double v1 = column1[k];
+              column1[k] = s * column0[k] + c * v1;
+              column0[k] = c * column0[k] - s * v1;
+            }
+          }
+          p = -s * s2 * c3 * el1 * e[l] / dl1;
+          e[l] = s * p;
+          d[l] = c * p;
+        } while (std::abs(e[l]) > eps * tst1);
+      }
+      d[l] += f;
+      e[l] = 0;
+    }
+
+    //largest first
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&d](size_t x, size_t y) { return d[x] > d[y]; });
+
+    std::vector<double> sorted(n * n);
+    std::vector<double> sorted_values(n);
+    for (size_t i = 0; i < n; ++i) {
+      std::copy_n(a.begin() + order[i] * n, n, sorted.begin() + i * n);
+      sorted_values[i] = d[order[i]];
+    }
+    a = std::move(sorted);
+    values = std::move(sorted_values);
+  }
+
+}
@@ -9,6 +9,13 @@
 #include <NeuralNet/Layers/Activations/tanh_activation.h>
 
 #include <NeuralNet/Layers/fully_connected_layer.h>
+#include <NeuralNet/Layers/quantized_fully_connected_layer.h>
+#include <NeuralNet/Layers/half_fully_connected_layer.h>
+#include <NeuralNet/Layers/sparse_fully_connected_layer.h>
+#include <NeuralNet/Layers/binary_fully_connected_layer.h>
+#include <NeuralNet/Layers/ternary_fully_connected_layer.h>
+#include <NeuralNet/Layers/codebook_fully_connected_layer.h>
+#include <NeuralNet/Layers/normalization_layer.h>
 
 #include <NeuralNet/Model/base_network.h>
 #include <NeuralNet/misc/layer_type.h>
@@ -48,6 +55,24 @@ namespace NeuralNet {
                                                              layer_outputs_[i]);
             addActivation(activations_[i], layer_outputs_[i]);
             break;
+          case LayerType::BinaryFullyConnected:
+            network_->template AddLayer<BinaryFullyConnectedLayer>(layer_outputs_[i - 1],
+                                                                   layer_outputs_[i]);
+            addActivation(activations_[i], layer_outputs_[i]);
+            break;
+          case LayerType::TernaryFullyConnected:
+            network_->template AddLayer<TernaryFullyConnectedLayer>(layer_outputs_[i - 1],
+                                                                    layer_outputs_[i]);
+            addActivation(activations_[i], layer_outputs_[i]);
+            break;
+          case LayerType::Normalization:
+            if (layer_outputs_[i] != layer_outputs_[i - 1]) {
+              std::cout << "Normalization layer cannot change the size" << std::endl;
+              break;
+            }
+            network_->AddLayer(std::make_shared<NormalizationLayer<dataType>>(layer_outputs_[i], 1, 0));
+            addActivation(activations_[i], layer_outputs_[i]);
+            break;
           default:std::cout << "Layer type not recognized" << std::endl;
             break;
         }
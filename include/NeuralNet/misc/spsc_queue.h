@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cassert>
+
+#include <NeuralNet/misc/aligned_allocator.h>
+
+namespace NeuralNet {
+
+  //bounded lock-free queue for exactly one producer and one consumer thread,
+  //the blocking calls sleep on the counters via atomic wait instead of spinning
+  template<typename T>
+  class SPSCQueue {
+   private:
+    std::vector<T> buffer_;
+    size_t mask_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> head_ = 0;
+    alignas(kCacheLineSize) std::atomic<size_t> tail_ = 0;
+
+   public:
+
+    explicit SPSCQueue(size_t capacity) {
+      size_t size = 1;
+      while (size < capacity) {
+        size <<= 1;
+      }
+      buffer_.resize(size);
+      mask_ = size - 1;
+    }
+
+    [[nodiscard]] size_t Capacity() const {
+      return buffer_.size();
+    }
+
+    bool TryPush(const T &value) {
+      const size_t tail = tail_.load(std::memory_order_relaxed);
+      if (tail - head_.load(std::memory_order_acquire) == buffer_.size()) {
+        return false;
+      }
+
+      buffer_[tail & mask_] = value;
+      tail_.store(tail + 1, std::memory_order_release);
+      tail_.notify_one();
+      return true;
+    }
+
+    bool TryPop(T &value) {
+      const size_t head = head_.load(std::memory_order_relaxed);
+      if (head == tail_.load(std::memory_order_acquire)) {
+        return false;
+      }
+
+      value = buffer_[head & mask_];
+      head_.store(head + 1, std::memory_order_release);
+      head_.notify_one();
+      return true;
+    }
+
+    void Push(const T &value) {
+      while (!TryPush(value)) {
+        //full: wait for the consumer to move head
+        head_.wait(tail_.load(std::memory_order_relaxed) - buffer_.size(), std::memory_order_acquire);
+      }
+    }
+
+    T Pop() {
+      T value;
+      while (!TryPop(value)) {
+        //empty: wait for the producer to move tail
+        tail_.wait(head_.load(std::memory_order_relaxed), std::memory_order_acquire);
+      }
+      return value;
+    }
+
+    //only valid while neither thread is using the queue
+    void Clear() {
+      head_.store(0, std::memory_order_relaxed);
+      tail_.store(0, std::memory_order_relaxed);
+    }
+  };
+
+}
@@ -0,0 +1,25 @@
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include <NeuralNet/Model/delta_checkpoint.h>
+
+//usage: compact_checkpoint <output> <base checkpoint> [delta checkpoint ...]
+//applies the deltas to the base in the order they were written and saves the result as a complete model file
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <output> <base checkpoint> [delta checkpoint ...]" << std::endl;
+    return 2;
+  }
+
+  const std::vector<std::string> deltas(argv + 3, argv + argc);
+
+  try {
+    NeuralNet::CompactCheckpoints(argv[2], deltas, argv[1]);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
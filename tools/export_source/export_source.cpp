@@ -0,0 +1,29 @@
+#include <string>
+#include <iostream>
+
+#include <NeuralNet/NeuralNet.h>
+
+//usage: export_source <model> <header> <namespace> [unroll limit]
+//writes the model as a self-contained header, see ExportSource
+int main(int argc, char *argv[]) {
+  if (argc < 4 || argc > 5) {
+    std::cerr << "usage: " << argv[0] << " <model> <header> <namespace> [unroll limit]" << std::endl;
+    return 2;
+  }
+
+  try {
+    const size_t unroll_limit = argc == 5 ? std::stoul(argv[4]) : NeuralNet::SourceExport::kUnrollLimit;
+    const NeuralNet::ModelReader reader(argv[1], true);
+
+    if (reader.DType() == NeuralNet::ModelFormat::Element::Float64) {
+      NeuralNet::ExportSource(*NeuralNet::Load<double>(reader), argv[2], argv[3], unroll_limit);
+    } else {
+      NeuralNet::ExportSource(*NeuralNet::Load<float>(reader), argv[2], argv[3], unroll_limit);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}